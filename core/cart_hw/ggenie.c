@@ -41,7 +41,7 @@
 
 #include "shared.h"
 
-static struct
+static THREAD_CONTEXT struct
 {
   uint8 enabled;
   uint8 *rom;
@@ -56,6 +56,14 @@ typedef struct
   cart_hw_t cart_hw;  /* hardware description */
 } md_entry_t;
 
+/* Idle loop skipping database entry */
+typedef struct
+{
+  uint16 chk_1;       /* header checksum */
+  uint16 chk_2;       /* real checksum */
+  uint8 enabled;      /* idle loop skipping enabled (1) or disabled (0) */
+} md_idle_entry_t;
+
 /* Function prototypes */
 static void mapper_sega_w(uint32 data);
 static void mapper_512k_w(uint32 address, uint32 data);
@@ -240,6 +248,17 @@ static const md_entry_t rom_database[] =
 };
 
 
+/* Games overriding default 68k idle loop skipping setting (config.idle_skip):
+  - disabled for games polling hardware state that is not tracked by idle loop detection
+  - enabled for games requiring it for full speed on slower platforms
+  (list is terminated by a null entry)
+*/
+static const md_idle_entry_t idle_database[] =
+{
+  {0x0000,0x0000,0}
+};
+
+
 /************************************************************
           Cart Hardware initialization 
 *************************************************************/
@@ -704,6 +723,18 @@ void md_cart_init(void)
   {
     cart.hw.time_w = default_time_w;
   }
+
+  /* 68k idle loop skipping (only used with cartridge hardware) */
+  m68k.skip.enabled = config.idle_skip;
+  for (i=0; idle_database[i].chk_1 || idle_database[i].chk_2; i++)
+  {
+    if ((rominfo.checksum == idle_database[i].chk_1) &&
+        (rominfo.realchecksum == idle_database[i].chk_2))
+    {
+      m68k.skip.enabled = idle_database[i].enabled;
+      break;
+    }
+  }
 }
 
 /* hardware that need to be reseted on power on */
@@ -354,11 +354,11 @@ static const rominfo_t game_list[] =
 };
 
 /* Cartridge & BIOS ROM hardware */
-static romhw_t cart_rom;
-static romhw_t bios_rom;
+static THREAD_CONTEXT romhw_t cart_rom;
+static THREAD_CONTEXT romhw_t bios_rom;
 
 /* Current slot */
-static struct
+static THREAD_CONTEXT struct
 {
   uint8 *rom;
   uint8 *fcr;
@@ -1154,6 +1154,7 @@ static void mapper_32k_w(unsigned char data)
 static void write_mapper_none(unsigned int address, unsigned char data)
 {
   z80_writemap[address >> 10][address & 0x03FF] = data;
+  state_mark_dirty(&z80_writemap[address >> 10][address & 0x03FF]);
 }
 
 static void write_mapper_sega(unsigned int address, unsigned char data)
@@ -1164,6 +1165,7 @@ static void write_mapper_sega(unsigned int address, unsigned char data)
   }
 
   z80_writemap[address >> 10][address & 0x03FF] = data;
+  state_mark_dirty(&z80_writemap[address >> 10][address & 0x03FF]);
 }
 
 static void write_mapper_codies(unsigned int address, unsigned char data)
@@ -1187,6 +1189,7 @@ static void write_mapper_codies(unsigned int address, unsigned char data)
   }
 
   z80_writemap[address >> 10][address & 0x03FF] = data;
+  state_mark_dirty(&z80_writemap[address >> 10][address & 0x03FF]);
 }
 
 static void write_mapper_multi_16k(unsigned int address, unsigned char data)
@@ -1210,6 +1213,7 @@ static void write_mapper_multi_16k(unsigned int address, unsigned char data)
   }
 
   z80_writemap[address >> 10][address & 0x03FF] = data;
+  state_mark_dirty(&z80_writemap[address >> 10][address & 0x03FF]);
 }
 
 static void write_mapper_multi_32k(unsigned int address, unsigned char data)
@@ -1220,6 +1224,7 @@ static void write_mapper_multi_32k(unsigned int address, unsigned char data)
   }
 
   z80_writemap[address >> 10][address & 0x03FF] = data;
+  state_mark_dirty(&z80_writemap[address >> 10][address & 0x03FF]);
 }
 
 static void write_mapper_korea(unsigned int address, unsigned char data)
@@ -1231,6 +1236,7 @@ static void write_mapper_korea(unsigned int address, unsigned char data)
   }
 
   z80_writemap[address >> 10][address & 0x03FF] = data;
+  state_mark_dirty(&z80_writemap[address >> 10][address & 0x03FF]);
 }
 
 static void write_mapper_msx(unsigned int address, unsigned char data)
@@ -1242,6 +1248,7 @@ static void write_mapper_msx(unsigned int address, unsigned char data)
   }
 
   z80_writemap[address >> 10][address & 0x03FF] = data;
+  state_mark_dirty(&z80_writemap[address >> 10][address & 0x03FF]);
 }
 
 static void write_mapper_korea_8k(unsigned int address, unsigned char data)
@@ -1282,6 +1289,7 @@ static void write_mapper_korea_8k(unsigned int address, unsigned char data)
   }
 
   z80_writemap[address >> 10][address & 0x03FF] = data;
+  state_mark_dirty(&z80_writemap[address >> 10][address & 0x03FF]);
 }
 
 static void write_mapper_korea_16k(unsigned int address, unsigned char data)
@@ -1305,6 +1313,7 @@ static void write_mapper_korea_16k(unsigned int address, unsigned char data)
   }
 
   z80_writemap[address >> 10][address & 0x03FF] = data;
+  state_mark_dirty(&z80_writemap[address >> 10][address & 0x03FF]);
 }
 
 static void write_mapper_93c46(unsigned int address, unsigned char data)
@@ -1336,6 +1345,7 @@ static void write_mapper_93c46(unsigned int address, unsigned char data)
   }
 
   z80_writemap[address >> 10][address & 0x03FF] = data;
+  state_mark_dirty(&z80_writemap[address >> 10][address & 0x03FF]);
 }
 
 static void write_mapper_terebi(unsigned int address, unsigned char data)
@@ -1347,6 +1357,7 @@ static void write_mapper_terebi(unsigned int address, unsigned char data)
   }
 
   z80_writemap[address >> 10][address & 0x03FF] = data;
+  state_mark_dirty(&z80_writemap[address >> 10][address & 0x03FF]);
 }
 
 static unsigned char read_mapper_93c46(unsigned int address)
@@ -339,9 +339,9 @@
 }
 
 
-static ssp1601_t *ssp = NULL;
-static unsigned short *PC;
-static int g_cycles;
+static THREAD_CONTEXT ssp1601_t *ssp = NULL;
+static THREAD_CONTEXT unsigned short *PC;
+static THREAD_CONTEXT int g_cycles;
 
 #ifdef USE_DEBUGGER
 static int running = 0;
@@ -972,10 +972,139 @@ static u32 ptr2_read(int op)
 }
 
 
+/* ----------------------------------------------------- */
+/* opcode predecoding */
+
+/* each opcode is translated once into a micro-op with register numbers, pointer */
+/* modes and condition flags already extracted, so that the execution loop only */
+/* dispatches on specialized cases (operation + operand type). */
+
+#define SSP_ALU_UOPS(n) n##_S, n##_P32, n##_A32, n##_PTR, n##_ADR, n##_IMM, n##_PTR2, n##_RI, n##_SIMM
+
+enum {
+  U_NONE,  /* table not initialized */
+  U_NOP,
+  U_LD_AP, U_LD, U_LD_GR, U_LD_RH_GR, U_LD_GR_WH, U_LD_D_PTR, U_LD_PTR_S, U_LDI_D, U_LD_D_PTR2, U_LDI_PTR, U_LD_ADR_A,
+  U_LD_D_RI, U_LD_RI_S, U_LDI_RI, U_CALL, U_LD_D_A, U_BRA, U_MOD, U_MPYS, U_MPYA, U_MLD, U_LDA_ADR,
+  SSP_ALU_UOPS(U_SUB), SSP_ALU_UOPS(U_CMP), SSP_ALU_UOPS(U_ADD),
+  SSP_ALU_UOPS(U_AND), SSP_ALU_UOPS(U_OR), SSP_ALU_UOPS(U_EOR)
+};
+
+/* ALU operand types (offset from U_xxx_S) */
+enum { ALU_S, ALU_P32, ALU_A32, ALU_PTR, ALU_ADR, ALU_IMM, ALU_PTR2, ALU_RI, ALU_SIMM, ALU_FORMS };
+
+typedef struct
+{
+  unsigned char type;
+  unsigned char d;  /* destination register, pointer register or condition flags mask (>> 8) */
+  unsigned char s;  /* source register, pointer mode or condition flags value (>> 8) */
+  unsigned char p;  /* 2nd pointer mode */
+} ssp_uop_t;
+
+/* opcode table is constant once initialized and shared by all instances */
+static ssp_uop_t ssp_uops[0x10000];
+
+/* ptr1_read_ arguments combined */
+#define PTR1_MODE(op) (((op)&3)|(((op)>>6)&4)|(((op)<<1)&0x18))
+
+static void ssp1601_decode_cond(ssp_uop_t *uop, int op)
+{
+  switch (op & 0xf0)
+  {
+    case 0x00: uop->d = 0; uop->s = 0; break; /* always true */
+    case 0x50: uop->d = SSP_FLAG_Z >> 8; uop->s = (op & 0x100) ? (SSP_FLAG_Z >> 8) : 0; break;
+    case 0x70: uop->d = SSP_FLAG_N >> 8; uop->s = (op & 0x100) ? (SSP_FLAG_N >> 8) : 0; break;
+    default:   uop->d = 0; uop->s = 1; break; /* never true */
+  }
+}
+
+static void ssp1601_decode(void)
+{
+  int op;
+
+  for (op = 0; op < 0x10000; op++)
+  {
+    ssp_uop_t *uop = &ssp_uops[op];
+    int d = (op & 0xf0) >> 4;
+    int s = op & 0x0f;
+
+    uop->type = U_NOP;
+    uop->d = d;
+    uop->s = s;
+    uop->p = 0;
+
+    switch (op >> 9)
+    {
+      case 0x00:
+        if (op == ((SSP_A<<4)|SSP_P)) uop->type = U_LD_AP;
+        else if (s > 4) uop->type = ((d > 0) && (d < 4)) ? U_LD_RH_GR : U_LD;
+        else if (d >= 4) uop->type = U_LD_GR_WH;
+        else if (d > 0) uop->type = U_LD_GR;
+        break;
+      case 0x01: uop->type = U_LD_D_PTR; uop->s = PTR1_MODE(op); break;
+      case 0x02: uop->type = U_LD_PTR_S; uop->s = d; break;
+      case 0x04: uop->type = U_LDI_D; break;
+      case 0x05: uop->type = U_LD_D_PTR2; break;
+      case 0x06: uop->type = U_LDI_PTR; break;
+      case 0x07: uop->type = U_LD_ADR_A; break;
+      case 0x09: uop->type = U_LD_D_RI; uop->s = IJind; break;
+      case 0x0a: uop->type = U_LD_RI_S; uop->d = IJind; uop->s = d; break;
+      case 0x0c:
+      case 0x0d:
+      case 0x0e:
+      case 0x0f: uop->type = U_LDI_RI; uop->d = (op>>8)&7; break;
+      case 0x24: uop->type = U_CALL; ssp1601_decode_cond(uop, op); break;
+      case 0x25: uop->type = U_LD_D_A; break;
+      case 0x26: uop->type = U_BRA; ssp1601_decode_cond(uop, op); break;
+      case 0x48: uop->type = U_MOD; ssp1601_decode_cond(uop, op); uop->p = op & 7; break;
+      case 0x1b:
+      case 0x4b:
+      case 0x5b:
+        uop->type = ((op >> 9) == 0x1b) ? U_MPYS : (((op >> 9) == 0x4b) ? U_MPYA : U_MLD);
+        uop->d = (op&3) | ((op<<1)&0x18);          /* ri */
+        uop->s = ((op>>4)&3) | 4 | ((op>>3)&0x18); /* rj */
+        break;
+      case 0x03: uop->type = U_LDA_ADR; break;
+
+      default:
+      {
+        /* OP a, xx */
+        int alu = op >> 13;
+        int form;
+
+        if ((alu == 0) || (alu == 2)) break; /* not used */
+
+        switch ((op >> 9) & 0x0f)
+        {
+          case 0x00: form = (s == SSP_P) ? ALU_P32 : ((s == SSP_A) ? ALU_A32 : ALU_S); break;
+          case 0x01: form = ALU_PTR; uop->s = PTR1_MODE(op); break;
+          case 0x03: form = ALU_ADR; break;
+          case 0x04: form = ALU_IMM; break;
+          case 0x05: form = ALU_PTR2; break;
+          case 0x09: form = ALU_RI; uop->s = IJind; break;
+          case 0x0c: form = ALU_SIMM; break;
+          default:   form = -1; break;
+        }
+
+        if (form >= 0)
+        {
+          /* SUB, CMP, ADD, AND, OR, EOR */
+          static const unsigned char alu_uops[8] = { 0, U_SUB_S, 0, U_CMP_S, U_ADD_S, U_AND_S, U_OR_S, U_EOR_S };
+          uop->type = alu_uops[alu] + form;
+        }
+        break;
+      }
+    }
+  }
+}
+
 /* ----------------------------------------------------- */
 
 void ssp1601_reset(ssp1601_t *l_ssp)
 {
+  /* opcode table is decoded by first reset, other threads wait until it is complete */
+  RUN_ONCE(ssp1601_decode);
+
   ssp = l_ssp;
   ssp->emu_status = 0;
   ssp->gr[SSP_GR0].v = 0xffff0000;
@@ -1086,8 +1215,25 @@ static void debug(unsigned int pc, unsigned int op)
 #endif /* USE_DEBUGGER */
 
 
+/* OP a, xx (all operand types) */
+#define SSP_ALU_CASES(n, OP, OP32) \
+      case n##_S:    tmpv = REG_READ(uop->s); OP(tmpv); break; \
+      case n##_P32:  read_P(); OP32(rP.v); break; /* A <- P */ \
+      case n##_A32:  OP32(rA32); break; /* A <- A */ \
+      case n##_PTR:  tmpv = ptr1_read_(uop->s, 0, 0); OP(tmpv); break; \
+      case n##_ADR:  tmpv = ssp->mem.RAM[op & 0x1ff]; OP(tmpv); break; \
+      case n##_IMM:  tmpv = *PC++; OP(tmpv); break; \
+      case n##_PTR2: tmpv = ptr2_read(op); OP(tmpv); break; \
+      case n##_RI:   tmpv = rIJ[uop->s]; OP(tmpv); break; \
+      case n##_SIMM: OP(op & 0xff); break;
+
+/* predecoded condition check */
+#define UOP_COND (((rST >> 8) & uop->d) == uop->s)
+
 void ssp1601_run(int cycles)
 {
+  PROFILE_BEGIN(PROFILE_SSP1601_RUN);
+
   SET_PC(rPC);
   g_cycles = cycles;
 
@@ -1095,85 +1241,72 @@ void ssp1601_run(int cycles)
   {
     int op;
     u32 tmpv;
+    const ssp_uop_t *uop;
 
     op = *PC++;
+    uop = &ssp_uops[op];
 #ifdef USE_DEBUGGER
     debug(GET_PC()-1, op);
 #endif
-    switch (op >> 9)
+    switch (uop->type)
     {
       /* ld d, s */
-      case 0x00:
-        if (op == 0) break; /* nop */
-        if (op == ((SSP_A<<4)|SSP_P)) { /* A <- P */
-          /* not sure. MAME claims that only hi word is transfered. */
-          read_P(); /* update P */
-          rA32 = rP.v;
-        }
-        else
-        {
-          tmpv = REG_READ(op & 0x0f);
-          REG_WRITE((op & 0xf0) >> 4, tmpv);
-        }
+      case U_LD_AP:
+        /* not sure. MAME claims that only hi word is transfered. */
+        read_P(); /* update P */
+        rA32 = rP.v;
         break;
+      case U_LD: tmpv = REG_READ(uop->s); REG_WRITE(uop->d, tmpv); break;
+      case U_LD_GR: ssp->gr[uop->d].byte.h = ssp->gr[uop->s].byte.h; break;
+      case U_LD_RH_GR: tmpv = read_handlers[uop->s](); ssp->gr[uop->d].byte.h = tmpv; break;
+      case U_LD_GR_WH: write_handlers[uop->d](ssp->gr[uop->s].byte.h); break;
 
       /* ld d, (ri) */
-      case 0x01: tmpv = ptr1_read(op); REG_WRITE((op & 0xf0) >> 4, tmpv); break;
+      case U_LD_D_PTR: tmpv = ptr1_read_(uop->s, 0, 0); REG_WRITE(uop->d, tmpv); break;
 
       /* ld (ri), s */
-      case 0x02: tmpv = REG_READ((op & 0xf0) >> 4); ptr1_write(op, tmpv); break;
+      case U_LD_PTR_S: tmpv = REG_READ(uop->s); ptr1_write(op, tmpv); break;
 
       /* ldi d, imm */
-      case 0x04: tmpv = *PC++; REG_WRITE((op & 0xf0) >> 4, tmpv); break;
+      case U_LDI_D: tmpv = *PC++; REG_WRITE(uop->d, tmpv); break;
 
       /* ld d, ((ri)) */
-      case 0x05: tmpv = ptr2_read(op); REG_WRITE((op & 0xf0) >> 4, tmpv); break;
+      case U_LD_D_PTR2: tmpv = ptr2_read(op); REG_WRITE(uop->d, tmpv); break;
 
       /* ldi (ri), imm */
-      case 0x06: tmpv = *PC++; ptr1_write(op, tmpv); break;
+      case U_LDI_PTR: tmpv = *PC++; ptr1_write(op, tmpv); break;
 
       /* ld adr, a */
-      case 0x07: ssp->mem.RAM[op & 0x1ff] = rA; break;
+      case U_LD_ADR_A: ssp->mem.RAM[op & 0x1ff] = rA; break;
 
       /* ld d, ri */
-      case 0x09: tmpv = rIJ[(op&3)|((op>>6)&4)]; REG_WRITE((op & 0xf0) >> 4, tmpv); break;
+      case U_LD_D_RI: tmpv = rIJ[uop->s]; REG_WRITE(uop->d, tmpv); break;
 
       /* ld ri, s */
-      case 0x0a: rIJ[(op&3)|((op>>6)&4)] = REG_READ((op & 0xf0) >> 4); break;
+      case U_LD_RI_S: rIJ[uop->d] = REG_READ(uop->s); break;
 
       /* ldi ri, simm */
-      case 0x0c:
-      case 0x0d:
-      case 0x0e:
-      case 0x0f: rIJ[(op>>8)&7] = op; break;
+      case U_LDI_RI: rIJ[uop->d] = op; break;
 
       /* call cond, addr */
-      case 0x24: {
-        int cond = 0;
-        COND_CHECK
-        if (cond) { int new_PC = *PC++; write_STACK(GET_PC()); write_PC(new_PC); }
+      case U_CALL:
+        if (UOP_COND) { int new_PC = *PC++; write_STACK(GET_PC()); write_PC(new_PC); }
         else PC++;
         break;
-      }
 
       /* ld d, (a) */
-      case 0x25: tmpv = ((unsigned short *)svp->iram_rom)[rA]; REG_WRITE((op & 0xf0) >> 4, tmpv); break;
+      case U_LD_D_A: tmpv = ((unsigned short *)svp->iram_rom)[rA]; REG_WRITE(uop->d, tmpv); break;
 
       /* bra cond, addr */
-      case 0x26: {
-        int cond = 0;
-        COND_CHECK
-        if (cond) { int new_PC = *PC++; write_PC(new_PC); }
+      case U_BRA:
+        if (UOP_COND) { int new_PC = *PC++; write_PC(new_PC); }
         else PC++;
         break;
-      }
 
       /* mod cond, op */
-      case 0x48: {
-        int cond = 0;
-        COND_CHECK
-        if (cond) {
-          switch (op & 7) {
+      case U_MOD:
+        if (UOP_COND) {
+          switch (uop->p) {
             case 2: rA32 = (signed int)rA32 >> 1; break; /* shr (arithmetic) */
             case 3: rA32 <<= 1; break; /* shl */
             case 6: rA32 = -(signed int)rA32; break; /* neg */
@@ -1188,134 +1321,56 @@ void ssp1601_run(int cycles)
           UPD_ACC_ZN /* ? */
         }
         break;
-      }
 
       /* mpys? */
-      case 0x1b:
+      case U_MPYS:
 #ifdef LOG_SVP
         if (!(op&0x100)) elprintf(EL_SVP|EL_ANOMALY, "ssp FIXME: no b bit @ %04x", GET_PPC_OFFS());
 #endif
         read_P(); /* update P */
         rA32 -= rP.v;  /* maybe only upper word? */
         UPD_ACC_ZN      /* there checking flags after this */
-        rX = ptr1_read_(op&3, 0, (op<<1)&0x18); /* ri (maybe rj?) */
-        rY = ptr1_read_((op>>4)&3, 4, (op>>3)&0x18); /* rj */
+        rX = ptr1_read_(uop->d, 0, 0); /* ri (maybe rj?) */
+        rY = ptr1_read_(uop->s, 0, 0); /* rj */
         break;
 
       /* mpya (rj), (ri), b */
-      case 0x4b:
+      case U_MPYA:
 #ifdef LOG_SVP
         if (!(op&0x100)) elprintf(EL_SVP|EL_ANOMALY, "ssp FIXME: no b bit @ %04x", GET_PPC_OFFS());
 #endif
         read_P(); /* update P */
         rA32 += rP.v; /* confirmed to be 32bit */
         UPD_ACC_ZN /* ? */
-        rX = ptr1_read_(op&3, 0, (op<<1)&0x18); /* ri (maybe rj?) */
-        rY = ptr1_read_((op>>4)&3, 4, (op>>3)&0x18); /* rj */
+        rX = ptr1_read_(uop->d, 0, 0); /* ri (maybe rj?) */
+        rY = ptr1_read_(uop->s, 0, 0); /* rj */
         break;
 
       /* mld (rj), (ri), b */
-      case 0x5b:
+      case U_MLD:
 #ifdef LOG_SVP
         if (!(op&0x100)) elprintf(EL_SVP|EL_ANOMALY, "ssp FIXME: no b bit @ %04x", GET_PPC_OFFS());
 #endif
         rA32 = 0;
         rST &= 0x0fff; /* ? */
-        rX = ptr1_read_(op&3, 0, (op<<1)&0x18); /* ri (maybe rj?) */
-        rY = ptr1_read_((op>>4)&3, 4, (op>>3)&0x18); /* rj */
+        rX = ptr1_read_(uop->d, 0, 0); /* ri (maybe rj?) */
+        rY = ptr1_read_(uop->s, 0, 0); /* rj */
         break;
 
-      /* OP a, s */
-      case 0x10: OP_CHECK32(OP_SUBA32); tmpv = REG_READ(op & 0x0f); OP_SUBA(tmpv); break;
-      case 0x30: OP_CHECK32(OP_CMPA32); tmpv = REG_READ(op & 0x0f); OP_CMPA(tmpv); break;
-      case 0x40: OP_CHECK32(OP_ADDA32); tmpv = REG_READ(op & 0x0f); OP_ADDA(tmpv); break;
-      case 0x50: OP_CHECK32(OP_ANDA32); tmpv = REG_READ(op & 0x0f); OP_ANDA(tmpv); break;
-      case 0x60: OP_CHECK32(OP_ORA32 ); tmpv = REG_READ(op & 0x0f); OP_ORA (tmpv); break;
-      case 0x70: OP_CHECK32(OP_EORA32); tmpv = REG_READ(op & 0x0f); OP_EORA(tmpv); break;
-
-      /* OP a, (ri) */
-      case 0x11: tmpv = ptr1_read(op); OP_SUBA(tmpv); break;
-      case 0x31: tmpv = ptr1_read(op); OP_CMPA(tmpv); break;
-      case 0x41: tmpv = ptr1_read(op); OP_ADDA(tmpv); break;
-      case 0x51: tmpv = ptr1_read(op); OP_ANDA(tmpv); break;
-      case 0x61: tmpv = ptr1_read(op); OP_ORA (tmpv); break;
-      case 0x71: tmpv = ptr1_read(op); OP_EORA(tmpv); break;
-
-      /* OP a, adr */
-      case 0x03: tmpv = ssp->mem.RAM[op & 0x1ff]; OP_LDA (tmpv); break;
-      case 0x13: tmpv = ssp->mem.RAM[op & 0x1ff]; OP_SUBA(tmpv); break;
-      case 0x33: tmpv = ssp->mem.RAM[op & 0x1ff]; OP_CMPA(tmpv); break;
-      case 0x43: tmpv = ssp->mem.RAM[op & 0x1ff]; OP_ADDA(tmpv); break;
-      case 0x53: tmpv = ssp->mem.RAM[op & 0x1ff]; OP_ANDA(tmpv); break;
-      case 0x63: tmpv = ssp->mem.RAM[op & 0x1ff]; OP_ORA (tmpv); break;
-      case 0x73: tmpv = ssp->mem.RAM[op & 0x1ff]; OP_EORA(tmpv); break;
-
-      /* OP a, imm */
-      case 0x14: tmpv = *PC++; OP_SUBA(tmpv); break;
-      case 0x34: tmpv = *PC++; OP_CMPA(tmpv); break;
-      case 0x44: tmpv = *PC++; OP_ADDA(tmpv); break;
-      case 0x54: tmpv = *PC++; OP_ANDA(tmpv); break;
-      case 0x64: tmpv = *PC++; OP_ORA (tmpv); break;
-      case 0x74: tmpv = *PC++; OP_EORA(tmpv); break;
-
-      /* OP a, ((ri)) */
-      case 0x15: tmpv = ptr2_read(op); OP_SUBA(tmpv); break;
-      case 0x35: tmpv = ptr2_read(op); OP_CMPA(tmpv); break;
-      case 0x45: tmpv = ptr2_read(op); OP_ADDA(tmpv); break;
-      case 0x55: tmpv = ptr2_read(op); OP_ANDA(tmpv); break;
-      case 0x65: tmpv = ptr2_read(op); OP_ORA (tmpv); break;
-      case 0x75: tmpv = ptr2_read(op); OP_EORA(tmpv); break;
-
-      /* OP a, ri */
-      case 0x19: tmpv = rIJ[IJind]; OP_SUBA(tmpv); break;
-      case 0x39: tmpv = rIJ[IJind]; OP_CMPA(tmpv); break;
-      case 0x49: tmpv = rIJ[IJind]; OP_ADDA(tmpv); break;
-      case 0x59: tmpv = rIJ[IJind]; OP_ANDA(tmpv); break;
-      case 0x69: tmpv = rIJ[IJind]; OP_ORA (tmpv); break;
-      case 0x79: tmpv = rIJ[IJind]; OP_EORA(tmpv); break;
-
-      /* OP simm */
-      case 0x1c:
-        OP_SUBA(op & 0xff);
-#ifdef LOG_SVP
-        if (op&0x100) elprintf(EL_SVP|EL_ANOMALY, "FIXME: simm with upper bit set");
-#endif
-        break;
-      case 0x3c:
-        OP_CMPA(op & 0xff); 
-#ifdef LOG_SVP
-        if (op&0x100) elprintf(EL_SVP|EL_ANOMALY, "FIXME: simm with upper bit set");
-#endif
-        break;
-      case 0x4c:
-        OP_ADDA(op & 0xff);
-#ifdef LOG_SVP
-        if (op&0x100) elprintf(EL_SVP|EL_ANOMALY, "FIXME: simm with upper bit set");
-#endif
-        break;
-      /* MAME code only does LSB of top word, but this looks wrong to me. */
-      case 0x5c:
-        OP_ANDA(op & 0xff);
-#ifdef LOG_SVP
-        if (op&0x100) elprintf(EL_SVP|EL_ANOMALY, "FIXME: simm with upper bit set");
-#endif
-        break;
-      case 0x6c:
-        OP_ORA (op & 0xff);
-#ifdef LOG_SVP
-        if (op&0x100) elprintf(EL_SVP|EL_ANOMALY, "FIXME: simm with upper bit set");
-#endif
-        break;
-      case 0x7c:
-        OP_EORA(op & 0xff); 
-#ifdef LOG_SVP
-        if (op&0x100) elprintf(EL_SVP|EL_ANOMALY, "FIXME: simm with upper bit set");
-#endif
-        break;
+      /* ld a, adr */
+      case U_LDA_ADR: tmpv = ssp->mem.RAM[op & 0x1ff]; OP_LDA(tmpv); break;
+
+      /* OP a, xx */
+      SSP_ALU_CASES(U_SUB, OP_SUBA, OP_SUBA32)
+      SSP_ALU_CASES(U_CMP, OP_CMPA, OP_CMPA32)
+      SSP_ALU_CASES(U_ADD, OP_ADDA, OP_ADDA32)
+      SSP_ALU_CASES(U_AND, OP_ANDA, OP_ANDA32)
+      SSP_ALU_CASES(U_OR,  OP_ORA,  OP_ORA32)
+      SSP_ALU_CASES(U_EOR, OP_EORA, OP_EORA32)
 
       default:
 #ifdef LOG_SVP
-        elprintf(EL_ANOMALY|EL_SVP, "ssp FIXME unhandled op %04x @ %04x", op, GET_PPC_OFFS());
+        if (op) elprintf(EL_ANOMALY|EL_SVP, "ssp FIXME unhandled op %04x @ %04x", op, GET_PPC_OFFS());
 #endif
         break;
     }
@@ -1329,5 +1384,7 @@ void ssp1601_run(int cycles)
   if (ssp->gr[SSP_GR0].v != 0xffff0000)
     elprintf(EL_ANOMALY|EL_SVP, "ssp FIXME: REG 0 corruption! %08x", ssp->gr[SSP_GR0].v);
 #endif
+
+  PROFILE_END(PROFILE_SSP1601_RUN);
 }
 
@@ -12,7 +12,7 @@
 
 #include "shared.h"
 
-svp_t *svp = NULL;
+THREAD_CONTEXT svp_t *svp = NULL;
 
 void svp_init(void)
 {
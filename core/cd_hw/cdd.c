@@ -37,6 +37,20 @@
  ****************************************************************************************/
 #include "shared.h"
 
+#ifdef USE_CD_THREAD
+#ifdef DISABLE_MANY_OGG_OPEN_FILES
+#error "USE_CD_THREAD cannot be used with DISABLE_MANY_OGG_OPEN_FILES"
+#endif
+#include <pthread.h>
+#include <sched.h>
+#include <unistd.h>
+#endif
+
+#ifdef USE_CD_MMAP
+#include <sys/mman.h>
+#include <sys/stat.h>
+#endif
+
 #if defined(USE_LIBTREMOR) || defined(USE_LIBVORBIS)
 #define SUPPORTED_EXT 20
 #else
@@ -49,6 +63,72 @@
 /* CD tracks type (CD-DA by default) */
 #define TYPE_CDROM 0x01
 
+/* CD-ROM data sectors cache (see cdd_read_data) */
+#define CD_CACHE_SECTORS 64 /* cached sectors (power of 2) */
+#define CD_CACHE_BLOCK   16 /* sectors read at once from disc image */
+#define CD_CACHE_AHEAD   32 /* sectors prefetched ahead of current sector */
+
+typedef struct
+{
+  FILE *fd;         /* data track file */
+  int size;         /* data track sector size (2048 or 2352 bytes) */
+  int end;          /* data track end */
+  int last;         /* last read sector */
+  int dir;          /* read direction (1 or -1) */
+  int lba[CD_CACHE_SECTORS];  /* cached sectors (-1 if empty) */
+  uint8 *data;      /* cached sectors data (2048 bytes per sector) */
+  uint8 *block;     /* disc image read buffer */
+  uint32 hits;
+  uint32 misses;
+#ifdef USE_CD_THREAD
+  pthread_t thread;
+  pthread_mutex_t mutex;
+  pthread_cond_t cond;
+  uint8 *prefetch;  /* reader thread read buffer */
+  int running;
+  int quit;
+  int next;         /* next sector to be read by emulation */
+#endif
+} cd_cache_t;
+
+static THREAD_CONTEXT cd_cache_t cd_cache;
+
+#ifdef USE_CD_THREAD
+/* CD-DA tracks decoding pipeline (see cdd_read_audio) */
+#define CD_AUDIO_BUFFER 0x20000 /* decoded PCM ring buffer size (power of 2) */
+#define CD_AUDIO_CHUNK  0x1000  /* PCM bytes decoded at once */
+#define CD_AUDIO_SPIN_COUNT 0x1000
+
+typedef struct
+{
+  pthread_t thread;
+  pthread_mutex_t mutex;
+  pthread_cond_t cond;
+  int running;
+  int quit;
+  track_t *track;       /* streamed track (NULL if none) */
+  cdz_t *cdz;           /* streamed compressed disc image (NULL if not used) */
+  long pos;             /* streamed track position (PCM samples for VORBIS track, bytes otherwise) */
+  volatile unsigned int request;  /* stream position requests (emulation thread) */
+  volatile unsigned int ack;      /* handled stream position requests (decoder thread) */
+  volatile unsigned int head;     /* next decoded byte (decoder thread) */
+  volatile unsigned int tail;     /* next played byte (emulation thread) */
+  unsigned int start;             /* first decoded byte of current stream request (emulation thread) */
+  long tail_pos;                  /* stream position of next played byte, in bytes (emulation thread) */
+  volatile int eof;
+  volatile int sleeping;
+  uint8 *buffer;
+} cd_audio_t;
+
+static THREAD_CONTEXT cd_audio_t cd_audio;
+
+#define CD_CACHE_LOCK(c)   pthread_mutex_lock(&(c)->mutex)
+#define CD_CACHE_UNLOCK(c) pthread_mutex_unlock(&(c)->mutex)
+#else
+#define CD_CACHE_LOCK(c)
+#define CD_CACHE_UNLOCK(c)
+#endif
+
 /* BCD conversion lookup tables */
 static const uint8 lut_BCD_8[100] =
 {
@@ -175,6 +255,656 @@ static void ogg_free(int i)
 #endif
 #endif
 
+#ifdef USE_CD_MMAP
+/*--------------------------------------------------------------------------*/
+/* Memory-mapped disc image files                                           */
+/*--------------------------------------------------------------------------*/
+
+/* If you define USE_CD_MMAP in the makefile, uncompressed track files (BIN, ISO, WAV) and */
+/* subcode file are mapped into memory when disc is loaded, so that reading sectors does   */
+/* not require any system call and concurrent sessions share the same page cache pages.    */
+/* FILE reading position is emulated, reading past end of file behaves like fread.        */
+
+static uint8 *cdd_map_file(FILE *fd, long *size)
+{
+  struct stat st;
+  void *map;
+
+  if (fstat(fileno(fd), &st) || (st.st_size <= 0))
+  {
+    return NULL;
+  }
+
+  map = mmap(NULL, st.st_size, PROT_READ, MAP_SHARED, fileno(fd), 0);
+  if (map == MAP_FAILED)
+  {
+    return NULL;
+  }
+
+  /* disc images are mostly read sequentially */
+  madvise(map, st.st_size, MADV_SEQUENTIAL);
+
+  *size = st.st_size;
+  return (uint8 *)map;
+}
+
+static int cdd_map_read(uint8 *dst, int len, uint8 *map, long size, long *pos)
+{
+  if ((*pos < 0) || (*pos >= size))
+  {
+    return 0;
+  }
+
+  if (len > (size - *pos))
+  {
+    len = size - *pos;
+  }
+
+  memcpy(dst, map + *pos, len);
+  *pos += len;
+  return len;
+}
+#endif
+
+static void cdd_seek_subcode(int lba)
+{
+#ifdef USE_CD_MMAP
+  if (cdd.toc.subMap)
+  {
+    cdd.toc.subPos = lba * 96;
+    return;
+  }
+#endif
+
+  /* 96 bytes per sector */
+  fseek(cdd.toc.sub, lba * 96, SEEK_SET);
+}
+
+/*--------------------------------------------------------------------------*/
+/* CD-ROM data sectors cache                                                */
+/*--------------------------------------------------------------------------*/
+
+/* Data track sectors are read from disc image by blocks and kept in a small cache indexed */
+/* by LBA, so that sequential reads only access the file once every CD_CACHE_BLOCK sectors.  */
+/* If you define USE_CD_THREAD in the makefile, sectors following current sector (in current */
+/* read direction) are prefetched by a background thread and emulation only waits for file  */
+/* I/O on a cache miss. The reader thread uses pread() on the data track file descriptor, so */
+/* that the FILE position used by emulation (i.e. CD-DA tracks in the same file) is never   */
+/* modified behind its back.                                                                */
+
+static int cd_cache_read(cd_cache_t *cache, uint8 *buffer, int lba, int min, int count)
+{
+  int len;
+
+  /* do not read past data track end (at least one sector is always read) */
+  if ((lba + count) > cache->end)
+  {
+    count = cache->end - lba;
+    if (count < min)
+    {
+      count = min;
+    }
+  }
+
+#ifdef USE_CD_THREAD
+  len = pread(fileno(cache->fd), buffer, count * cache->size, (off_t)lba * cache->size);
+#else
+  fseek(cache->fd, lba * cache->size, SEEK_SET);
+  len = fread(buffer, 1, count * cache->size, cache->fd);
+#endif
+
+  /* return number of sectors with complete data (Mode 1 RAW sectors have a 16-byte header) */
+  if (len <= 0)
+  {
+    return 0;
+  }
+  if (cache->size == 2048)
+  {
+    return len / 2048;
+  }
+  return (len + (2352 - 2048 - 16)) / 2352;
+}
+
+static void cd_cache_store(cd_cache_t *cache, uint8 *buffer, int lba, int count)
+{
+  /* skip 16-byte header of Mode 1 RAW sectors */
+  if (cache->size == 2352)
+  {
+    buffer += 16;
+  }
+
+  while (count-- > 0)
+  {
+    int i = lba & (CD_CACHE_SECTORS - 1);
+    memcpy(cache->data + i * 2048, buffer, 2048);
+    cache->lba[i] = lba++;
+    buffer += cache->size;
+  }
+}
+
+#ifdef USE_CD_THREAD
+static void *cd_cache_thread(void *arg)
+{
+  cd_cache_t *cache = (cd_cache_t *)arg;
+
+  pthread_mutex_lock(&cache->mutex);
+
+  while (!cache->quit)
+  {
+    int i, lba, first, count;
+    int dir = cache->dir;
+
+    /* find first missing sector in prefetch window */
+    for (i=0, lba=cache->next; i<CD_CACHE_AHEAD; i++, lba+=dir)
+    {
+      if ((lba < 0) || (lba >= cache->end) || (cache->lba[lba & (CD_CACHE_SECTORS - 1)] != lba))
+      {
+        break;
+      }
+    }
+
+    if ((i == CD_CACHE_AHEAD) || (lba < 0) || (lba >= cache->end))
+    {
+      /* nothing to prefetch, wait for emulation to move prefetch window */
+      pthread_cond_wait(&cache->cond, &cache->mutex);
+      continue;
+    }
+
+    /* read sectors block (up to prefetch window end) */
+    count = CD_CACHE_AHEAD - i;
+    if (count > CD_CACHE_BLOCK)
+    {
+      count = CD_CACHE_BLOCK;
+    }
+    first = lba;
+    if (dir < 0)
+    {
+      first = lba - count + 1;
+      if (first < 0)
+      {
+        first = 0;
+      }
+      count = lba - first + 1;
+    }
+
+    pthread_mutex_unlock(&cache->mutex);
+    count = cd_cache_read(cache, cache->prefetch, first, count, count);
+    pthread_mutex_lock(&cache->mutex);
+
+    if (count <= 0)
+    {
+      /* read error, wait for emulation to move prefetch window */
+      if (!cache->quit)
+      {
+        pthread_cond_wait(&cache->cond, &cache->mutex);
+      }
+      continue;
+    }
+
+    cd_cache_store(cache, cache->prefetch, first, count);
+  }
+
+  pthread_mutex_unlock(&cache->mutex);
+
+  return NULL;
+}
+#endif
+
+static void cd_cache_open(cd_cache_t *cache, FILE *fd, int size, int end)
+{
+  memset(cache, 0, sizeof(cd_cache_t));
+  memset(cache->lba, 0xff, sizeof(cache->lba));
+  cache->fd = fd;
+  cache->size = size;
+  cache->end = end;
+  cache->dir = 1;
+
+  if (!fd)
+  {
+    return;
+  }
+
+  /* allocate cache buffers (sectors are read directly from file if this fails) */
+  cache->data = malloc(CD_CACHE_SECTORS * 2048);
+  cache->block = malloc(CD_CACHE_BLOCK * 2352);
+  if (!cache->data || !cache->block)
+  {
+    free(cache->data);
+    free(cache->block);
+    cache->data = cache->block = NULL;
+    return;
+  }
+
+#ifdef USE_CD_THREAD
+  pthread_mutex_init(&cache->mutex, NULL);
+  pthread_cond_init(&cache->cond, NULL);
+
+  /* start reader thread (sectors are only read on cache miss if this fails) */
+  cache->prefetch = malloc(CD_CACHE_BLOCK * 2352);
+  if (cache->prefetch && !pthread_create(&cache->thread, NULL, cd_cache_thread, cache))
+  {
+    cache->running = 1;
+  }
+#endif
+}
+
+static void cd_cache_close(cd_cache_t *cache)
+{
+#ifdef USE_CD_THREAD
+  if (cache->running)
+  {
+    pthread_mutex_lock(&cache->mutex);
+    cache->quit = 1;
+    pthread_cond_signal(&cache->cond);
+    pthread_mutex_unlock(&cache->mutex);
+    pthread_join(cache->thread, NULL);
+    cache->running = 0;
+  }
+  if (cache->data)
+  {
+    pthread_mutex_destroy(&cache->mutex);
+    pthread_cond_destroy(&cache->cond);
+  }
+  free(cache->prefetch);
+  cache->prefetch = NULL;
+#endif
+  free(cache->data);
+  free(cache->block);
+  cache->data = cache->block = NULL;
+  cache->fd = NULL;
+}
+
+void cdd_cache_stats(uint32 *hits, uint32 *misses)
+{
+  *hits = cd_cache.hits;
+  *misses = cd_cache.misses;
+}
+
+#ifdef USE_CD_THREAD
+/*--------------------------------------------------------------------------*/
+/* CD-DA tracks decoding pipeline                                           */
+/*--------------------------------------------------------------------------*/
+
+/* Audio tracks are decoded (VORBIS) or read (WAV, BIN) ahead of playback position by a */
+/* background thread into a single-producer / single-consumer ring buffer, so that decoding */
+/* time is not spent in audio_update. Each seek on emulation side is queued as a new stream */
+/* request: the decoder thread flushes the ring buffer and refills it from the new position, */
+/* while emulation waits for new samples before playing them. Seeking within samples still */
+/* held in ring buffer (e.g. when a state is restored) only moves playback position.       */
+/* Decoded PCM data is identical, fader and mixing remain on emulation side.               */
+
+static void *cd_audio_thread(void *arg)
+{
+  cd_audio_t *audio = (cd_audio_t *)arg;
+
+  pthread_mutex_lock(&audio->mutex);
+
+  while (!audio->quit)
+  {
+    track_t *track = audio->track;
+    cdz_t *cdz = audio->cdz;
+    unsigned int request = audio->request;
+    unsigned int offset;
+    long pos = audio->pos;
+    int len;
+
+    if (audio->ack != request)
+    {
+      /* flush ring buffer (emulation does not access it until request is acknowledged) */
+      audio->head = audio->tail;
+      audio->eof = 0;
+      __sync_synchronize();
+      audio->ack = request;
+
+#if defined(USE_LIBTREMOR) || defined(USE_LIBVORBIS)
+      if (track && track->vf.seekable)
+      {
+        /* seek VORBIS track to new position */
+        pthread_mutex_unlock(&audio->mutex);
+        ov_pcm_seek(&track->vf, pos);
+        pthread_mutex_lock(&audio->mutex);
+      }
+#endif
+      continue;
+    }
+
+    /* wait for new request or free space in ring buffer */
+    if (!track || audio->eof || ((audio->head - audio->tail) > (CD_AUDIO_BUFFER - CD_AUDIO_CHUNK)))
+    {
+      audio->sleeping = 1;
+      __sync_synchronize();
+      if ((audio->ack == audio->request) && !audio->quit &&
+          (!track || audio->eof || ((audio->head - audio->tail) > (CD_AUDIO_BUFFER - CD_AUDIO_CHUNK))))
+      {
+        pthread_cond_wait(&audio->cond, &audio->mutex);
+      }
+      audio->sleeping = 0;
+      continue;
+    }
+
+    offset = audio->head & (CD_AUDIO_BUFFER - 1);
+    pthread_mutex_unlock(&audio->mutex);
+
+    /* decode next chunk (within ring buffer limit) */
+    len = CD_AUDIO_CHUNK;
+    if ((offset + len) > CD_AUDIO_BUFFER)
+    {
+      len = CD_AUDIO_BUFFER - offset;
+    }
+#if defined(USE_LIBTREMOR) || defined(USE_LIBVORBIS)
+    if (track->vf.seekable)
+    {
+      do
+      {
+#ifdef USE_LIBVORBIS
+        len = ov_read(&track->vf, (char *)(audio->buffer + offset), len, 0, 2, 1, 0);
+#else
+        len = ov_read(&track->vf, (char *)(audio->buffer + offset), len, 0);
+#endif
+      }
+      while (len == OV_HOLE);
+    }
+    else
+#endif
+    if (cdz)
+    {
+      len = cdz_read(cdz, audio->buffer + offset, pos, len);
+    }
+    else
+#ifdef USE_CD_MMAP
+    if (track->map)
+    {
+      long mapPos = pos;
+      len = cdd_map_read(audio->buffer + offset, len, track->map, track->mapSize, &mapPos);
+    }
+    else
+#endif
+    {
+      len = pread(fileno(track->fd), audio->buffer + offset, len, pos);
+    }
+
+    pthread_mutex_lock(&audio->mutex);
+
+    /* discard decoded samples if a new stream position was requested meanwhile */
+    if (audio->request == request)
+    {
+      if (len > 0)
+      {
+#if defined(USE_LIBTREMOR) || defined(USE_LIBVORBIS)
+        if (!track->vf.seekable)
+#endif
+        {
+          audio->pos = pos + len;
+        }
+        __sync_synchronize();
+        audio->head += len;
+      }
+      else
+      {
+        audio->eof = 1;
+      }
+    }
+  }
+
+  pthread_mutex_unlock(&audio->mutex);
+
+  return NULL;
+}
+
+static void cd_audio_wakeup(cd_audio_t *audio)
+{
+  __sync_synchronize();
+  if (audio->sleeping)
+  {
+    pthread_mutex_lock(&audio->mutex);
+    pthread_cond_signal(&audio->cond);
+    pthread_mutex_unlock(&audio->mutex);
+  }
+}
+
+static int cd_audio_seek(cd_audio_t *audio, track_t *track, int lba)
+{
+  track_t *stream;
+  long pos, delta;
+
+  if (!audio->running)
+  {
+    /* start decoder thread on first seek */
+    memset(audio, 0, sizeof(cd_audio_t));
+    audio->buffer = malloc(CD_AUDIO_BUFFER);
+    if (!audio->buffer)
+    {
+      return 0;
+    }
+    pthread_mutex_init(&audio->mutex, NULL);
+    pthread_cond_init(&audio->cond, NULL);
+    if (pthread_create(&audio->thread, NULL, cd_audio_thread, audio))
+    {
+      pthread_mutex_destroy(&audio->mutex);
+      pthread_cond_destroy(&audio->cond);
+      free(audio->buffer);
+      audio->buffer = NULL;
+      return 0;
+    }
+    audio->running = 1;
+  }
+
+#if defined(USE_LIBTREMOR) || defined(USE_LIBVORBIS)
+  if (track->vf.seekable)
+  {
+    /* VORBIS AUDIO track (position in samples) */
+    stream = track;
+    pos = (lba * 588) - track->offset;
+    delta = (pos * 4) - audio->tail_pos;
+  }
+  else if (track->vf.datasource)
+  {
+    /* unseekable VORBIS track is read synchronously */
+    stream = NULL;
+    pos = delta = 0;
+  }
+  else
+#endif
+  if (!track->fd)
+  {
+    /* no audio file */
+    stream = NULL;
+    pos = delta = 0;
+  }
+  else
+  {
+    /* PCM AUDIO track (position in bytes) */
+    stream = track;
+    pos = (lba * 2352) - track->offset;
+    delta = pos - audio->tail_pos;
+  }
+
+  pthread_mutex_lock(&audio->mutex);
+
+  /* keep buffered samples if new position is within decoded data of current stream (e.g. when a state is restored) */
+  if (stream && (stream == audio->track) && (audio->ack == audio->request))
+  {
+    /* decoded bytes ahead of and behind played position (oldest ones may be overwritten by next decoded chunk) */
+    long ahead = audio->head - audio->tail;
+    long behind = CD_AUDIO_BUFFER - CD_AUDIO_CHUNK - ahead;
+    if (behind < 0)
+    {
+      behind = 0;
+    }
+    else if ((unsigned int)(audio->tail - audio->start) < (unsigned long)behind)
+    {
+      behind = audio->tail - audio->start;
+    }
+
+    if ((delta <= ahead) && (delta >= -behind))
+    {
+      audio->tail += delta;
+      audio->tail_pos += delta;
+      pthread_cond_signal(&audio->cond);
+      pthread_mutex_unlock(&audio->mutex);
+      return 1;
+    }
+  }
+
+  if (stream)
+  {
+    audio->track = stream;
+    audio->pos = pos;
+    audio->tail_pos = pos;
+#if defined(USE_LIBTREMOR) || defined(USE_LIBVORBIS)
+    if (track->vf.seekable)
+    {
+      audio->tail_pos = pos * 4;
+    }
+    else
+#endif
+    {
+      audio->cdz = cdd.toc.cdz;
+    }
+  }
+  else
+  {
+    audio->track = NULL;
+  }
+
+  /* ring buffer is flushed by decoder thread (played position does not change until then) */
+  audio->start = audio->tail;
+  audio->request++;
+  pthread_cond_signal(&audio->cond);
+  pthread_mutex_unlock(&audio->mutex);
+
+  return (audio->track != NULL);
+}
+
+static int cd_audio_read(cd_audio_t *audio, track_t *track, uint8 *dst, int len)
+{
+  unsigned int spin = 0;
+
+  /* check track is being streamed */
+  if (!audio->running || (audio->track != track))
+  {
+    return 0;
+  }
+
+  while (len > 0)
+  {
+    if (audio->ack == audio->request)
+    {
+      unsigned int avail;
+      __sync_synchronize();
+      avail = audio->head - audio->tail;
+
+      if (avail)
+      {
+        unsigned int offset = audio->tail & (CD_AUDIO_BUFFER - 1);
+
+        /* copy available samples (within ring buffer limit) */
+        if (avail > (unsigned int)len)
+        {
+          avail = len;
+        }
+        if ((offset + avail) > CD_AUDIO_BUFFER)
+        {
+          avail = CD_AUDIO_BUFFER - offset;
+        }
+        memcpy(dst, audio->buffer + offset, avail);
+        dst += avail;
+        len -= avail;
+        audio->tail_pos += avail;
+        __sync_synchronize();
+        audio->tail += avail;
+        cd_audio_wakeup(audio);
+        spin = 0;
+        continue;
+      }
+
+      /* end of file reached (remaining samples are left unmodified) */
+      if (audio->eof)
+      {
+        /* last samples may have been added before end of file was flagged */
+        __sync_synchronize();
+        if (audio->head == audio->tail)
+        {
+          break;
+        }
+        continue;
+      }
+    }
+
+    /* wait for decoder thread */
+    cd_audio_wakeup(audio);
+    if (++spin > CD_AUDIO_SPIN_COUNT)
+    {
+      sched_yield();
+    }
+  }
+
+  return 1;
+}
+
+static void cd_audio_stop(cd_audio_t *audio)
+{
+  if (audio->running)
+  {
+    pthread_mutex_lock(&audio->mutex);
+    audio->quit = 1;
+    pthread_cond_signal(&audio->cond);
+    pthread_mutex_unlock(&audio->mutex);
+    pthread_join(audio->thread, NULL);
+    pthread_mutex_destroy(&audio->mutex);
+    pthread_cond_destroy(&audio->cond);
+    free(audio->buffer);
+    audio->buffer = NULL;
+    audio->running = 0;
+  }
+}
+#endif
+
+static void cdd_seek_audio(int index, int lba)
+{
+#ifdef USE_CD_THREAD
+  /* audio track is read by decoder thread */
+  if (cd_audio_seek(&cd_audio, &cdd.toc.tracks[index], lba))
+  {
+    return;
+  }
+#endif
+
+#if defined(USE_LIBTREMOR) || defined(USE_LIBVORBIS)
+  if (cdd.toc.tracks[index].vf.seekable)
+  {
+    /* VORBIS AUDIO track */
+    ov_pcm_seek(&cdd.toc.tracks[index].vf, (lba * 588) - cdd.toc.tracks[index].offset);
+  }
+  else
+#endif
+  if (cdd.toc.tracks[index].fd)
+  {
+    /* PCM AUDIO track */
+    if (cdd.toc.cdz)
+    {
+      /* negative offsets are ignored, like fseek */
+      if ((lba * 2352) >= cdd.toc.tracks[index].offset)
+      {
+        cdd.toc.cdz->pos = (lba * 2352) - cdd.toc.tracks[index].offset;
+      }
+      return;
+    }
+#ifdef USE_CD_MMAP
+    if (cdd.toc.tracks[index].map)
+    {
+      /* negative offsets are ignored, like fseek */
+      if ((lba * 2352) >= cdd.toc.tracks[index].offset)
+      {
+        cdd.toc.tracks[index].mapPos = (lba * 2352) - cdd.toc.tracks[index].offset;
+      }
+      return;
+    }
+#endif
+    fseek(cdd.toc.tracks[index].fd, (lba * 2352) - cdd.toc.tracks[index].offset, SEEK_SET);
+  }
+}
+
 void cdd_init(int samplerate)
 {
   /* CD-DA is running by default at 44100 Hz */
@@ -255,8 +985,7 @@ int cdd_context_load(uint8 *state)
   /* seek to current subcode position */
   if (cdd.toc.sub)
   {
-    /* 96 bytes per sector */
-    fseek(cdd.toc.sub, lba * 96, SEEK_SET);
+    cdd_seek_subcode(lba);
   }
 
   /* seek to current track position */
@@ -265,21 +994,19 @@ int cdd_context_load(uint8 *state)
     /* DATA track */
     fseek(cdd.toc.tracks[cdd.index].fd, lba * cdd.sectorSize, SEEK_SET);
   }
-#if defined(USE_LIBTREMOR) || defined(USE_LIBVORBIS)
-  else if (cdd.toc.tracks[cdd.index].vf.seekable)
+  else
   {
+#if defined(USE_LIBTREMOR) || defined(USE_LIBVORBIS)
 #ifdef DISABLE_MANY_OGG_OPEN_FILES
-    /* VORBIS file need to be opened first */
-    ov_open(cdd.toc.tracks[cdd.index].fd,&cdd.toc.tracks[cdd.index].vf,0,0);
+    if (cdd.toc.tracks[cdd.index].vf.seekable)
+    {
+      /* VORBIS file need to be opened first */
+      ov_open(cdd.toc.tracks[cdd.index].fd,&cdd.toc.tracks[cdd.index].vf,0,0);
+    }
 #endif
-    /* VORBIS AUDIO track */
-    ov_pcm_seek(&cdd.toc.tracks[cdd.index].vf, (lba * 588) - cdd.toc.tracks[cdd.index].offset);
-  }
 #endif
-  else if (cdd.toc.tracks[cdd.index].fd)
-  {
-    /* PCM AUDIO track */
-    fseek(cdd.toc.tracks[cdd.index].fd, (lba * 2352) - cdd.toc.tracks[cdd.index].offset, SEEK_SET);
+    /* AUDIO track */
+    cdd_seek_audio(cdd.index, lba);
   }
 
   return bufferptr;
@@ -305,8 +1032,37 @@ int cdd_load(char *filename, char *header)
   /* save a copy of base filename */
   strncpy(fname, filename, 256);
 
+  /* look for compressed disc image */
+  cdd.toc.cdz = cdz_open(fd);
+  if (cdd.toc.cdz)
+  {
+    int i;
+
+    /* initialize TOC (all tracks are read from the same file) */
+    for (i=0; i<cdd.toc.cdz->last; i++)
+    {
+      cdd.toc.tracks[i].fd = cdd.toc.cdz->tracks[i].file ? fd : NULL;
+      cdd.toc.tracks[i].start = cdd.toc.cdz->tracks[i].start;
+      cdd.toc.tracks[i].end = cdd.toc.cdz->tracks[i].end;
+      cdd.toc.tracks[i].offset = cdd.toc.cdz->tracks[i].offset;
+      cdd.toc.tracks[i].type = cdd.toc.cdz->tracks[i].type;
+    }
+    cdd.toc.last = cdd.toc.cdz->last;
+    cdd.toc.end = cdd.toc.cdz->end;
+    cdd.sectorSize = cdd.toc.cdz->sectorSize;
+
+    /* read CD image header + security code */
+    if (cdd.toc.tracks[0].type)
+    {
+      cdz_read(cdd.toc.cdz, (uint8 *)header, (cdd.sectorSize == 2048) ? 0 : 0x10, 0x210);
+    }
+
+    /* no CUE file */
+    fd = NULL;
+  }
+
   /* check loaded file extension */
-  if (memcmp(".cue", &filename[strlen(filename) - 4], 4) && memcmp(".CUE", &filename[strlen(filename) - 4], 4))
+  else if (memcmp(".cue", &filename[strlen(filename) - 4], 4) && memcmp(".CUE", &filename[strlen(filename) - 4], 4))
   {
     int len;
 
@@ -926,6 +1682,40 @@ int cdd_load(char *filename, char *header)
     strncpy(&fname[strlen(fname) - 4], ".sub", 4);
     cdd.toc.sub = fopen(fname, "rb");
 
+#ifdef USE_CD_MMAP
+    /* map uncompressed track files & subcode file into memory */
+    {
+      int i;
+      for (i=0; i<cdd.toc.last; i++)
+      {
+#if defined(USE_LIBTREMOR) || defined(USE_LIBVORBIS)
+        if (cdd.toc.tracks[i].vf.datasource)
+        {
+          continue;
+        }
+#endif
+        if (cdd.toc.tracks[i].fd && !cdd.toc.cdz)
+        {
+          /* check if single file is used for consecutive tracks */
+          if ((i > 0) && (cdd.toc.tracks[i].fd == cdd.toc.tracks[i-1].fd))
+          {
+            cdd.toc.tracks[i].map = cdd.toc.tracks[i-1].map;
+            cdd.toc.tracks[i].mapSize = cdd.toc.tracks[i-1].mapSize;
+          }
+          else
+          {
+            cdd.toc.tracks[i].map = cdd_map_file(cdd.toc.tracks[i].fd, &cdd.toc.tracks[i].mapSize);
+          }
+        }
+      }
+
+      if (cdd.toc.sub)
+      {
+        cdd.toc.subMap = cdd_map_file(cdd.toc.sub, &cdd.toc.subSize);
+      }
+    }
+#endif
+
     /* return 1 if loaded file is CD image file */
     return (isCDfile);
   }
@@ -940,6 +1730,35 @@ void cdd_unload(void)
   {
     int i;
 
+    /* release data track cache before closing files */
+    cd_cache_close(&cd_cache);
+#ifdef USE_CD_THREAD
+    cd_audio_stop(&cd_audio);
+#endif
+
+    /* release compressed disc image */
+    if (cdd.toc.cdz)
+    {
+      cdz_close(cdd.toc.cdz);
+    }
+
+#ifdef USE_CD_MMAP
+    /* unmap track files */
+    for (i=0; i<cdd.toc.last; i++)
+    {
+      if (cdd.toc.tracks[i].map && ((i == 0) || (cdd.toc.tracks[i].map != cdd.toc.tracks[i-1].map)))
+      {
+        munmap(cdd.toc.tracks[i].map, cdd.toc.tracks[i].mapSize);
+      }
+    }
+
+    /* unmap subcode file */
+    if (cdd.toc.subMap)
+    {
+      munmap(cdd.toc.subMap, cdd.toc.subSize);
+    }
+#endif
+
     /* close CD tracks */
     for (i=0; i<cdd.toc.last; i++)
     {
@@ -986,6 +1805,83 @@ void cdd_read_data(uint8 *dst)
   /* only allow reading (first) CD-ROM track sectors */
   if (cdd.toc.tracks[cdd.index].type && (cdd.lba >= 0))
   {
+    cd_cache_t *cache = &cd_cache;
+    int lba = cdd.lba;
+    int i = lba & (CD_CACHE_SECTORS - 1);
+
+    if (cdd.toc.cdz)
+    {
+      /* read sector data from compressed image (Mode 1 RAW data: skip 16-byte header) */
+      cdz_read(cdd.toc.cdz, dst, (cdd.sectorSize == 2048) ? (lba * 2048) : (lba * 2352 + 16), 2048);
+      return;
+    }
+
+#ifdef USE_CD_MMAP
+    if (cdd.toc.tracks[0].map)
+    {
+      /* read sector data directly from mapped file (Mode 1 RAW data: skip 16-byte header) */
+      long pos = (cdd.sectorSize == 2048) ? (lba * 2048) : (lba * 2352 + 16);
+      cdd_map_read(dst, 2048, cdd.toc.tracks[0].map, cdd.toc.tracks[0].mapSize, &pos);
+      return;
+    }
+#endif
+
+    /* initialize cache on first access to data track */
+    if (cache->fd != cdd.toc.tracks[0].fd)
+    {
+      cd_cache_close(cache);
+      cd_cache_open(cache, cdd.toc.tracks[0].fd, cdd.sectorSize, cdd.toc.tracks[0].end);
+    }
+
+    if (cache->data)
+    {
+      CD_CACHE_LOCK(cache);
+
+      /* update read direction */
+      if (lba != cache->last)
+      {
+        cache->dir = (lba < cache->last) ? -1 : 1;
+        cache->last = lba;
+      }
+
+      if (cache->lba[i] != lba)
+      {
+        /* cache miss: read sectors block synchronously */
+        int first = (cache->dir > 0) ? lba : (lba - CD_CACHE_BLOCK + 1);
+        if (first < 0) first = 0;
+        cache->misses++;
+        CD_CACHE_UNLOCK(cache);
+        i = cd_cache_read(cache, cache->block, first, lba - first + 1, CD_CACHE_BLOCK);
+        CD_CACHE_LOCK(cache);
+        cd_cache_store(cache, cache->block, first, i);
+        i = lba & (CD_CACHE_SECTORS - 1);
+      }
+      else
+      {
+        cache->hits++;
+      }
+
+      if (cache->lba[i] == lba)
+      {
+        /* copy sector data from cache */
+        memcpy(dst, cache->data + i * 2048, 2048);
+
+#ifdef USE_CD_THREAD
+        /* wake up reader thread if prefetch window moved */
+        if (cache->next != (lba + cache->dir))
+        {
+          cache->next = lba + cache->dir;
+          pthread_cond_signal(&cache->cond);
+        }
+#endif
+        CD_CACHE_UNLOCK(cache);
+        return;
+      }
+
+      CD_CACHE_UNLOCK(cache);
+    }
+
+    /* incomplete sector (or no cache available): read directly from file */
     /* seek current track sector */
     if (cdd.sectorSize == 2048)
     {
@@ -1009,6 +1905,8 @@ void cdd_read_audio(unsigned int samples)
   int16 l = cdd.audio[0];
   int16 r = cdd.audio[1];
 
+  PROFILE_BEGIN(PROFILE_CDD_READ_AUDIO);
+
   /* get number of internal clocks (samples) needed */
   samples = blip_clocks_needed(snd.blips[2][0], samples);
 
@@ -1030,6 +1928,13 @@ void cdd_read_audio(unsigned int samples)
       int len, done = 0;
       int16 *ptr = (int16 *) (cdc.ram);
       samples = samples * 4;
+#ifdef USE_CD_THREAD
+      /* samples already decoded by decoder thread */
+      if (cd_audio_read(&cd_audio, &cdd.toc.tracks[cdd.index], cdc.ram, samples))
+      {
+        done = samples;
+      }
+#endif
       while (done < samples)
       {
 #ifdef USE_LIBVORBIS
@@ -1091,7 +1996,25 @@ void cdd_read_audio(unsigned int samples)
 #else
       uint8 *ptr = cdc.ram;
 #endif
-      fread(cdc.ram, 1, samples * 4, cdd.toc.tracks[cdd.index].fd);
+#ifdef USE_CD_THREAD
+      /* samples already read by decoder thread */
+      if (!cd_audio_read(&cd_audio, &cdd.toc.tracks[cdd.index], cdc.ram, samples * 4))
+#endif
+      {
+        if (cdd.toc.cdz)
+        {
+          cdd.toc.cdz->pos += cdz_read(cdd.toc.cdz, cdc.ram, cdd.toc.cdz->pos, samples * 4);
+        }
+        else
+#ifdef USE_CD_MMAP
+        if (cdd.toc.tracks[cdd.index].map)
+        {
+          cdd_map_read(cdc.ram, samples * 4, cdd.toc.tracks[cdd.index].map, cdd.toc.tracks[cdd.index].mapSize, &cdd.toc.tracks[cdd.index].mapPos);
+        }
+        else
+#endif
+        fread(cdc.ram, 1, samples * 4, cdd.toc.tracks[cdd.index].fd);
+      }
 
       /* process 16-bit (little-endian) stereo samples */
       for (i=0; i<samples; i++)
@@ -1162,6 +2085,8 @@ void cdd_read_audio(unsigned int samples)
   /* end of Blip Buffer timeframe */
   blip_end_frame(snd.blips[2][0], samples);
   blip_end_frame(snd.blips[2][1], samples);
+
+  PROFILE_END(PROFILE_CDD_READ_AUDIO);
 }
 
 static void cdd_read_subcode(void)
@@ -1176,6 +2101,13 @@ static void cdd_read_subcode(void)
   index = (scd.regs[0x68>>1].byte.l + 0x100) >> 1;
 
   /* read interleaved subcode data from .sub file (12 x 8-bit of P subchannel first, then Q subchannel, etc) */
+#ifdef USE_CD_MMAP
+  if (cdd.toc.subMap)
+  {
+    cdd_map_read(subc, 96, cdd.toc.subMap, cdd.toc.subSize, &cdd.toc.subPos);
+  }
+  else
+#endif
   fread(subc, 1, 96, cdd.toc.sub);
 
   /* convert back to raw subcode format (96 bytes with 8 x P-W subchannel bits per byte) */
@@ -1300,20 +2232,15 @@ void cdd_update(void)
 
       /* seek to next audio track start */
 #if defined(USE_LIBTREMOR) || defined(USE_LIBVORBIS)
+#ifdef DISABLE_MANY_OGG_OPEN_FILES
       if (cdd.toc.tracks[cdd.index].vf.seekable)
       {
-#ifdef DISABLE_MANY_OGG_OPEN_FILES
         /* VORBIS file need to be opened first */
         ov_open(cdd.toc.tracks[cdd.index].fd,&cdd.toc.tracks[cdd.index].vf,0,0);
-#endif
-        ov_pcm_seek(&cdd.toc.tracks[cdd.index].vf, (cdd.toc.tracks[cdd.index].start * 588) - cdd.toc.tracks[cdd.index].offset);
       }
-      else
+#endif
 #endif 
-      if (cdd.toc.tracks[cdd.index].fd)
-      {
-        fseek(cdd.toc.tracks[cdd.index].fd, (cdd.toc.tracks[cdd.index].start * 2352) - cdd.toc.tracks[cdd.index].offset, SEEK_SET);
-      }
+      cdd_seek_audio(cdd.index, cdd.toc.tracks[cdd.index].start);
     }
   }
 
@@ -1390,7 +2317,7 @@ void cdd_update(void)
     /* seek to current subcode position */
     if (cdd.toc.sub)
     {
-      fseek(cdd.toc.sub, cdd.lba * 96, SEEK_SET);
+      cdd_seek_subcode(cdd.lba);
     }
 
     /* seek to current track position */
@@ -1399,25 +2326,20 @@ void cdd_update(void)
       /* DATA track */
       fseek(cdd.toc.tracks[0].fd, cdd.lba * cdd.sectorSize, SEEK_SET);
     }
-#if defined(USE_LIBTREMOR) || defined(USE_LIBVORBIS)
-    else if (cdd.toc.tracks[cdd.index].vf.seekable)
+    else
     {
+#if defined(USE_LIBTREMOR) || defined(USE_LIBVORBIS)
 #ifdef DISABLE_MANY_OGG_OPEN_FILES
       /* check if a new track is being played */
-      if (!cdd.toc.tracks[cdd.index].vf.datasource)
+      if (cdd.toc.tracks[cdd.index].vf.seekable && !cdd.toc.tracks[cdd.index].vf.datasource)
       {
         /* VORBIS file need to be opened first */
         ov_open(cdd.toc.tracks[cdd.index].fd,&cdd.toc.tracks[cdd.index].vf,0,0);
       }
 #endif
-      /* VORBIS AUDIO track */
-      ov_pcm_seek(&cdd.toc.tracks[cdd.index].vf, (cdd.lba * 588) - cdd.toc.tracks[cdd.index].offset);
-    }
 #endif 
-    else if (cdd.toc.tracks[cdd.index].fd)
-    {
-      /* PCM AUDIO track */
-      fseek(cdd.toc.tracks[cdd.index].fd, (cdd.lba * 2352) - cdd.toc.tracks[cdd.index].offset, SEEK_SET);
+      /* AUDIO track */
+      cdd_seek_audio(cdd.index, cdd.lba);
     }
   }
 }
@@ -1618,7 +2540,7 @@ void cdd_process(void)
       /* seek to current subcode position */
       if (cdd.toc.sub)
       {
-        fseek(cdd.toc.sub, lba * 96, SEEK_SET);
+        cdd_seek_subcode(lba);
       }
       
       /* seek to current track position */
@@ -1627,17 +2549,10 @@ void cdd_process(void)
         /* DATA track */
         fseek(cdd.toc.tracks[0].fd, lba * cdd.sectorSize, SEEK_SET);
       }
-#if defined(USE_LIBTREMOR) || defined(USE_LIBVORBIS)
-      else if (cdd.toc.tracks[index].vf.seekable)
-      {
-        /* VORBIS AUDIO track */
-        ov_pcm_seek(&cdd.toc.tracks[index].vf, (lba * 588) - cdd.toc.tracks[index].offset);
-      }
-#endif 
-      else if (cdd.toc.tracks[index].fd)
+      else
       {
-        /* PCM AUDIO track */
-        fseek(cdd.toc.tracks[index].fd, (lba * 2352) - cdd.toc.tracks[index].offset, SEEK_SET);
+        /* AUDIO track */
+        cdd_seek_audio(index, lba);
       }
 
       /* no audio track playing (yet) */
@@ -1719,23 +2634,16 @@ void cdd_process(void)
         /* DATA track */
         fseek(cdd.toc.tracks[0].fd, lba * cdd.sectorSize, SEEK_SET);
       }
-#if defined(USE_LIBTREMOR) || defined(USE_LIBVORBIS)
-      else if (cdd.toc.tracks[index].vf.seekable)
-      {
-        /* VORBIS AUDIO track */
-        ov_pcm_seek(&cdd.toc.tracks[index].vf, (lba * 588) - cdd.toc.tracks[index].offset);
-      }
-#endif 
-      else if (cdd.toc.tracks[index].fd)
+      else
       {
-        /* PCM AUDIO track */
-        fseek(cdd.toc.tracks[index].fd, (lba * 2352) - cdd.toc.tracks[index].offset, SEEK_SET);
+        /* AUDIO track */
+        cdd_seek_audio(index, lba);
       }
 
       /* seek to current subcode position */
       if (cdd.toc.sub)
       {
-        fseek(cdd.toc.sub, lba * 96, SEEK_SET);
+        cdd_seek_subcode(lba);
       }
 
       /* no audio track playing */
@@ -39,6 +39,7 @@
 #define _HW_CDD_
 
 #include "blip_buf.h"
+#include "cdz.h"
 
 #if defined(USE_LIBVORBIS)
 #include <vorbis/vorbisfile.h>
@@ -71,6 +72,11 @@ typedef struct
   int start;
   int end;
   int type;
+#ifdef USE_CD_MMAP
+  uint8 *map;     /* memory-mapped track file (NULL if not mapped) */
+  long mapSize;   /* track file size */
+  long mapPos;    /* track file reading position */
+#endif
 } track_t; 
 
 /* CD TOC */
@@ -80,6 +86,12 @@ typedef struct
   int last;
   track_t tracks[CD_MAX_TRACKS];
   FILE *sub;
+  cdz_t *cdz;     /* compressed disc image (NULL if not used) */
+#ifdef USE_CD_MMAP
+  uint8 *subMap;  /* memory-mapped subcode file (NULL if not mapped) */
+  long subSize;   /* subcode file size */
+  long subPos;    /* subcode file reading position */
+#endif
 } toc_t; 
 
 /* CDD hardware */
@@ -106,6 +118,7 @@ extern int cdd_context_load(uint8 *state);
 extern int cdd_load(char *filename, char *header);
 extern void cdd_unload(void);
 extern void cdd_read_data(uint8 *dst);
+extern void cdd_cache_stats(uint32 *hits, uint32 *misses);
 extern void cdd_read_audio(unsigned int samples);
 extern void cdd_update(void);
 extern void cdd_process(void);
@@ -0,0 +1,908 @@
+/***************************************************************************************
+ *  Genesis Plus
+ *  Compressed CD image (CDZ) support
+ *
+ *  Copyright (C) 2015  Eke-Eke (Genesis Plus GX)
+ *
+ *  Redistribution and use of this code or any derivative works are permitted
+ *  provided that the following conditions are met:
+ *
+ *   - Redistributions may not be sold, nor may they be used in a commercial
+ *     product or activity.
+ *
+ *   - Redistributions that are modified from the original source must include the
+ *     complete source code, including the source code for all components used by a
+ *     binary built from the modified sources. However, as a special exception, the
+ *     source code distributed need not include anything that is normally distributed
+ *     (in either source or binary form) with the major components (compiler, kernel,
+ *     and so on) of the operating system on which the executable runs, unless that
+ *     component itself accompanies the executable.
+ *
+ *   - Redistributions must reproduce the above copyright notice, this list of
+ *     conditions and the following disclaimer in the documentation and/or other
+ *     materials provided with the distribution.
+ *
+ *  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ *  AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ *  IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ *  ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE
+ *  LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ *  CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ *  SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ *  INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ *  CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ *  ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ *  POSSIBILITY OF SUCH DAMAGE.
+ *
+ ****************************************************************************************/
+#include "shared.h"
+
+#ifdef USE_CD_THREAD
+#include <unistd.h>
+#endif
+
+/* CDZ images store the data read by CD drive emulation (DATA track sectors, then PCM AUDIO */
+/* tracks sectors) as a single data stream, split into fixed-size hunks that are compressed */
+/* independently, so that any position can be read by only decompressing one hunk. Recently */
+/* used hunks are kept decompressed in a small LRU cache.                                   */
+/*                                                                                          */
+/* File layout (all values are little-endian) :                                             */
+/*   0x00 : "GPGX-CDZ" identifier                                                           */
+/*   0x08 : version (32-bit)                                                                */
+/*   0x0C : decompressed data size (32-bit)                                                 */
+/*   0x10 : hunk size (32-bit)                                                              */
+/*   0x14 : number of hunks (32-bit)                                                        */
+/*   0x18 : DATA track sector size (16-bit), number of tracks (16-bit)                      */
+/*   0x1C : TOC end (32-bit)                                                                */
+/*   0x20 : tracks (start, end, offset, type, file : 5 x 32-bit per track)                  */
+/*   then : hunks index (file offset, codec << 24 | compressed size : 2 x 32-bit per hunk)  */
+/*   then : compressed hunks                                                                */
+
+#define CDZ_VERSION 1
+
+/* 8 x 2352-byte sectors per hunk */
+#define CDZ_HUNK_SIZE (8 * 2352)
+
+/* max. supported hunk size */
+#define CDZ_HUNK_MAX 0x10000
+
+/* hunk codecs */
+#define CDZ_CODEC_NONE 0x00  /* stored */
+#define CDZ_CODEC_LZ   0x01  /* LZ77 (DATA sectors) */
+#define CDZ_CODEC_PCM  0x02  /* order-2 prediction + Rice coding (16-bit stereo CD-DA samples) */
+
+/* LZ77 codec parameters */
+#define LZ_MIN_MATCH 4
+#define LZ_HASH_BITS 12
+
+/* PCM codec parameters */
+#define PCM_BLOCK     588   /* stereo samples per block (one CD sector) */
+#define PCM_MAX_K     17
+#define PCM_ESCAPE    16    /* unary prefix length of escaped residuals */
+#define PCM_RAW_BITS  18
+
+#define READ_LE16(p) ((p)[0] | ((p)[1] << 8))
+#define READ_LE32(p) ((uint32)(p)[0] | ((uint32)(p)[1] << 8) | ((uint32)(p)[2] << 16) | ((uint32)(p)[3] << 24))
+
+static void write_le32(uint8 *p, uint32 data)
+{
+  p[0] = data;
+  p[1] = data >> 8;
+  p[2] = data >> 16;
+  p[3] = data >> 24;
+}
+
+/*--------------------------------------------------------------------------*/
+/* LZ77 codec                                                               */
+/*--------------------------------------------------------------------------*/
+
+/* Compressed data is a sequence of (literals, match) pairs, each one starting with a token */
+/* byte (literals length in high nibble, match length - 4 in low nibble, 15 meaning that the */
+/* length continues in next bytes), followed by literals and 16-bit match offset. The last   */
+/* sequence only has literals.                                                              */
+
+static int lz_decode(const uint8 *src, int srcLen, uint8 *dst, int dstLen)
+{
+  const uint8 *srcEnd = src + srcLen;
+  uint8 *out = dst;
+  uint8 *outEnd = dst + dstLen;
+
+  while (src < srcEnd)
+  {
+    int token = *src++;
+    int len = token >> 4;
+    int offset, data;
+
+    /* literals */
+    if (len == 15)
+    {
+      do
+      {
+        if (src >= srcEnd) return 0;
+        data = *src++;
+        len += data;
+      }
+      while (data == 255);
+    }
+    if ((len > (srcEnd - src)) || (len > (outEnd - out))) return 0;
+    memcpy(out, src, len);
+    out += len;
+    src += len;
+
+    /* last sequence */
+    if (src == srcEnd) break;
+
+    /* match */
+    if ((srcEnd - src) < 2) return 0;
+    offset = READ_LE16(src);
+    src += 2;
+    if (!offset || (offset > (out - dst))) return 0;
+    len = token & 15;
+    if (len == 15)
+    {
+      do
+      {
+        if (src >= srcEnd) return 0;
+        data = *src++;
+        len += data;
+      }
+      while (data == 255);
+    }
+    len += LZ_MIN_MATCH;
+    if (len > (outEnd - out)) return 0;
+
+    /* byte copy (matches can overlap) */
+    do
+    {
+      *out = *(out - offset);
+      out++;
+    }
+    while (--len);
+  }
+
+  return (out == outEnd);
+}
+
+static uint8 *lz_length(uint8 *dst, int len)
+{
+  while (len >= 255)
+  {
+    *dst++ = 255;
+    len -= 255;
+  }
+  *dst++ = len;
+  return dst;
+}
+
+static uint8 *lz_sequence(uint8 *dst, const uint8 *literals, int litLen, int offset, int matchLen)
+{
+  uint8 *token = dst++;
+  *token = ((litLen < 15) ? litLen : 15) << 4;
+  if (litLen >= 15) dst = lz_length(dst, litLen - 15);
+  memcpy(dst, literals, litLen);
+  dst += litLen;
+
+  if (matchLen)
+  {
+    matchLen -= LZ_MIN_MATCH;
+    *dst++ = offset;
+    *dst++ = offset >> 8;
+    *token |= (matchLen < 15) ? matchLen : 15;
+    if (matchLen >= 15) dst = lz_length(dst, matchLen - 15);
+  }
+
+  return dst;
+}
+
+/* returns compressed size (dst buffer must hold len + len / 255 + 16 bytes) */
+static int lz_encode(const uint8 *src, int len, uint8 *dst)
+{
+  static int table[1 << LZ_HASH_BITS];
+  uint8 *out = dst;
+  int i = 0, anchor = 0;
+
+  memset(table, 0xff, sizeof(table));
+
+  while ((i + LZ_MIN_MATCH) <= len)
+  {
+    uint32 data = READ_LE32(src + i);
+    int h = (data * 2654435761U) >> (32 - LZ_HASH_BITS);
+    int ref = table[h];
+    table[h] = i;
+
+    if ((ref >= 0) && ((i - ref) < 0x10000) && (READ_LE32(src + ref) == data))
+    {
+      int matchLen = LZ_MIN_MATCH;
+      while (((i + matchLen) < len) && (src[ref + matchLen] == src[i + matchLen]))
+      {
+        matchLen++;
+      }
+      out = lz_sequence(out, src + anchor, i - anchor, i - ref, matchLen);
+      i += matchLen;
+      anchor = i;
+    }
+    else
+    {
+      i++;
+    }
+  }
+
+  /* last literals */
+  out = lz_sequence(out, src + anchor, len - anchor, 0, 0);
+
+  return out - dst;
+}
+
+/*--------------------------------------------------------------------------*/
+/* PCM codec                                                                */
+/*--------------------------------------------------------------------------*/
+
+/* Each channel is predicted from its two previous samples (2*s[-1] - s[-2]). Residuals are */
+/* zigzag-encoded then Rice-coded, with one parameter per channel and per block. Residuals   */
+/* with a long unary prefix are escaped and stored as raw 18-bit values.                     */
+
+typedef struct
+{
+  uint8 *data;
+  int len;
+  int pos;    /* bit position */
+} bitstream_t;
+
+static void bits_write(bitstream_t *bs, uint32 data, int count)
+{
+  while (count--)
+  {
+    if (!(bs->pos & 7))
+    {
+      bs->data[bs->pos >> 3] = 0;
+    }
+    bs->data[bs->pos >> 3] |= ((data >> count) & 1) << (7 - (bs->pos & 7));
+    bs->pos++;
+  }
+}
+
+static int bits_read(bitstream_t *bs, int count, uint32 *data)
+{
+  uint32 val = 0;
+  if ((bs->pos + count) > (bs->len << 3)) return 0;
+  while (count--)
+  {
+    val = (val << 1) | ((bs->data[bs->pos >> 3] >> (7 - (bs->pos & 7))) & 1);
+    bs->pos++;
+  }
+  *data = val;
+  return 1;
+}
+
+INLINE int pcm_sample(const uint8 *src, int i)
+{
+  return (int16)READ_LE16(src + i * 2);
+}
+
+static int pcm_decode(const uint8 *src, int srcLen, uint8 *dst, int dstLen)
+{
+  bitstream_t bs;
+  int p1[2] = {0, 0};
+  int p2[2] = {0, 0};
+  int i, ch, frames = dstLen / 4;
+
+  if (dstLen & 3) return 0;
+
+  bs.data = (uint8 *)src;
+  bs.len = srcLen;
+  bs.pos = 0;
+
+  for (i=0; i<frames; i+=PCM_BLOCK)
+  {
+    int count = ((frames - i) < PCM_BLOCK) ? (frames - i) : PCM_BLOCK;
+
+    for (ch=0; ch<2; ch++)
+    {
+      uint32 k, u, bit;
+      int n;
+
+      if (!bits_read(&bs, 5, &k) || (k > PCM_MAX_K)) return 0;
+
+      for (n=0; n<count; n++)
+      {
+        int q = 0, s;
+
+        /* unary prefix */
+        do
+        {
+          if (!bits_read(&bs, 1, &bit)) return 0;
+        }
+        while (bit && (++q < PCM_ESCAPE));
+
+        if (q < PCM_ESCAPE)
+        {
+          if (!bits_read(&bs, k, &u)) return 0;
+          u |= q << k;
+        }
+        else if (!bits_read(&bs, PCM_RAW_BITS, &u))
+        {
+          return 0;
+        }
+
+        /* zigzag decoding + prediction */
+        s = ((u & 1) ? -(int)((u + 1) >> 1) : (int)(u >> 1)) + 2 * p1[ch] - p2[ch];
+        if ((s < -32768) || (s > 32767)) return 0;
+        p2[ch] = p1[ch];
+        p1[ch] = s;
+        dst[(i + n) * 4 + ch * 2] = s & 0xff;
+        dst[(i + n) * 4 + ch * 2 + 1] = (s >> 8) & 0xff;
+      }
+    }
+  }
+
+  return 1;
+}
+
+/* returns compressed size, 0 if data does not fit in dstLen bytes */
+static int pcm_encode(const uint8 *src, int len, uint8 *dst, int dstLen)
+{
+  static uint32 res[PCM_BLOCK];
+  bitstream_t bs;
+  int p1[2] = {0, 0};
+  int p2[2] = {0, 0};
+  int i, ch, frames = len / 4;
+
+  if (len & 3) return 0;
+
+  bs.data = dst;
+  bs.len = dstLen;
+  bs.pos = 0;
+
+  for (i=0; i<frames; i+=PCM_BLOCK)
+  {
+    int count = ((frames - i) < PCM_BLOCK) ? (frames - i) : PCM_BLOCK;
+
+    for (ch=0; ch<2; ch++)
+    {
+      int n, k, bestK = 0;
+      uint32 cost, bestCost = 0xffffffff;
+
+      /* zigzag-encoded residuals */
+      for (n=0; n<count; n++)
+      {
+        int s = pcm_sample(src, (i + n) * 2 + ch);
+        int r = s - (2 * p1[ch] - p2[ch]);
+        res[n] = (r < 0) ? ((uint32)(-r) * 2 - 1) : ((uint32)r * 2);
+        p2[ch] = p1[ch];
+        p1[ch] = s;
+      }
+
+      /* find best Rice parameter */
+      for (k=0; k<=PCM_MAX_K; k++)
+      {
+        cost = 0;
+        for (n=0; n<count; n++)
+        {
+          uint32 q = res[n] >> k;
+          cost += (q < PCM_ESCAPE) ? (q + 1 + k) : (PCM_ESCAPE + PCM_RAW_BITS);
+        }
+        if (cost < bestCost)
+        {
+          bestCost = cost;
+          bestK = k;
+        }
+      }
+
+      /* check output buffer limit */
+      if ((bs.pos + 5 + bestCost) > (uint32)(dstLen << 3)) return 0;
+
+      bits_write(&bs, bestK, 5);
+      for (n=0; n<count; n++)
+      {
+        uint32 q = res[n] >> bestK;
+        if (q < PCM_ESCAPE)
+        {
+          bits_write(&bs, ((1 << q) - 1) << 1, q + 1);
+          bits_write(&bs, res[n], bestK);
+        }
+        else
+        {
+          bits_write(&bs, (1 << PCM_ESCAPE) - 1, PCM_ESCAPE);
+          bits_write(&bs, res[n], PCM_RAW_BITS);
+        }
+      }
+    }
+  }
+
+  return (bs.pos + 7) >> 3;
+}
+
+/*--------------------------------------------------------------------------*/
+/* CDZ image reader                                                         */
+/*--------------------------------------------------------------------------*/
+
+static int cdz_file_read(cdz_t *cdz, uint8 *dst, uint32 offset, int len)
+{
+#ifdef USE_CD_THREAD
+  /* file position is shared with CD drive emulation */
+  return (pread(fileno(cdz->fd), dst, len, offset) == len);
+#else
+  fseek(cdz->fd, offset, SEEK_SET);
+  return (fread(dst, 1, len, cdz->fd) == (size_t)len);
+#endif
+}
+
+cdz_t *cdz_open(FILE *fd)
+{
+  uint8 head[0x20];
+  uint8 *data;
+  cdz_t *cdz;
+  size_t dataSize;
+  long fileSize;
+  uint32 limit;
+  int i;
+
+  /* get file size */
+  fseek(fd, 0, SEEK_END);
+  fileSize = ftell(fd);
+
+  /* check identifier */
+  fseek(fd, 0, SEEK_SET);
+  if ((fread(head, 0x20, 1, fd) != 1) || memcmp(head, CDZ_ID, 8) || (READ_LE32(head + 0x08) != CDZ_VERSION))
+  {
+    fseek(fd, 0, SEEK_SET);
+    return NULL;
+  }
+
+  cdz = calloc(1, sizeof(cdz_t));
+  if (!cdz)
+  {
+    return NULL;
+  }
+
+  cdz->fd = fd;
+  cdz->size = READ_LE32(head + 0x0C);
+  cdz->hunkSize = READ_LE32(head + 0x10);
+  cdz->hunks = READ_LE32(head + 0x14);
+  cdz->sectorSize = READ_LE16(head + 0x18);
+  cdz->last = READ_LE16(head + 0x1A);
+  cdz->end = READ_LE32(head + 0x1C);
+
+  /* check header */
+  if (!cdz->hunkSize || (cdz->hunkSize > CDZ_HUNK_MAX) || (cdz->hunks != ((cdz->size + cdz->hunkSize - 1) / cdz->hunkSize)) ||
+      ((cdz->sectorSize != 2048) && (cdz->sectorSize != 2352)) || !cdz->last || (cdz->last >= CDZ_MAX_TRACKS))
+  {
+    free(cdz);
+    return NULL;
+  }
+
+  /* tracks & hunks index should fit in file (also prevents allocated size overflow) */
+  if ((fileSize < 0x20) || (((size_t)(fileSize - 0x20) / 8) < cdz->hunks) ||
+      ((size_t)(fileSize - 0x20) - (size_t)cdz->hunks * 8 < (size_t)cdz->last * 20))
+  {
+    free(cdz);
+    return NULL;
+  }
+
+  /* hunks file offsets are 32-bit */
+  limit = (fileSize > 0x7fffffffL) ? 0xffffffff : (uint32)fileSize;
+
+  /* read tracks & hunks index */
+  dataSize = (size_t)cdz->last * 20 + (size_t)cdz->hunks * 8;
+  data = malloc(dataSize);
+  cdz->index = malloc((size_t)cdz->hunks * 8 + 4);
+  cdz->buffer = malloc(cdz->hunkSize);
+  if (!data || !cdz->index || !cdz->buffer || (fread(data, dataSize, 1, fd) != 1))
+  {
+    free(data);
+    cdz_close(cdz);
+    return NULL;
+  }
+
+  for (i=0; i<cdz->last; i++)
+  {
+    cdz->tracks[i].start = READ_LE32(data + i * 20);
+    cdz->tracks[i].end = READ_LE32(data + i * 20 + 4);
+    cdz->tracks[i].offset = READ_LE32(data + i * 20 + 8);
+    cdz->tracks[i].type = READ_LE32(data + i * 20 + 12);
+    cdz->tracks[i].file = READ_LE32(data + i * 20 + 16);
+
+    /* track data start position should be within image data */
+    if (cdz->tracks[i].file &&
+        ((cdz->tracks[i].start < 0) || (cdz->tracks[i].start > (0x7fffffff / 2352)) ||
+         (cdz->tracks[i].offset > (cdz->tracks[i].start * 2352)) ||
+         (((uint32)(cdz->tracks[i].start * 2352) - (uint32)cdz->tracks[i].offset) > cdz->size)))
+    {
+      free(data);
+      cdz_close(cdz);
+      return NULL;
+    }
+  }
+
+  for (i=0; i<(int)cdz->hunks; i++)
+  {
+    cdz->index[i * 2] = READ_LE32(data + cdz->last * 20 + i * 8);
+    cdz->index[i * 2 + 1] = READ_LE32(data + cdz->last * 20 + i * 8 + 4);
+
+    /* compressed hunk should be within file */
+    if (((cdz->index[i * 2 + 1] & 0xffffff) > limit) ||
+        (cdz->index[i * 2] > (limit - (cdz->index[i * 2 + 1] & 0xffffff))))
+    {
+      free(data);
+      cdz_close(cdz);
+      return NULL;
+    }
+  }
+
+  free(data);
+
+  /* initialize hunks cache */
+  for (i=0; i<CDZ_CACHE_HUNKS; i++)
+  {
+    cdz->cache[i].hunk = -1;
+    cdz->cache[i].data = malloc(cdz->hunkSize);
+    if (!cdz->cache[i].data)
+    {
+      cdz_close(cdz);
+      return NULL;
+    }
+  }
+
+#ifdef USE_CD_THREAD
+  pthread_mutex_init(&cdz->mutex, NULL);
+#endif
+
+  return cdz;
+}
+
+void cdz_close(cdz_t *cdz)
+{
+  int i;
+
+#ifdef USE_CD_THREAD
+  if (cdz->cache[CDZ_CACHE_HUNKS - 1].data)
+  {
+    pthread_mutex_destroy(&cdz->mutex);
+  }
+#endif
+
+  for (i=0; i<CDZ_CACHE_HUNKS; i++)
+  {
+    free(cdz->cache[i].data);
+  }
+
+  free(cdz->index);
+  free(cdz->buffer);
+  free(cdz);
+}
+
+static uint8 *cdz_hunk(cdz_t *cdz, int hunk)
+{
+  cdz_hunk_t *entry = &cdz->cache[0];
+  uint32 offset, len, size;
+  int i, codec, ok;
+
+  /* look for hunk in cache (or least recently used entry) */
+  for (i=0; i<CDZ_CACHE_HUNKS; i++)
+  {
+    if (cdz->cache[i].hunk == hunk)
+    {
+      cdz->cache[i].used = ++cdz->clock;
+      return cdz->cache[i].data;
+    }
+    if (cdz->cache[i].used < entry->used)
+    {
+      entry = &cdz->cache[i];
+    }
+  }
+
+  /* decompressed hunk size */
+  size = cdz->size - hunk * cdz->hunkSize;
+  if (size > cdz->hunkSize)
+  {
+    size = cdz->hunkSize;
+  }
+
+  /* read compressed hunk */
+  offset = cdz->index[hunk * 2];
+  len = cdz->index[hunk * 2 + 1] & 0xffffff;
+  codec = cdz->index[hunk * 2 + 1] >> 24;
+  if ((len > cdz->hunkSize) || !cdz_file_read(cdz, cdz->buffer, offset, len))
+  {
+    return NULL;
+  }
+
+  /* decompress hunk */
+  switch (codec)
+  {
+    case CDZ_CODEC_NONE:
+      ok = (len == size);
+      if (ok) memcpy(entry->data, cdz->buffer, size);
+      break;
+
+    case CDZ_CODEC_LZ:
+      ok = lz_decode(cdz->buffer, len, entry->data, size);
+      break;
+
+    case CDZ_CODEC_PCM:
+      ok = pcm_decode(cdz->buffer, len, entry->data, size);
+      break;
+
+    default:
+      ok = 0;
+      break;
+  }
+
+  if (!ok)
+  {
+    entry->hunk = -1;
+    return NULL;
+  }
+
+  entry->hunk = hunk;
+  entry->used = ++cdz->clock;
+  return entry->data;
+}
+
+int cdz_read(cdz_t *cdz, uint8 *dst, long pos, int len)
+{
+  int done = 0;
+
+  /* same result as reading from uncompressed file */
+  if ((pos < 0) || (pos >= (long)cdz->size))
+  {
+    return 0;
+  }
+  if (len > (long)(cdz->size - pos))
+  {
+    len = cdz->size - pos;
+  }
+
+#ifdef USE_CD_THREAD
+  pthread_mutex_lock(&cdz->mutex);
+#endif
+
+  while (done < len)
+  {
+    int offset = (pos + done) % cdz->hunkSize;
+    int count = cdz->hunkSize - offset;
+    uint8 *data = cdz_hunk(cdz, (pos + done) / cdz->hunkSize);
+    if (!data)
+    {
+      break;
+    }
+    if (count > (len - done))
+    {
+      count = len - done;
+    }
+    memcpy(dst + done, data + offset, count);
+    done += count;
+  }
+
+#ifdef USE_CD_THREAD
+  pthread_mutex_unlock(&cdz->mutex);
+#endif
+
+  return done;
+}
+
+/*--------------------------------------------------------------------------*/
+/* CDZ image creation                                                       */
+/*--------------------------------------------------------------------------*/
+
+/* read loaded CD track data (DATA track position is in bytes, AUDIO track position is LBA x 2352) */
+static void cdz_read_track(int index, uint8 *dst, long pos, int len)
+{
+  int done = 0;
+
+  memset(dst, 0, len);
+
+  if (!cdd.toc.tracks[index].fd)
+  {
+    return;
+  }
+
+#if defined(USE_LIBTREMOR) || defined(USE_LIBVORBIS)
+  if (cdd.toc.tracks[index].vf.datasource)
+  {
+    /* decode VORBIS track */
+    ov_pcm_seek(&cdd.toc.tracks[index].vf, (pos / 4) - cdd.toc.tracks[index].offset);
+    while (done < len)
+    {
+#ifdef USE_LIBVORBIS
+      int count = ov_read(&cdd.toc.tracks[index].vf, (char *)(dst + done), len - done, 0, 2, 1, 0);
+#else
+      int count = ov_read(&cdd.toc.tracks[index].vf, (char *)(dst + done), len - done, 0);
+#endif
+      if (count == OV_HOLE) continue;
+      if (count <= 0) break;
+      done += count;
+    }
+#ifndef LSB_FIRST
+    /* VORBIS samples are decoded in host byte order, CDZ samples are little-endian */
+    for (done=0; done<len; done+=2)
+    {
+      uint8 temp = dst[done];
+      dst[done] = dst[done + 1];
+      dst[done + 1] = temp;
+    }
+#endif
+    return;
+  }
+#endif
+
+  /* PCM AUDIO track file offset */
+  if (!cdd.toc.tracks[index].type)
+  {
+    pos -= cdd.toc.tracks[index].offset;
+  }
+
+  /* zero-padded past end of file */
+  if (pos >= 0)
+  {
+    fseek(cdd.toc.tracks[index].fd, pos, SEEK_SET);
+    fread(dst, 1, len, cdd.toc.tracks[index].fd);
+  }
+}
+
+int cdz_create(char *filename)
+{
+  cdz_track_t tracks[CDZ_MAX_TRACKS];
+  uint32 size = 0, hunks, offset, i;
+  uint8 *data, *buffer, *lzbuffer, *index;
+  int last = cdd.toc.last;
+  FILE *fd;
+
+  if (!cdd.loaded || (last <= 0) || (last >= CDZ_MAX_TRACKS))
+  {
+    return 0;
+  }
+
+  /* build image data layout: DATA track sectors then AUDIO tracks sectors */
+  for (i=0; i<(uint32)last; i++)
+  {
+    tracks[i].start = cdd.toc.tracks[i].start;
+    tracks[i].end = cdd.toc.tracks[i].end;
+    tracks[i].type = cdd.toc.tracks[i].type;
+    tracks[i].file = (cdd.toc.tracks[i].fd != NULL);
+    if (tracks[i].type)
+    {
+      /* DATA track is read at LBA * sector size */
+      tracks[i].offset = 0;
+      size = tracks[i].end * cdd.sectorSize;
+    }
+    else if (tracks[i].file)
+    {
+      /* AUDIO tracks are read at LBA * 2352 - offset */
+      tracks[i].offset = tracks[i].start * 2352 - size;
+      size += (tracks[i].end - tracks[i].start) * 2352;
+    }
+    else
+    {
+      tracks[i].offset = 0;
+    }
+  }
+
+  hunks = (size + CDZ_HUNK_SIZE - 1) / CDZ_HUNK_SIZE;
+  if (!hunks)
+  {
+    return 0;
+  }
+
+  fd = fopen(filename, "wb");
+  if (!fd)
+  {
+    return 0;
+  }
+
+  data = malloc(CDZ_HUNK_SIZE);
+  buffer = malloc(CDZ_HUNK_SIZE);
+  lzbuffer = malloc(CDZ_HUNK_SIZE + CDZ_HUNK_SIZE / 255 + 16);
+  index = malloc(0x20 + last * 20 + hunks * 8);
+  if (!data || !buffer || !lzbuffer || !index)
+  {
+    free(data);
+    free(buffer);
+    free(lzbuffer);
+    free(index);
+    fclose(fd);
+    return 0;
+  }
+
+  /* header */
+  memcpy(index, CDZ_ID, 8);
+  write_le32(index + 0x08, CDZ_VERSION);
+  write_le32(index + 0x0C, size);
+  write_le32(index + 0x10, CDZ_HUNK_SIZE);
+  write_le32(index + 0x14, hunks);
+  write_le32(index + 0x18, cdd.sectorSize | (last << 16));
+  write_le32(index + 0x1C, cdd.toc.end);
+  for (i=0; i<(uint32)last; i++)
+  {
+    write_le32(index + 0x20 + i * 20, tracks[i].start);
+    write_le32(index + 0x20 + i * 20 + 4, tracks[i].end);
+    write_le32(index + 0x20 + i * 20 + 8, tracks[i].offset);
+    write_le32(index + 0x20 + i * 20 + 12, tracks[i].type);
+    write_le32(index + 0x20 + i * 20 + 16, tracks[i].file);
+  }
+
+  /* compressed hunks are written after hunks index */
+  offset = 0x20 + last * 20 + hunks * 8;
+  fseek(fd, offset, SEEK_SET);
+
+  for (i=0; i<hunks; i++)
+  {
+    uint32 pos = i * CDZ_HUNK_SIZE;
+    uint32 len = ((size - pos) < CDZ_HUNK_SIZE) ? (size - pos) : CDZ_HUNK_SIZE;
+    uint32 done = 0, codec = CDZ_CODEC_NONE, count;
+    int n;
+
+    /* read hunk data from loaded tracks */
+    memset(data, 0, len);
+    while (done < len)
+    {
+      for (n=0; n<last; n++)
+      {
+        uint32 start, end;
+        if (tracks[n].type)
+        {
+          start = 0;
+          end = tracks[n].end * cdd.sectorSize;
+        }
+        else if (tracks[n].file)
+        {
+          start = tracks[n].start * 2352 - tracks[n].offset;
+          end = tracks[n].end * 2352 - tracks[n].offset;
+        }
+        else
+        {
+          continue;
+        }
+
+        if (((pos + done) >= start) && ((pos + done) < end))
+        {
+          count = end - (pos + done);
+          if (count > (len - done))
+          {
+            count = len - done;
+          }
+          cdz_read_track(n, data + done, pos + done + tracks[n].offset, count);
+          done += count;
+          break;
+        }
+      }
+
+      /* should not happen (tracks data are contiguous) */
+      if (n == last) break;
+    }
+
+    /* use best codec */
+    count = pcm_encode(data, len, buffer, len - 1);
+    if (count)
+    {
+      codec = CDZ_CODEC_PCM;
+    }
+    n = lz_encode(data, len, lzbuffer);
+    if ((n < (int)len) && (!count || ((uint32)n < count)))
+    {
+      count = n;
+      codec = CDZ_CODEC_LZ;
+      memcpy(buffer, lzbuffer, count);
+    }
+    if (codec == CDZ_CODEC_NONE)
+    {
+      count = len;
+      memcpy(buffer, data, len);
+    }
+
+    write_le32(index + 0x20 + last * 20 + i * 8, offset);
+    write_le32(index + 0x20 + last * 20 + i * 8 + 4, (codec << 24) | count);
+    fwrite(buffer, count, 1, fd);
+    offset += count;
+  }
+
+  /* header & hunks index */
+  fseek(fd, 0, SEEK_SET);
+  fwrite(index, 0x20 + last * 20 + hunks * 8, 1, fd);
+
+  free(data);
+  free(buffer);
+  free(lzbuffer);
+  free(index);
+  return !fclose(fd);
+}
@@ -0,0 +1,99 @@
+/***************************************************************************************
+ *  Genesis Plus
+ *  Compressed CD image (CDZ) support
+ *
+ *  Copyright (C) 2015  Eke-Eke (Genesis Plus GX)
+ *
+ *  Redistribution and use of this code or any derivative works are permitted
+ *  provided that the following conditions are met:
+ *
+ *   - Redistributions may not be sold, nor may they be used in a commercial
+ *     product or activity.
+ *
+ *   - Redistributions that are modified from the original source must include the
+ *     complete source code, including the source code for all components used by a
+ *     binary built from the modified sources. However, as a special exception, the
+ *     source code distributed need not include anything that is normally distributed
+ *     (in either source or binary form) with the major components (compiler, kernel,
+ *     and so on) of the operating system on which the executable runs, unless that
+ *     component itself accompanies the executable.
+ *
+ *   - Redistributions must reproduce the above copyright notice, this list of
+ *     conditions and the following disclaimer in the documentation and/or other
+ *     materials provided with the distribution.
+ *
+ *  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ *  AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ *  IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ *  ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE
+ *  LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ *  CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ *  SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ *  INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ *  CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ *  ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ *  POSSIBILITY OF SUCH DAMAGE.
+ *
+ ****************************************************************************************/
+#ifndef _HW_CDZ_
+#define _HW_CDZ_
+
+#ifdef USE_CD_THREAD
+#include <pthread.h>
+#endif
+
+/* CDZ file identifier */
+#define CDZ_ID "GPGX-CDZ"
+
+/* max. number of tracks */
+#define CDZ_MAX_TRACKS 100
+
+/* decompressed hunks cache size */
+#define CDZ_CACHE_HUNKS 8
+
+/* CDZ track */
+typedef struct
+{
+  int start;
+  int end;
+  int offset;   /* track start offset in image data, as used for PCM AUDIO tracks */
+  int type;
+  int file;     /* track has data (simulated audio tracks have none) */
+} cdz_track_t;
+
+/* decompressed hunk */
+typedef struct
+{
+  int hunk;     /* hunk index (-1 if empty) */
+  uint32 used;  /* last access time */
+  uint8 *data;
+} cdz_hunk_t;
+
+/* CDZ image */
+typedef struct
+{
+  FILE *fd;
+  uint32 size;      /* decompressed image data size */
+  uint32 hunkSize;  /* decompressed hunk size */
+  uint32 hunks;     /* number of hunks */
+  uint32 *index;    /* hunks file offset & (codec << 24 | compressed size) */
+  int sectorSize;   /* DATA track sector size */
+  int end;          /* TOC end */
+  int last;         /* number of tracks */
+  cdz_track_t tracks[CDZ_MAX_TRACKS];
+  cdz_hunk_t cache[CDZ_CACHE_HUNKS];
+  uint32 clock;
+  uint8 *buffer;    /* compressed hunk buffer */
+  long pos;         /* current reading position (emulated FILE position) */
+#ifdef USE_CD_THREAD
+  pthread_mutex_t mutex;
+#endif
+} cdz_t;
+
+/* Function prototypes */
+extern cdz_t *cdz_open(FILE *fd);
+extern void cdz_close(cdz_t *cdz);
+extern int cdz_read(cdz_t *cdz, uint8 *dst, long pos, int len);
+extern int cdz_create(char *filename);
+
+#endif
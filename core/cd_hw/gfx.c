@@ -37,6 +37,12 @@
  ****************************************************************************************/
 #include "shared.h"
 
+/* x86 SIMD graphics functions (define NO_SIMD_GFX in the makefile to disable them) */
+#if !defined(NO_SIMD_GFX) && (defined(__x86_64__) || defined(__i386__)) && (defined(__clang__) || (__GNUC__ >= 5))
+#define SIMD_GFX
+#include <immintrin.h>
+#endif
+
 /***************************************************************/
 /*          WORD-RAM DMA interfaces (1M & 2M modes)            */
 /***************************************************************/
@@ -70,6 +76,7 @@ void word_ram_0_dma_w(unsigned int words)
 
     /* write 16-bit word to WORD-RAM */
     *(uint16 *)(scd.word_ram[0] + dst_index) = data ;
+    MARK_DIRTY(DIRTY_WORD_RAM, dst_index);
 
     /* increment CDC buffer source address */
     src_index = (src_index + 2) & 0x3ffe;
@@ -108,6 +115,7 @@ void word_ram_1_dma_w(unsigned int words)
 
     /* write 16-bit word to WORD-RAM */
     *(uint16 *)(scd.word_ram[1] + dst_index) = data ;
+    MARK_DIRTY(DIRTY_WORD_RAM, 0x20000 + dst_index);
 
     /* increment CDC buffer source address */
     src_index = (src_index + 2) & 0x3ffe;
@@ -146,6 +154,7 @@ void word_ram_2M_dma_w(unsigned int words)
 
     /* write 16-bit word to WORD-RAM */
     *(uint16 *)(scd.word_ram_2M + dst_index) = data ;
+    MARK_DIRTY(DIRTY_WORD_RAM_2M, dst_index);
 
     /* increment CDC buffer source address */
     src_index = (src_index + 2) & 0x3ffe;
@@ -180,6 +189,7 @@ void dot_ram_0_write16(unsigned int address, unsigned int data)
   data = (data & 0x0f) | ((data >> 4) & 0xf0);
   data = gfx.lut_prio[(scd.regs[0x02>>1].w >> 3) & 0x03][prev][data];
   WRITE_BYTE(scd.word_ram[0], address, data);
+  MARK_DIRTY(DIRTY_WORD_RAM, address);
 }
 
 void dot_ram_1_write16(unsigned int address, unsigned int data)
@@ -190,6 +200,7 @@ void dot_ram_1_write16(unsigned int address, unsigned int data)
   data = (data & 0x0f) | ((data >> 4) & 0xf0);
   data = gfx.lut_prio[(scd.regs[0x02>>1].w >> 3) & 0x03][prev][data];
   WRITE_BYTE(scd.word_ram[1], address, data);
+  MARK_DIRTY(DIRTY_WORD_RAM, 0x20000 + address);
 }
 
 unsigned int dot_ram_0_read8(unsigned int address)
@@ -231,6 +242,7 @@ void dot_ram_0_write8(unsigned int address, unsigned int data)
 
   data = gfx.lut_prio[(scd.regs[0x02>>1].w >> 3) & 0x03][prev][data];
   WRITE_BYTE(scd.word_ram[0], (address >> 1) & 0x1ffff, data);
+  MARK_DIRTY(DIRTY_WORD_RAM, (address >> 1) & 0x1ffff);
 }
 
 void dot_ram_1_write8(unsigned int address, unsigned int data)
@@ -248,6 +260,7 @@ void dot_ram_1_write8(unsigned int address, unsigned int data)
 
   data = gfx.lut_prio[(scd.regs[0x02>>1].w >> 3) & 0x03][prev][data];
   WRITE_BYTE(scd.word_ram[1], (address >> 1) & 0x1ffff, data);
+  MARK_DIRTY(DIRTY_WORD_RAM, 0x20000 + ((address >> 1) & 0x1ffff));
 }
 
 
@@ -271,12 +284,14 @@ void cell_ram_0_write16(unsigned int address, unsigned int data)
 {
   address = gfx.lut_offset[(address >> 2) & 0x7fff] | (address & 0x10002);
   *(uint16 *)(scd.word_ram[0] + address) = data;
+  MARK_DIRTY(DIRTY_WORD_RAM, address);
 }
 
 void cell_ram_1_write16(unsigned int address, unsigned int data)
 {
   address = gfx.lut_offset[(address >> 2) & 0x7fff] | (address & 0x10002);
   *(uint16 *)(scd.word_ram[1] + address) = data;
+  MARK_DIRTY(DIRTY_WORD_RAM, 0x20000 + address);
 }
 
 unsigned int cell_ram_0_read8(unsigned int address)
@@ -295,12 +310,14 @@ void cell_ram_0_write8(unsigned int address, unsigned int data)
 {
   address = gfx.lut_offset[(address >> 2) & 0x7fff] | (address & 0x10003);
   WRITE_BYTE(scd.word_ram[0], address, data);
+  MARK_DIRTY(DIRTY_WORD_RAM, address);
 }
 
 void cell_ram_1_write8(unsigned int address, unsigned int data)
 {
   address = gfx.lut_offset[(address >> 2) & 0x7fff] | (address & 0x10003);
   WRITE_BYTE(scd.word_ram[1], address, data);
+  MARK_DIRTY(DIRTY_WORD_RAM, 0x20000 + address);
 }
 
 
@@ -308,6 +325,171 @@ void cell_ram_1_write8(unsigned int address, unsigned int data)
 /*      Rotation / Scaling operation (2M Mode)                 */
 /***************************************************************/
 
+/* Graphics operation dots are processed by image buffer cell rows (up to 8 dots = 4 bytes): */
+/* stamp pixels of a cell row are fetched first, then written back as whole bytes.          */
+typedef struct
+{
+  uint32 xpos;      /* first dot position (13.11 format) */
+  uint32 ypos;
+  uint32 xoffset;   /* dot position increments (5.11 format) */
+  uint32 yoffset;
+  uint32 posMask;   /* stamp map range or 24-bit range */
+  uint32 size;      /* stamp size bit (cell lookup table entry) */
+  uint32 row;       /* image buffer row byte address */
+} gfx_line_t;
+
+/* Fetch stamp pixels (one per byte) for the next dots of current cell row.              */
+/* Returns non-zero if stamp data is read from the image buffer row being written to, in */
+/* which case dots have to be rendered one by one to keep the original write ordering.  */
+static int gfx_dots_c(uint8 *pixels, const gfx_line_t *line, int count)
+{
+  int i, overlap = 0;
+  uint16 *map;
+  uint16 stamp_data;
+  uint32 stamp_index;
+  uint32 xpos = line->xpos;
+  uint32 ypos = line->ypos;
+
+  for (i=0; i<count; i++)
+  {
+    uint32 x = xpos & line->posMask;
+    uint32 y = ypos & line->posMask;
+
+    /* next dot position */
+    xpos += line->xoffset;
+    ypos += line->yoffset;
+
+    /* check if pixel is outside stamp map */
+    if ((x | y) & ~gfx.dotMask)
+    {
+      /* force pixel output to 0 */
+      pixels[i] = 0x00;
+      continue;
+    }
+
+    /* read stamp map table data */
+    map = &gfx.mapPtr[(x >> gfx.stampShift) | ((y >> gfx.stampShift) << gfx.mapShift)];
+    stamp_data = *map;
+    overlap |= ((((uint8 *)map - scd.word_ram_2M) & ~3) == line->row);
+
+    /* stamp generator base index                                     */
+    /* sss ssssssss ccyyyxxx (16x16) or sss sssssscc ccyyyxxx (32x32) */
+    /* with:  s = stamp number (1 stamp = 16x16 or 32x32 pixels)      */
+    /*        c = cell offset  (0-3 for 16x16, 0-15 for 32x32)        */
+    /*      yyy = line offset  (0-7)                                  */
+    /*      xxx = pixel offset (0-7)                                  */
+    stamp_index = (stamp_data & 0x7ff) << 8;
+
+    if (!stamp_index)
+    {
+      /* stamp 0 is not used: force pixel output to 0 */
+      pixels[i] = 0x00;
+      continue;
+    }
+
+    /* extract HFLIP & ROTATION bits */
+    stamp_data = (stamp_data >> 13) & 7;
+
+    /* cell offset (0-3 or 0-15)                             */
+    /* table entry = yyxxshrr (8 bits)                       */
+    /* with: yy = cell row  (0-3) = (ypos >> (11 + 3)) & 3   */
+    /*       xx = cell column (0-3) = (xpos >> (11 + 3)) & 3 */
+    /*        s = stamp size (0=16x16, 1=32x32)              */
+    /*      hrr = HFLIP & ROTATION bits                      */
+    stamp_index |= gfx.lut_cell[stamp_data | line->size | ((y >> 8) & 0xc0) | ((x >> 10) & 0x30)] << 6;
+
+    /* pixel  offset (0-63)                              */
+    /* table entry = yyyxxxhrr (9 bits)                  */
+    /* with: yyy = pixel row  (0-7) = (ypos >> 11) & 7   */
+    /*       xxx = pixel column (0-7) = (xpos >> 11) & 7 */
+    /*       hrr = HFLIP & ROTATION bits                 */
+    stamp_index |= gfx.lut_pixel[stamp_data | ((x >> 8) & 0x38) | ((y >> 5) & 0x1c0)];
+
+    /* read pixel pair (2 pixels/byte) and extract left or right pixel */
+    pixels[i] = (READ_BYTE(scd.word_ram_2M, stamp_index >> 1) >> ((~stamp_index & 1) << 2)) & 0x0f;
+    overlap |= (((stamp_index >> 1) & ~3) == line->row);
+  }
+
+  return overlap;
+}
+
+#ifdef SIMD_GFX
+
+/* 8 dots fetched per lookup table gathers (tables & stamp data are read as upper bytes of 32-bit words,   */
+/* which are always preceded by other data so reads never underflow). Dots past count are computed anyway. */
+__attribute__((target("avx2"))) static int gfx_dots_avx2(uint8 *pixels, const gfx_line_t *line, int count)
+{
+  const __m256i zero = _mm256_setzero_si256();
+  const __m256i lane = _mm256_setr_epi32(0, 1, 2, 3, 4, 5, 6, 7);
+  const __m256i posMask = _mm256_set1_epi32(line->posMask);
+  const __m128i stampShift = _mm_cvtsi32_si128(gfx.stampShift);
+  __m256i x, y, idx, data, index, inside, valid, cell, pixel, overlap, row;
+  __m128i lo, hi;
+
+  /* dot positions */
+  x = _mm256_add_epi32(_mm256_set1_epi32(line->xpos), _mm256_mullo_epi32(lane, _mm256_set1_epi32(line->xoffset)));
+  y = _mm256_add_epi32(_mm256_set1_epi32(line->ypos), _mm256_mullo_epi32(lane, _mm256_set1_epi32(line->yoffset)));
+  x = _mm256_and_si256(x, posMask);
+  y = _mm256_and_si256(y, posMask);
+
+  /* dots inside stamp map */
+  inside = _mm256_cmpeq_epi32(_mm256_and_si256(_mm256_or_si256(x, y), _mm256_set1_epi32(~gfx.dotMask)), zero);
+
+  /* stamp map table data */
+  idx = _mm256_or_si256(_mm256_srl_epi32(x, stampShift), _mm256_sll_epi32(_mm256_srl_epi32(y, stampShift), _mm_cvtsi32_si128(gfx.mapShift)));
+  data = _mm256_mask_i32gather_epi32(zero, (const int *)(gfx.mapPtr - 1), idx, inside, 2);
+  data = _mm256_srli_epi32(data, 16);
+
+  /* stamp generator base index (stamp 0 is not used) */
+  index = _mm256_slli_epi32(_mm256_and_si256(data, _mm256_set1_epi32(0x7ff)), 8);
+  valid = _mm256_andnot_si256(_mm256_cmpeq_epi32(index, zero), inside);
+
+  /* HFLIP & ROTATION bits */
+  data = _mm256_and_si256(_mm256_srli_epi32(data, 13), _mm256_set1_epi32(7));
+
+  /* cell offset */
+  cell = _mm256_or_si256(_mm256_or_si256(data, _mm256_set1_epi32(line->size)),
+                         _mm256_or_si256(_mm256_and_si256(_mm256_srli_epi32(y, 8), _mm256_set1_epi32(0xc0)),
+                                         _mm256_and_si256(_mm256_srli_epi32(x, 10), _mm256_set1_epi32(0x30))));
+  cell = _mm256_srli_epi32(_mm256_mask_i32gather_epi32(zero, (const int *)(gfx.lut_cell - 3), cell, valid, 1), 24);
+
+  /* pixel offset */
+  pixel = _mm256_or_si256(data, _mm256_or_si256(_mm256_and_si256(_mm256_srli_epi32(x, 8), _mm256_set1_epi32(0x38)),
+                                                _mm256_and_si256(_mm256_srli_epi32(y, 5), _mm256_set1_epi32(0x1c0))));
+  pixel = _mm256_srli_epi32(_mm256_mask_i32gather_epi32(zero, (const int *)(gfx.lut_pixel - 3), pixel, valid, 1), 24);
+
+  /* stamp pixel address */
+  index = _mm256_or_si256(index, _mm256_or_si256(_mm256_slli_epi32(cell, 6), pixel));
+
+  /* check if stamp data overlaps image buffer row */
+  row = _mm256_set1_epi32(line->row >> 2);
+  overlap = _mm256_and_si256(valid, _mm256_cmpeq_epi32(_mm256_srli_epi32(index, 3), row));
+  idx = _mm256_add_epi32(_mm256_set1_epi32((uint8 *)gfx.mapPtr - scd.word_ram_2M), _mm256_slli_epi32(idx, 1));
+  overlap = _mm256_or_si256(overlap, _mm256_and_si256(inside, _mm256_cmpeq_epi32(_mm256_srli_epi32(idx, 2), row)));
+
+  /* read pixel pair (2 pixels/byte) and extract left or right pixel */
+  data = _mm256_srli_epi32(index, 1);
+#ifdef LSB_FIRST
+  data = _mm256_xor_si256(data, _mm256_set1_epi32(1));
+#endif
+  data = _mm256_srli_epi32(_mm256_mask_i32gather_epi32(zero, (const int *)(scd.word_ram_2M - 3), data, valid, 1), 24);
+  data = _mm256_srlv_epi32(data, _mm256_slli_epi32(_mm256_andnot_si256(index, _mm256_set1_epi32(1)), 2));
+  data = _mm256_and_si256(data, _mm256_set1_epi32(0x0f));
+
+  /* pack pixels to bytes */
+  data = _mm256_shuffle_epi8(data, _mm256_set1_epi32(0x0c080400));
+  lo = _mm256_castsi256_si128(data);
+  hi = _mm256_extracti128_si256(data, 1);
+  _mm_storel_epi64((__m128i *)pixels, _mm_unpacklo_epi32(lo, hi));
+
+  return _mm256_movemask_ps(_mm256_castsi256_ps(overlap)) & ((1 << count) - 1);
+}
+
+#endif /* SIMD_GFX */
+
+/* Stamp pixels fetch function (selected by host CPU features) */
+static int (*gfx_dots)(uint8 *pixels, const gfx_line_t *line, int count) = gfx_dots_c;
+
 void gfx_init(void)
 {
   int i, j;
@@ -417,6 +599,15 @@ void gfx_init(void)
     /* pixel offset (0-63) */
     gfx.lut_pixel[i] = col + row * 8;
   }
+
+#ifdef SIMD_GFX
+  /* Select stamp pixels fetch function supported by host CPU */
+  __builtin_cpu_init();
+  if (__builtin_cpu_supports("avx2"))
+  {
+    gfx_dots = gfx_dots_avx2;
+  }
+#endif
 }
 
 void gfx_reset(void)
@@ -471,128 +662,103 @@ int gfx_context_load(uint8 *state)
 
 INLINE void gfx_render(uint32 bufferIndex, uint32 width)
 {
-  uint8 pixel_in, pixel_out;
-  uint16 stamp_data;
-  uint32 stamp_index;
+  gfx_line_t line;
+  uint8 pixels[8];
+  uint8 pixel_in;
+  uint32 i, count, address;
+
+  /* priority mode lookup table */
+  uint8 (*prio)[0x100] = gfx.lut_prio[(scd.regs[0x02>>1].w >> 3) & 0x03];
 
   /* pixel map start position for current line (13.3 format converted to 13.11) */
-  uint32 xpos = *gfx.tracePtr++ << 8;
-  uint32 ypos = *gfx.tracePtr++ << 8;
+  line.xpos = *gfx.tracePtr++ << 8;
+  line.ypos = *gfx.tracePtr++ << 8;
 
   /* pixel map offset values for current line (5.11 format) */
-  uint32 xoffset = (int16) *gfx.tracePtr++;
-  uint32 yoffset = (int16) *gfx.tracePtr++;
+  line.xoffset = (int16) *gfx.tracePtr++;
+  line.yoffset = (int16) *gfx.tracePtr++;
+
+  /* check if stamp map is repeated (stamp map range) or not (24-bit range) */
+  line.posMask = (scd.regs[0x58>>1].byte.l & 0x01) ? gfx.dotMask : 0xffffff;
+
+  /* stamp size */
+  line.size = (scd.regs[0x58>>1].byte.l & 0x02) << 2;
 
   /* process all dots */
-  while (width--)
+  while (width)
   {
-    /* check if stamp map is repeated */
-    if (scd.regs[0x58>>1].byte.l & 0x01)
-    {
-      /* stamp map range */
-      xpos &= gfx.dotMask;
-      ypos &= gfx.dotMask;
-    }
-    else
+    /* remaining dots in current cell row */
+    count = 8 - (bufferIndex & 7);
+    if (count > width)
     {
-      /* 24-bit range */
-      xpos &= 0xffffff;
-      ypos &= 0xffffff;
+      count = width;
     }
 
-    /* check if pixel is outside stamp map */
-    if ((xpos | ypos) & ~gfx.dotMask)
+    /* image buffer row address (2 pixels/byte) */
+    address = bufferIndex >> 1;
+    line.row = address & ~3;
+
+    if (!gfx_dots(pixels, &line, count))
     {
-      /* force pixel output to 0 */
-      pixel_out = 0x00;
+      i = 0;
+
+      /* first pixel is a right pixel */
+      if (bufferIndex & 1)
+      {
+        pixel_in = READ_BYTE(scd.word_ram_2M, address);
+        WRITE_BYTE(scd.word_ram_2M, address, prio[pixel_in][(pixel_in & 0xf0) | pixels[0]]);
+        address++;
+        i++;
+      }
+
+      /* pixel pairs (priority mode applies to each pixel separately) */
+      for (; (i + 1) < count; i += 2)
+      {
+        pixel_in = READ_BYTE(scd.word_ram_2M, address);
+        WRITE_BYTE(scd.word_ram_2M, address, prio[pixel_in][(pixels[i] << 4) | pixels[i + 1]]);
+        address++;
+      }
+
+      /* last pixel is a left pixel */
+      if (i < count)
+      {
+        pixel_in = READ_BYTE(scd.word_ram_2M, address);
+        WRITE_BYTE(scd.word_ram_2M, address, prio[pixel_in][(pixels[i] << 4) | (pixel_in & 0x0f)]);
+      }
     }
     else
     {
-      /* read stamp map table data */
-      stamp_data = gfx.mapPtr[(xpos >> gfx.stampShift) | ((ypos >> gfx.stampShift) << gfx.mapShift)];
-
-      /* stamp generator base index                                     */
-      /* sss ssssssss ccyyyxxx (16x16) or sss sssssscc ccyyyxxx (32x32) */
-      /* with:  s = stamp number (1 stamp = 16x16 or 32x32 pixels)      */
-      /*        c = cell offset  (0-3 for 16x16, 0-15 for 32x32)        */
-      /*      yyy = line offset  (0-7)                                  */
-      /*      xxx = pixel offset (0-7)                                  */
-      stamp_index = (stamp_data & 0x7ff) << 8;
-
-      if (stamp_index)
+      /* stamp data overlaps image buffer: fetch & write dots one by one */
+      gfx_line_t dot = line;
+
+      for (i=0; i<count; i++)
       {
-        /* extract HFLIP & ROTATION bits */
-        stamp_data = (stamp_data >> 13) & 7;
-
-        /* cell offset (0-3 or 0-15)                             */
-        /* table entry = yyxxshrr (8 bits)                       */
-        /* with: yy = cell row  (0-3) = (ypos >> (11 + 3)) & 3   */
-        /*       xx = cell column (0-3) = (xpos >> (11 + 3)) & 3 */
-        /*        s = stamp size (0=16x16, 1=32x32)              */
-        /*      hrr = HFLIP & ROTATION bits                      */
-        stamp_index |= gfx.lut_cell[stamp_data | ((scd.regs[0x58>>1].byte.l & 0x02) << 2 ) | ((ypos >> 8) & 0xc0) | ((xpos >> 10) & 0x30)] << 6;
-            
-        /* pixel  offset (0-63)                              */
-        /* table entry = yyyxxxhrr (9 bits)                  */
-        /* with: yyy = pixel row  (0-7) = (ypos >> 11) & 7   */
-        /*       xxx = pixel column (0-7) = (xpos >> 11) & 7 */
-        /*       hrr = HFLIP & ROTATION bits                 */
-        stamp_index |= gfx.lut_pixel[stamp_data | ((xpos >> 8) & 0x38) | ((ypos >> 5) & 0x1c0)];
-
-        /* read pixel pair (2 pixels/byte) */
-        pixel_out = READ_BYTE(scd.word_ram_2M, stamp_index >> 1);
-
-        /* extract left or rigth pixel */
-        if (stamp_index & 1)
+        gfx_dots_c(pixels, &dot, 1);
+        dot.xpos += dot.xoffset;
+        dot.ypos += dot.yoffset;
+
+        pixel_in = READ_BYTE(scd.word_ram_2M, address);
+        if ((bufferIndex + i) & 1)
         {
-           pixel_out &= 0x0f;
+          WRITE_BYTE(scd.word_ram_2M, address, prio[pixel_in][(pixel_in & 0xf0) | pixels[0]]);
+          address++;
         }
         else
         {
-           pixel_out >>= 4;
+          WRITE_BYTE(scd.word_ram_2M, address, prio[pixel_in][(pixels[0] << 4) | (pixel_in & 0x0f)]);
         }
       }
-      else
-      {
-        /* stamp 0 is not used: force pixel output to 0 */
-        pixel_out = 0x00;
-      }
     }
 
-    /* read out paired pixel data */
-    pixel_in = READ_BYTE(scd.word_ram_2M, bufferIndex >> 1);
-
-    /* update left or rigth pixel */
-    if (bufferIndex & 1)
-    {
-      pixel_out |= (pixel_in & 0xf0);
-    }
-    else
-    {
-      pixel_out = (pixel_out << 4) | (pixel_in & 0x0f);
-    }
+    MARK_DIRTY(DIRTY_WORD_RAM_2M, line.row);
 
-    /* priority mode write */
-    pixel_out = gfx.lut_prio[(scd.regs[0x02>>1].w >> 3) & 0x03][pixel_in][pixel_out];
-
-    /* write data to image buffer */
-    WRITE_BYTE(scd.word_ram_2M, bufferIndex >> 1, pixel_out);
-
-    /* check current pixel position  */
-    if ((bufferIndex & 7) != 7)
-    {
-      /* next pixel */
-      bufferIndex++;
-    }
-    else
-    {
-      /* next cell: increment image buffer offset by one column (minus 7 pixels) */
-      bufferIndex += gfx.bufferOffset;
-    }
+    /* next cell: increment image buffer offset by one column (minus 7 pixels) */
+    bufferIndex += count - 1 + gfx.bufferOffset;
 
     /* increment pixel position */
-    xpos += xoffset;
-    ypos += yoffset;
+    line.xpos += count * line.xoffset;
+    line.ypos += count * line.yoffset;
+    width -= count;
   }
 }
 
@@ -663,6 +829,8 @@ void gfx_start(unsigned int base, int cycles)
 
 void gfx_update(int cycles)
 {
+  PROFILE_BEGIN(PROFILE_GFX_UPDATE);
+
   /* synchronize GFX chip with SUB-CPU */
   cycles -= gfx.cycles;
 
@@ -726,4 +894,6 @@ void gfx_update(int cycles)
       gfx.bufferStart += 8;
     }
   }
+
+  PROFILE_END(PROFILE_GFX_UPDATE);
 }
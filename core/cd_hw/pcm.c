@@ -117,6 +117,8 @@ void pcm_run(unsigned int length)
 #ifdef LOG_PCM
   error("[%d][%d]run %d PCM samples (from %d)\n", v_counter, s68k.cycles, length, pcm.cycles);
 #endif
+  PROFILE_BEGIN(PROFILE_PCM_RUN);
+
   /* check if PCM chip is running */
   if (pcm.enabled)
   {
@@ -218,6 +220,8 @@ void pcm_run(unsigned int length)
 
   /* update PCM master clock counter */
   pcm.cycles += length * PCM_SCYCLES_RATIO;
+
+  PROFILE_END(PROFILE_PCM_RUN);
 }
 
 void pcm_update(unsigned int samples)
@@ -111,6 +111,7 @@ void prg_ram_dma_w(unsigned int words)
 
     /* write 16-bit word to PRG-RAM */
     *(uint16 *)(scd.prg_ram + dst_index) = data ;
+    MARK_DIRTY(DIRTY_PRG_RAM, dst_index);
 
     /* increment CDC buffer source address */
     src_index = (src_index + 2) & 0x3ffe;
@@ -129,6 +130,7 @@ static void prg_ram_write_byte(unsigned int address, unsigned int data)
   if (address >= (scd.regs[0x02>>1].byte.h << 9))
   {
     WRITE_BYTE(scd.prg_ram, address, data);
+    MARK_DIRTY(DIRTY_PRG_RAM, address);
     return;
   }
 #ifdef LOGERROR
@@ -142,6 +144,7 @@ static void prg_ram_write_word(unsigned int address, unsigned int data)
   if (address >= (scd.regs[0x02>>1].byte.h << 9))
   {
     *(uint16 *)(scd.prg_ram + address) = data;
+    MARK_DIRTY(DIRTY_PRG_RAM, address);
     return;
   }
 #ifdef LOGERROR
@@ -175,6 +178,7 @@ static void prg_ram_z80_write_byte(unsigned int address, unsigned int data)
   else
   {
     WRITE_BYTE(m68k.memory_map[offset].base, address & 0xffff, data);
+    state_mark_dirty(m68k.memory_map[offset].base + (address & 0xffff));
   }
 }
 
@@ -213,6 +217,7 @@ static void prg_ram_m68k_write_byte(unsigned int address, unsigned int data)
   else
   {
     WRITE_BYTE(m68k.memory_map[offset].base, address & 0xffff, data);
+    state_mark_dirty(m68k.memory_map[offset].base + (address & 0xffff));
   }
 }
 
@@ -227,6 +232,7 @@ static void prg_ram_m68k_write_word(unsigned int address, unsigned int data)
   else
   {
     *(uint16 *)(m68k.memory_map[offset].base + (address & 0xffff)) = data;
+    state_mark_dirty(m68k.memory_map[offset].base + (address & 0xffff));
   }
 }
 
@@ -256,6 +262,7 @@ static void word_ram_z80_write_byte(unsigned int address, unsigned int data)
   else
   {
     WRITE_BYTE(m68k.memory_map[offset].base, address & 0xffff, data);
+    state_mark_dirty(m68k.memory_map[offset].base + (address & 0xffff));
   }
 }
 
@@ -294,6 +301,7 @@ static void word_ram_m68k_write_byte(unsigned int address, unsigned int data)
   else
   {
     WRITE_BYTE(m68k.memory_map[offset].base, address & 0xffff, data);
+    state_mark_dirty(m68k.memory_map[offset].base + (address & 0xffff));
   }
 }
 
@@ -308,6 +316,7 @@ static void word_ram_m68k_write_word(unsigned int address, unsigned int data)
   else
   {
     *(uint16 *)(m68k.memory_map[offset].base + (address & 0xffff)) = data;
+    state_mark_dirty(m68k.memory_map[offset].base + (address & 0xffff));
   }
 }
 
@@ -346,6 +355,7 @@ static void word_ram_s68k_write_byte(unsigned int address, unsigned int data)
   else
   {
     WRITE_BYTE(s68k.memory_map[offset].base, address & 0xffff, data);
+    state_mark_dirty(s68k.memory_map[offset].base + (address & 0xffff));
   }
 }
 
@@ -360,6 +370,7 @@ static void word_ram_s68k_write_word(unsigned int address, unsigned int data)
   else
   {
     *(uint16 *)(s68k.memory_map[offset].base + (address & 0xffff)) = data;
+    state_mark_dirty(s68k.memory_map[offset].base + (address & 0xffff));
   }
 }
 
@@ -702,6 +713,7 @@ INLINE void word_ram_switch(uint8 mode)
       *ptr2++=*ptr1++;
       *ptr3++=*ptr1++;
     }
+    MARK_DIRTY_RANGE(DIRTY_WORD_RAM, 0, sizeof(scd.word_ram));
   }
   else
   {
@@ -711,6 +723,7 @@ INLINE void word_ram_switch(uint8 mode)
       *ptr1++=*ptr2++;
       *ptr1++=*ptr3++;
     }
+    MARK_DIRTY_RANGE(DIRTY_WORD_RAM_2M, 0, sizeof(scd.word_ram_2M));
 
     /* MAIN-CPU: $200000-$21FFFF is mapped to 256K Word-RAM (lower 128K) */
     for (i=scd.cartridge.boot+0x20; i<scd.cartridge.boot+0x22; i++)
@@ -1721,18 +1734,18 @@ int scd_context_save(uint8 *state)
   bufferptr += pcm_context_save(&state[bufferptr]);
 
   /* PRG-RAM */
-  save_param(scd.prg_ram, sizeof(scd.prg_ram));
+  save_pages(scd.prg_ram, sizeof(scd.prg_ram), DIRTY_PRG_RAM);
 
   /* Word-RAM */
   if (scd.regs[0x03>>1].byte.l & 0x04)
   {
     /* 1M mode */
-    save_param(scd.word_ram, sizeof(scd.word_ram));
+    save_pages(scd.word_ram[0], sizeof(scd.word_ram), DIRTY_WORD_RAM);
   }
   else
   {
     /* 2M mode */
-    save_param(scd.word_ram_2M, sizeof(scd.word_ram_2M));
+    save_pages(scd.word_ram_2M, sizeof(scd.word_ram_2M), DIRTY_WORD_RAM_2M);
   }
 
   /* MAIN-CPU & SUB-CPU polling */
@@ -1807,7 +1820,7 @@ int scd_context_load(uint8 *state)
   bufferptr += pcm_context_load(&state[bufferptr]);
 
   /* PRG-RAM */
-  load_param(scd.prg_ram, sizeof(scd.prg_ram));
+  load_pages(scd.prg_ram, sizeof(scd.prg_ram), DIRTY_PRG_RAM);
 
   /* PRG-RAM 128K bank mapped on MAIN-CPU side */
   m68k.memory_map[scd.cartridge.boot + 0x02].base = scd.prg_ram + ((scd.regs[0x03>>1].byte.l & 0xc0) << 11);
@@ -1837,7 +1850,7 @@ int scd_context_load(uint8 *state)
   if (scd.regs[0x03>>1].byte.l & 0x04)
   {
     /* 1M Mode */
-    load_param(scd.word_ram, sizeof(scd.word_ram));
+    load_pages(scd.word_ram[0], sizeof(scd.word_ram), DIRTY_WORD_RAM);
 
     if (scd.regs[0x03>>1].byte.l & 0x01)
     {
@@ -1923,7 +1936,7 @@ int scd_context_load(uint8 *state)
   else
   {
     /* 2M mode */
-    load_param(scd.word_ram_2M, sizeof(scd.word_ram_2M));
+    load_pages(scd.word_ram_2M, sizeof(scd.word_ram_2M), DIRTY_WORD_RAM_2M);
 
     /* MAIN-CPU: $200000-$21FFFF is mapped to 256K Word-RAM (upper 128K) */
     for (i=scd.cartridge.boot+0x20; i<scd.cartridge.boot+0x22; i++)
@@ -1969,6 +1982,9 @@ int scd_context_load(uint8 *state)
   load_param(&tmp16, 2);
   *(uint16 *)(m68k.memory_map[scd.cartridge.boot].base + 0x72) = tmp16;
 
+  /* interrupts pending before state was loaded should not be processed when SR is restored */
+  s68k.int_level = 0;
+
   /* SUB-CPU registers */
   load_param(&tmp32, 4); s68k_set_reg(M68K_REG_D0, tmp32);
   load_param(&tmp32, 4); s68k_set_reg(M68K_REG_D1, tmp32);
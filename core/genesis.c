@@ -42,18 +42,18 @@
 #include "shared.h"
 
 #ifdef USE_DYNAMIC_ALLOC
-external_t *ext;
+THREAD_CONTEXT external_t *ext;
 #else                     /* External Hardware (Cartridge, CD unit, ...) */
-external_t ext;
+THREAD_CONTEXT external_t ext;
 #endif
-uint8 boot_rom[0x800];    /* Genesis BOOT ROM   */
-uint8 work_ram[0x10000];  /* 68K RAM  */
-uint8 zram[0x2000];       /* Z80 RAM  */
-uint32 zbank;             /* Z80 bank window address */
-uint8 zstate;             /* Z80 bus state (d0 = BUSACK, d1 = /RESET) */
-uint8 pico_current;       /* PICO current page */
+THREAD_CONTEXT uint8 boot_rom[0x800];    /* Genesis BOOT ROM   */
+THREAD_CONTEXT uint8 work_ram[0x10000];  /* 68K RAM  */
+THREAD_CONTEXT uint8 zram[0x2000];       /* Z80 RAM  */
+THREAD_CONTEXT uint32 zbank;             /* Z80 bank window address */
+THREAD_CONTEXT uint8 zstate;             /* Z80 bus state (d0 = BUSACK, d1 = /RESET) */
+THREAD_CONTEXT uint8 pico_current;       /* PICO current page */
 
-static uint8 tmss[4];     /* TMSS security register */
+static THREAD_CONTEXT uint8 tmss[4];     /* TMSS security register */
 
 /*--------------------------------------------------------------------------*/
 /* Init, reset, shutdown functions                                          */
@@ -72,6 +72,7 @@ void gen_init(void)
     /* initialize main 68k */
     m68k_init();
     m68k.aerr_enabled = config.addr_error; 
+    m68k.skip.enabled = 0;
 
     /* initialize main 68k memory map */
 
@@ -231,6 +232,9 @@ void gen_init(void)
 
 void gen_reset(int hard_reset)
 {
+  /* next incremental savestate should include all memory pages */
+  state_mark_all();
+
   /* System Reset */
   if (hard_reset)
   {
@@ -362,6 +366,65 @@ void gen_reset(int hard_reset)
   }
 }
 
+/* Same as gen_reset(1) but only for hardware state that is not included in savestates (see system_restore) */
+void gen_restore(void)
+{
+  /* next incremental savestate should include all memory pages */
+  state_mark_all();
+
+  if ((system_hw & SYSTEM_PBC) == SYSTEM_MD)
+  {
+    /* Lock-ON hardware internal state is not saved */
+    switch (config.lock_on)
+    {
+      case TYPE_GG:
+      {
+        ggenie_reset(1);
+        break;
+      }
+
+      case TYPE_AR:
+      {
+        areplay_reset(1);
+        break;
+      }
+
+      default:
+      {
+        break;
+      }
+    }
+
+    /* TMSS register is not saved (VDP access is restored by state_load) */
+    if ((config.bios & 1) && (system_hw == SYSTEM_MD))
+    {
+      memset(tmss, 0x00, sizeof(tmss));
+
+      /* check if BOOT ROM is loaded */
+      if (system_bios & SYSTEM_MD)
+      {
+        /* save default cartridge slot mapping */
+        cart.base = m68k.memory_map[0].base;
+
+        /* BOOT ROM is mapped at $000000-$0007FF */
+        m68k.memory_map[0].base = boot_rom;
+      }
+    }
+  }
+}
+
+void gen_shutdown(void)
+{
+#ifdef USE_DYNAMIC_ALLOC
+  /* release Cartridge / CD hardware memory */
+  if (ext)
+  {
+    free(ext);
+    ext = NULL;
+  }
+#endif
+}
+
 /*-----------------------------------------------------------------------*/
 /*  OS ROM / TMSS register control functions (Genesis mode)              */
 /*-----------------------------------------------------------------------*/
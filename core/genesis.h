@@ -55,20 +55,22 @@ typedef union
 
 /* Global variables */
 #ifdef USE_DYNAMIC_ALLOC
-extern external_t *ext;
+extern THREAD_CONTEXT external_t *ext;
 #else
-extern external_t ext;
+extern THREAD_CONTEXT external_t ext;
 #endif
-extern uint8 boot_rom[0x800];
-extern uint8 work_ram[0x10000];
-extern uint8 zram[0x2000];
-extern uint32 zbank;
-extern uint8 zstate;
-extern uint8 pico_current;
+extern THREAD_CONTEXT uint8 boot_rom[0x800];
+extern THREAD_CONTEXT uint8 work_ram[0x10000];
+extern THREAD_CONTEXT uint8 zram[0x2000];
+extern THREAD_CONTEXT uint32 zbank;
+extern THREAD_CONTEXT uint8 zstate;
+extern THREAD_CONTEXT uint8 pico_current;
 
 /* Function prototypes */
 extern void gen_init(void);
 extern void gen_reset(int hard_reset);
+extern void gen_restore(void);
+extern void gen_shutdown(void);
 extern void gen_tmss_w(unsigned int offset, unsigned int data);
 extern void gen_bankswitch_w(unsigned int data);
 extern unsigned int gen_bankswitch_r(void);
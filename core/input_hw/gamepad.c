@@ -40,20 +40,20 @@
 #include "shared.h"
 #include "gamepad.h"
 
-static struct
+static THREAD_CONTEXT struct
 {
   uint8 State;
   uint8 Counter;
   uint8 Timeout;
 } gamepad[MAX_DEVICES];
 
-static struct
+static THREAD_CONTEXT struct
 {
   uint8 Latch;
   uint8 Counter;
 } flipflop[2];
 
-static uint8 latch;
+static THREAD_CONTEXT uint8 latch;
 
 
 void gamepad_reset(int port)
@@ -145,8 +145,8 @@ typedef struct
 } t_input;
 
 /* Global variables */
-extern t_input input;
-extern int old_system[2];
+extern THREAD_CONTEXT t_input input;
+extern THREAD_CONTEXT int old_system[2];
 
 /* Function prototypes */
 extern void input_init(void);
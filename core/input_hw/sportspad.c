@@ -38,7 +38,7 @@
 
 #include "shared.h"
 
-static struct
+static THREAD_CONTEXT struct
 {
   uint8 State;
   uint8 Counter;
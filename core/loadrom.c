@@ -89,10 +89,10 @@ typedef struct
 } PERIPHERALINFO;
 
 
-ROMINFO rominfo;
-uint8 romtype;
+THREAD_CONTEXT ROMINFO rominfo;
+THREAD_CONTEXT uint8 romtype;
 
-static uint8 rom_region;
+static THREAD_CONTEXT uint8 rom_region;
 
 /***************************************************************************
  * Genesis ROM Manufacturers
@@ -60,8 +60,8 @@ typedef struct
 
 
 /* Global variables */
-extern ROMINFO rominfo;
-extern uint8 romtype;
+extern THREAD_CONTEXT ROMINFO rominfo;
+extern THREAD_CONTEXT uint8 romtype;
 
 /* Function prototypes */
 extern int load_bios(int system);
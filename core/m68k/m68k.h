@@ -227,11 +227,24 @@ typedef struct
   uint detected;
 } cpu_idle_t;
 
+/* 68k idle loop skipping */
+typedef struct
+{
+  uint enabled;   /* idle loop skipping enabled */
+  uint pc;        /* loop start address (target of last backward branch) */
+  uint cycle;     /* cycle count at last backward branch */
+  uint until;     /* cycle count until which values read since last backward branch remain unchanged */
+  uint io;        /* set while processing an I/O read with unpredictable result */
+  uint skipped;   /* skipped cycles count */
+  uint regs[31];  /* CPU registers (D0 to I0-I2) at last backward branch */
+} cpu_skip_t;
+
 typedef struct
 {
   cpu_memory_map memory_map[256]; /* memory mapping */
 
   cpu_idle_t poll;      /* polling detection */
+  cpu_skip_t skip;      /* idle loop skipping */
 
   uint cycles;          /* current master cycle count */ 
   uint cycle_end;       /* aimed master cycle count for current execution frame */
@@ -274,8 +287,8 @@ typedef struct
 } m68ki_cpu_core;
 
 /* CPU cores */
-extern m68ki_cpu_core m68k;
-extern m68ki_cpu_core s68k;
+extern THREAD_CONTEXT m68ki_cpu_core m68k;
+extern THREAD_CONTEXT m68ki_cpu_core s68k;
 
 
 /* ======================================================================== */
@@ -354,6 +367,14 @@ extern void s68k_pulse_reset(void);
 extern void m68k_run(unsigned int cycles);
 extern void s68k_run(unsigned int cycles);
 
+/* Notify idle loop skipping that value returned by current I/O read remains unchanged until given cycle count */
+extern void m68k_idle_read(unsigned int cycles);
+
+#ifdef USE_M68K_JIT
+/* Enable or disable translation of main CPU code to native code (enabled by default) */
+extern void m68k_jit_enable(int enable);
+#endif
+
 /* Set the IPL0-IPL2 pins on the CPU (IRQ).
  * A transition from < 7 to 7 will cause a non-maskable interrupt (NMI).
  * Setting IRQ to 0 will clear an interrupt request.
@@ -17,6 +17,7 @@ extern int vdp_68k_irq_ack(int int_level);
 
 #include "m68kconf.h"
 #include "m68kcpu.h"
+#include "profile.h"
 #include "m68kops.h"
 
 /* ======================================================================== */
@@ -27,9 +28,9 @@ extern int vdp_68k_irq_ack(int int_level);
 static unsigned char m68ki_cycles[0x10000];
 #endif
 
-static int irq_latency;
+static THREAD_CONTEXT int irq_latency;
 
-m68ki_cpu_core m68k;
+THREAD_CONTEXT m68ki_cpu_core m68k;
 
 
 /* ======================================================================== */
@@ -253,6 +254,334 @@ void m68k_set_irq_delay(unsigned int int_level)
   m68ki_check_interrupts(); /* Level triggered (IRQ) */
 }
 
+#ifdef USE_M68K_JIT
+/* ======================================================================== */
+/* ======================== X86-64 BLOCK TRANSLATOR ======================= */
+/* ======================================================================== */
+
+/* Basic blocks of 68k code are recorded while being interpreted, then
+ * translated to x86-64 code calling opcode handlers in sequence, with opcode,
+ * PC and cycle count of each instruction as immediate values. This removes
+ * instruction fetch, cycle table lookup and indirect calls from execution.
+ *
+ * Translated code remains exact: before each instruction, opcode is read from
+ * current memory map and compared with translated one (RAM code modifications,
+ * bank switching) and, after each instruction, PC is compared with recorded
+ * one (branches, exceptions, interrupts). Block is exited as soon as a check
+ * fails or cycle count is reached and the interpreter takes over from there.
+ */
+
+#if !defined(__x86_64__) || defined(_WIN32)
+#error "USE_M68K_JIT requires a x86-64 (System V ABI) host"
+#endif
+
+#include <stddef.h>
+#include <string.h>
+#include <sys/mman.h>
+
+#define M68K_JIT_BLOCKS    0x4000    /* translated blocks cache entries */
+#define M68K_JIT_INSTRS    32        /* max. instructions per block */
+#define M68K_JIT_CODE_SIZE 0x800000  /* native code buffer size */
+#define M68K_JIT_MAX_CODE  (128 + M68K_JIT_INSTRS * 128)
+
+/* translated code exit status */
+#define M68K_JIT_DONE  0  /* all instructions executed or cycle count reached */
+#define M68K_JIT_EXIT  1  /* PC or opcode differs from translated code */
+#define M68K_JIT_STALE 2  /* first opcode differs from translated code */
+
+typedef struct
+{
+  uint pc;
+  int (*code)(unsigned int cycles); /* translated code */
+  uint interpreted;                 /* block is left to the interpreter */
+  uint runs;
+  uint exits;
+  uint stale;                       /* translations invalidated by code modification */
+} m68k_jit_block;
+
+typedef struct
+{
+  unsigned char *code;   /* native code buffer */
+  uint size;             /* used native code buffer size */
+  m68k_jit_block blocks[M68K_JIT_BLOCKS];
+  uint count;                  /* recorded instructions */
+  uint pc[M68K_JIT_INSTRS];    /* recorded instructions PC */
+  uint ir[M68K_JIT_INSTRS];    /* recorded instructions opcode */
+  uint next[M68K_JIT_INSTRS];  /* recorded instructions next PC */
+} m68k_jit_t;
+
+static THREAD_CONTEXT m68k_jit_t m68k_jit;
+static THREAD_CONTEXT int m68k_jit_enabled = 1;
+
+#define OFS_CPU(field) ((uint)offsetof(m68ki_cpu_core, field))
+#define OFS_MAP(bank) ((uint)(offsetof(m68ki_cpu_core, memory_map) + (bank) * sizeof(cpu_memory_map) + offsetof(cpu_memory_map, base)))
+
+static unsigned char *m68k_jit_emit32(unsigned char *p, uint data)
+{
+  p[0] = data;
+  p[1] = data >> 8;
+  p[2] = data >> 16;
+  p[3] = data >> 24;
+  return p + 4;
+}
+
+static unsigned char *m68k_jit_emit64(unsigned char *p, const void *ptr)
+{
+  unsigned long data = (unsigned long)ptr;
+  p = m68k_jit_emit32(p, data);
+  return m68k_jit_emit32(p, data >> 32);
+}
+
+/* jmp/jcc rel32 (opcode already emitted) */
+static unsigned char *m68k_jit_emit_rel(unsigned char *p, unsigned char *target)
+{
+  return m68k_jit_emit32(p, (uint)(target - (p + 4)));
+}
+
+/* [r12 + disp32] operand (ModRM reg field already shifted) */
+static unsigned char *m68k_jit_emit_mem(unsigned char *p, int reg, uint disp)
+{
+  *p++ = 0x84 | reg;
+  *p++ = 0x24;
+  return m68k_jit_emit32(p, disp);
+}
+
+/* pop rbx, pop r13, pop r12, ret */
+static unsigned char *m68k_jit_emit_ret(unsigned char *p)
+{
+  *p++ = 0x5b;
+  *p++ = 0x41; *p++ = 0x5d;
+  *p++ = 0x41; *p++ = 0x5c;
+  *p++ = 0xc3;
+  return p;
+}
+
+static void m68k_jit_translate(void)
+{
+  uint i, n = m68k_jit.count;
+  uint pc = m68k_jit.pc[0];
+  uint bank = (pc >> 16) & 0xff;
+  m68k_jit_block *block;
+  unsigned char *p, *l_done, *l_exit, *l_stale, *l_ir;
+
+  m68k_jit.count = 0;
+
+  if (!m68k_jit.code)
+  {
+    void *code = mmap(NULL, M68K_JIT_CODE_SIZE, PROT_READ | PROT_WRITE | PROT_EXEC, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    if (code == MAP_FAILED)
+    {
+      /* fall back to interpreter */
+      m68k_jit_enabled = 0;
+      return;
+    }
+    m68k_jit.code = code;
+  }
+
+  /* flush all translated blocks when native code buffer is full */
+  if ((m68k_jit.size + M68K_JIT_MAX_CODE) > M68K_JIT_CODE_SIZE)
+  {
+    memset(m68k_jit.blocks, 0, sizeof(m68k_jit.blocks));
+    m68k_jit.size = 0;
+  }
+
+  p = m68k_jit.code + m68k_jit.size;
+
+  /* exit stubs (placed before block entry so that all jumps are resolved) */
+  l_done = p;
+  *p++ = 0x31; *p++ = 0xc0;                         /* xor eax,eax */
+  p = m68k_jit_emit_ret(p);
+  l_exit = p;
+  *p++ = 0xb8; p = m68k_jit_emit32(p, M68K_JIT_EXIT); /* mov eax,EXIT */
+  p = m68k_jit_emit_ret(p);
+  l_stale = p;
+  *p++ = 0xb8; p = m68k_jit_emit32(p, M68K_JIT_STALE); /* mov eax,STALE */
+  p = m68k_jit_emit_ret(p);
+
+  /* opcode modified by handler (IRQ latency emulation): use cycle count of new opcode */
+  l_ir = p;
+  *p++ = 0x41; *p++ = 0x8b; p = m68k_jit_emit_mem(p, 0 << 3, OFS_CPU(ir));   /* mov eax,[r12+ir] */
+  *p++ = 0x48; *p++ = 0xba; p = m68k_jit_emit64(p, CYC_INSTRUCTION);        /* mov rdx,cycles table */
+  *p++ = 0x0f; *p++ = 0xb6; *p++ = 0x04; *p++ = 0x02;                      /* movzx eax,byte [rdx+rax] */
+  *p++ = 0x41; *p++ = 0x01; p = m68k_jit_emit_mem(p, 0 << 3, OFS_CPU(cycles)); /* add [r12+cycles],eax */
+  *p++ = 0xe9; p = m68k_jit_emit_rel(p, l_exit);                           /* jmp exit */
+
+  /* block entry: r12 = CPU context, r13d = cycle count to reach */
+  block = &m68k_jit.blocks[(pc >> 1) & (M68K_JIT_BLOCKS - 1)];
+  if (block->pc != pc)
+  {
+    block->stale = 0;
+  }
+  block->pc = pc;
+  block->code = (int (*)(unsigned int))p;
+  block->interpreted = 0;
+  block->runs = 0;
+  block->exits = 0;
+  *p++ = 0x41; *p++ = 0x54;                                 /* push r12 */
+  *p++ = 0x41; *p++ = 0x55;                                 /* push r13 */
+  *p++ = 0x53;                                              /* push rbx */
+  *p++ = 0x49; *p++ = 0xbc; p = m68k_jit_emit64(p, &m68ki_cpu); /* mov r12,&cpu */
+  *p++ = 0x41; *p++ = 0x89; *p++ = 0xfd;                    /* mov r13d,edi */
+
+  for (i=0; i<n; i++)
+  {
+    uint ir = m68k_jit.ir[i];
+
+    if (i > 0)
+    {
+      /* cmp [r12+cycles],r13d / jae done */
+      *p++ = 0x45; *p++ = 0x39; p = m68k_jit_emit_mem(p, 5 << 3, OFS_CPU(cycles));
+      *p++ = 0x0f; *p++ = 0x83; p = m68k_jit_emit_rel(p, l_done);
+    }
+
+    /* mov rax,[r12+memory_map[bank].base] / cmp word [rax+offset],opcode / jne exit */
+    *p++ = 0x49; *p++ = 0x8b; p = m68k_jit_emit_mem(p, 0 << 3, OFS_MAP(bank));
+    *p++ = 0x66; *p++ = 0x81; *p++ = 0xb8; p = m68k_jit_emit32(p, m68k_jit.pc[i] & 0xffff);
+    *p++ = ir; *p++ = ir >> 8;
+    *p++ = 0x0f; *p++ = 0x85; p = m68k_jit_emit_rel(p, i ? l_exit : l_stale);
+
+    /* mov [r12+pc],pc+2 / mov [r12+ir],opcode */
+    *p++ = 0x41; *p++ = 0xc7; p = m68k_jit_emit_mem(p, 0 << 3, OFS_CPU(pc)); p = m68k_jit_emit32(p, m68k_jit.pc[i] + 2);
+    *p++ = 0x41; *p++ = 0xc7; p = m68k_jit_emit_mem(p, 0 << 3, OFS_CPU(ir)); p = m68k_jit_emit32(p, ir);
+
+    /* mov rax,handler / call rax */
+    *p++ = 0x48; *p++ = 0xb8; p = m68k_jit_emit64(p, (const void *)m68ki_instruction_jump_table[ir]);
+    *p++ = 0xff; *p++ = 0xd0;
+
+    /* cmp [r12+ir],opcode / jne ir / add [r12+cycles],cycles */
+    *p++ = 0x41; *p++ = 0x81; p = m68k_jit_emit_mem(p, 7 << 3, OFS_CPU(ir)); p = m68k_jit_emit32(p, ir);
+    *p++ = 0x0f; *p++ = 0x85; p = m68k_jit_emit_rel(p, l_ir);
+    *p++ = 0x41; *p++ = 0x81; p = m68k_jit_emit_mem(p, 0 << 3, OFS_CPU(cycles)); p = m68k_jit_emit32(p, CYC_INSTRUCTION[ir]);
+
+    if (i < (n - 1))
+    {
+      /* cmp [r12+pc],next / jne exit */
+      *p++ = 0x41; *p++ = 0x81; p = m68k_jit_emit_mem(p, 7 << 3, OFS_CPU(pc)); p = m68k_jit_emit32(p, m68k_jit.next[i]);
+      *p++ = 0x0f; *p++ = 0x85; p = m68k_jit_emit_rel(p, l_exit);
+    }
+  }
+
+  /* jmp done */
+  *p++ = 0xe9; p = m68k_jit_emit_rel(p, l_done);
+
+  m68k_jit.size = p - m68k_jit.code;
+}
+
+/* Record interpreted instruction, block is translated once it ends */
+static void m68k_jit_record(uint pc, uint ir)
+{
+  uint n = m68k_jit.count;
+  uint next = REG_PC;
+
+  /* recorded instructions must be executed in sequence */
+  if (n && (m68k_jit.next[n - 1] != pc))
+  {
+    n = 0;
+  }
+
+  m68k_jit.pc[n] = pc;
+  m68k_jit.ir[n] = ir;
+  m68k_jit.next[n] = next;
+  m68k_jit.count = ++n;
+
+  /* block ends with any instruction not followed by next one in same bank (branch, jump, exception, ...) */
+  if ((next <= pc) || (next > (pc + 10)) || ((next ^ m68k_jit.pc[0]) & 0xff0000) || (n == M68K_JIT_INSTRS))
+  {
+    m68k_jit_translate();
+  }
+}
+
+static void m68k_jit_run(unsigned int cycles)
+{
+  /* start a new block */
+  m68k_jit.count = 0;
+
+  while (m68k.cycles < cycles)
+  {
+    uint pc = REG_PC;
+    m68k_jit_block *block = &m68k_jit.blocks[(pc >> 1) & (M68K_JIT_BLOCKS - 1)];
+
+    if (block->pc == pc)
+    {
+      if (block->code)
+      {
+        /* recorded instructions lead to an already translated block */
+        if (m68k_jit.count)
+        {
+          m68k_jit_translate();
+          continue;
+        }
+
+        switch (block->code(cycles))
+        {
+          case M68K_JIT_STALE:
+          {
+            /* code has been modified since translation, frequently modified code is left to the interpreter */
+            block->code = NULL;
+            if (++block->stale == 8)
+            {
+              block->interpreted = 1;
+            }
+            continue;
+          }
+
+          case M68K_JIT_EXIT:
+          {
+            block->exits++;
+            break;
+          }
+        }
+
+        /* blocks that are often left early (I/O accesses triggering interrupts or bank switching, */
+        /* conditional branches, ...) do not benefit from translation and are left to the interpreter */
+        if (++block->runs == 64)
+        {
+          if (block->exits > 16)
+          {
+            block->code = NULL;
+            block->interpreted = 1;
+          }
+          block->runs = block->exits = 0;
+        }
+        continue;
+      }
+
+      if (block->interpreted)
+      {
+        m68k_jit.count = 0;
+        REG_IR = m68ki_read_imm_16();
+        m68ki_instruction_jump_table[REG_IR]();
+        USE_CYCLES(CYC_INSTRUCTION[REG_IR]);
+        continue;
+      }
+    }
+
+    /* interpret & record instruction */
+    REG_IR = m68ki_read_imm_16();
+    m68ki_instruction_jump_table[REG_IR]();
+    USE_CYCLES(CYC_INSTRUCTION[REG_IR]);
+    if (m68k_jit_enabled)
+    {
+      m68k_jit_record(pc, REG_IR);
+    }
+  }
+}
+
+void m68k_jit_enable(int enable)
+{
+  m68k_jit_enabled = enable;
+}
+#endif
+
+void m68k_idle_read(unsigned int cycles)
+{
+  m68k.skip.io = 0;
+  if (cycles < m68k.skip.until)
+  {
+    m68k.skip.until = cycles;
+  }
+}
+
 void m68k_run(unsigned int cycles) 
 {
   /* Make sure CPU is not already ahead */
@@ -261,6 +590,11 @@ void m68k_run(unsigned int cycles)
     return;
   }
 
+  /* Hardware state might have been modified since last time slice */
+  m68k.skip.until = 0;
+
+  PROFILE_BEGIN(PROFILE_M68K_RUN);
+
   /* Check interrupt mask to process IRQ if needed */
   m68ki_check_interrupts();
 
@@ -268,6 +602,7 @@ void m68k_run(unsigned int cycles)
   if (CPU_STOPPED)
   {
     m68k.cycles = cycles;
+    PROFILE_END(PROFILE_M68K_RUN);
     return;
   }
 
@@ -280,6 +615,15 @@ void m68k_run(unsigned int cycles)
 #ifdef LOGVDP
   error("[%d][%d] m68k run to %d cycles (%x), irq mask = %x (%x)\n", v_counter, m68k.cycles, cycles, m68k.pc,FLAG_INT_MASK, CPU_INT_LEVEL);
 #endif
+
+#ifdef USE_M68K_JIT
+  if (m68k_jit_enabled)
+  {
+    m68k_jit_run(cycles);
+    PROFILE_END(PROFILE_M68K_RUN);
+    return;
+  }
+#endif
    
   while (m68k.cycles < cycles)
   {
@@ -299,19 +643,15 @@ void m68k_run(unsigned int cycles)
     /* Trace m68k_exception, if necessary */
     m68ki_exception_if_trace(); /* auto-disable (see m68kcpu.h) */
   }
+
+  PROFILE_END(PROFILE_M68K_RUN);
 }
 
 void m68k_init(void)
 {
 #ifdef BUILD_TABLES
-  static uint emulation_initialized = 0;
-
   /* The first call to this function initializes the opcode handler jump table */
-  if(!emulation_initialized)
-  {
-    m68ki_build_opcode_table();
-    emulation_initialized = 1;
-  }
+  RUN_ONCE(m68ki_build_opcode_table);
 #endif
 
 #if M68K_EMULATE_INT_ACK == OPT_ON
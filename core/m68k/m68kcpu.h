@@ -8,12 +8,14 @@
 #include <stdio.h>
 #include <stdlib.h>
 #include <limits.h>
+#include <string.h>
 
 #if M68K_EMULATE_ADDRESS_ERROR
 #include <setjmp.h>
 #endif /* M68K_EMULATE_ADDRESS_ERROR */
 
 #include "m68k.h"
+#include "state.h"
 
 
 /* ======================================================================== */
@@ -870,7 +872,14 @@ INLINE uint m68ki_read_8_fc(uint address, uint fc)
 
   m68ki_set_fc(fc) /* auto-disable (see m68kcpu.h) */
 
-  if (temp->read8) return (*temp->read8)(ADDRESS_68K(address));
+  if (temp->read8)
+  {
+    uint data;
+    m68ki_cpu.skip.io = 1;
+    data = (*temp->read8)(ADDRESS_68K(address));
+    if (m68ki_cpu.skip.io) m68ki_cpu.skip.until = 0;
+    return data;
+  }
   else return READ_BYTE(temp->base, (address) & 0xffff);
 }
 
@@ -882,7 +891,14 @@ INLINE uint m68ki_read_16_fc(uint address, uint fc)
   m68ki_check_address_error(address, MODE_READ, fc) /* auto-disable (see m68kcpu.h) */
   
   temp = &m68ki_cpu.memory_map[((address)>>16)&0xff];
-  if (temp->read16) return (*temp->read16)(ADDRESS_68K(address));
+  if (temp->read16)
+  {
+    uint data;
+    m68ki_cpu.skip.io = 1;
+    data = (*temp->read16)(ADDRESS_68K(address));
+    if (m68ki_cpu.skip.io) m68ki_cpu.skip.until = 0;
+    return data;
+  }
   else return *(uint16 *)(temp->base + ((address) & 0xffff));
 }
 
@@ -894,7 +910,17 @@ INLINE uint m68ki_read_32_fc(uint address, uint fc)
   m68ki_check_address_error(address, MODE_READ, fc) /* auto-disable (see m68kcpu.h) */
 
   temp = &m68ki_cpu.memory_map[((address)>>16)&0xff];
-  if (temp->read16) return ((*temp->read16)(ADDRESS_68K(address)) << 16) | ((*temp->read16)(ADDRESS_68K(address + 2)));
+  if (temp->read16)
+  {
+    uint data;
+    m68ki_cpu.skip.io = 1;
+    data = (*temp->read16)(ADDRESS_68K(address)) << 16;
+    if (m68ki_cpu.skip.io) m68ki_cpu.skip.until = 0;
+    m68ki_cpu.skip.io = 1;
+    data |= (*temp->read16)(ADDRESS_68K(address + 2));
+    if (m68ki_cpu.skip.io) m68ki_cpu.skip.until = 0;
+    return data;
+  }
   else return m68k_read_immediate_32(address);
 }
 
@@ -902,39 +928,64 @@ INLINE void m68ki_write_8_fc(uint address, uint fc, uint value)
 {
   cpu_memory_map *temp;
 
+  /* values read by idle loops may be modified */
+  m68ki_cpu.skip.until = 0;
+
   m68ki_set_fc(fc) /* auto-disable (see m68kcpu.h) */
 
   temp = &m68ki_cpu.memory_map[((address)>>16)&0xff];
   if (temp->write8) (*temp->write8)(ADDRESS_68K(address),value);
-  else WRITE_BYTE(temp->base, (address) & 0xffff, value);
+  else
+  {
+    WRITE_BYTE(temp->base, (address) & 0xffff, value);
+    state_mark_dirty(temp->base + ((address) & 0xffff));
+  }
 }
 
 INLINE void m68ki_write_16_fc(uint address, uint fc, uint value)
 {
   cpu_memory_map *temp;
 
+  /* values read by idle loops may be modified */
+  m68ki_cpu.skip.until = 0;
+
   m68ki_set_fc(fc) /* auto-disable (see m68kcpu.h) */
   m68ki_check_address_error(address, MODE_WRITE, fc); /* auto-disable (see m68kcpu.h) */
 
   temp = &m68ki_cpu.memory_map[((address)>>16)&0xff];
   if (temp->write16) (*temp->write16)(ADDRESS_68K(address),value);
-  else *(uint16 *)(temp->base + ((address) & 0xffff)) = value;
+  else
+  {
+    *(uint16 *)(temp->base + ((address) & 0xffff)) = value;
+    state_mark_dirty(temp->base + ((address) & 0xffff));
+  }
 }
 
 INLINE void m68ki_write_32_fc(uint address, uint fc, uint value)
 {
   cpu_memory_map *temp;
 
+  /* values read by idle loops may be modified */
+  m68ki_cpu.skip.until = 0;
+
   m68ki_set_fc(fc) /* auto-disable (see m68kcpu.h) */
   m68ki_check_address_error(address, MODE_WRITE, fc) /* auto-disable (see m68kcpu.h) */
 
   temp = &m68ki_cpu.memory_map[((address)>>16)&0xff];
   if (temp->write16) (*temp->write16)(ADDRESS_68K(address),value>>16);
-  else *(uint16 *)(temp->base + ((address) & 0xffff)) = value >> 16;
+  else
+  {
+    *(uint16 *)(temp->base + ((address) & 0xffff)) = value >> 16;
+    state_mark_dirty(temp->base + ((address) & 0xffff));
+  }
 
   temp = &m68ki_cpu.memory_map[((address + 2)>>16)&0xff];
   if (temp->write16) (*temp->write16)(ADDRESS_68K(address+2),value&0xffff);
-  else *(uint16 *)(temp->base + ((address + 2) & 0xffff)) = value;
+  else
+  {
+    *(uint16 *)(temp->base + ((address + 2) & 0xffff)) = value;
+    state_mark_dirty(temp->base + ((address + 2) & 0xffff));
+  }
 }
 
 
@@ -1076,6 +1127,7 @@ INLINE void m68ki_push_16(uint value)
   REG_SP = MASK_OUT_ABOVE_32(REG_SP - 2);
   /*m68ki_write_16(REG_SP, value);*/
   *(uint16 *)(m68ki_cpu.memory_map[(REG_SP>>16)&0xff].base + (REG_SP & 0xffff)) = value;
+  state_mark_dirty(m68ki_cpu.memory_map[(REG_SP>>16)&0xff].base + (REG_SP & 0xffff));
 }
 
 INLINE void m68ki_push_32(uint value)
@@ -1084,6 +1136,8 @@ INLINE void m68ki_push_32(uint value)
   /*m68ki_write_32(REG_SP, value);*/
   *(uint16 *)(m68ki_cpu.memory_map[(REG_SP>>16)&0xff].base + (REG_SP & 0xffff)) = value >> 16;
   *(uint16 *)(m68ki_cpu.memory_map[((REG_SP + 2)>>16)&0xff].base + ((REG_SP + 2) & 0xffff)) = value & 0xffff;
+  state_mark_dirty(m68ki_cpu.memory_map[(REG_SP>>16)&0xff].base + (REG_SP & 0xffff));
+  state_mark_dirty(m68ki_cpu.memory_map[((REG_SP + 2)>>16)&0xff].base + ((REG_SP + 2) & 0xffff));
 }
 
 INLINE uint m68ki_pull_16(void)
@@ -1126,14 +1180,55 @@ INLINE void m68ki_jump_vector(uint vector)
  * So far I've found no problems with not calling pc_changed for 8 or 16
  * bit branches.
  */
+/* Idle loop skipping, called on backward branches.
+ * When the last loop iteration did not write anything and all values it read are known
+ * to remain unchanged for some time, the CPU would execute the exact same iteration
+ * again if registers are also unchanged: the cycle counter is then directly advanced
+ * by as many iterations as possible before any read value or current time slice ends.
+ */
+static void m68ki_idle_loop(void)
+{
+  cpu_skip_t *skip = &m68ki_cpu.skip;
+  uint cycles = m68ki_cpu.cycles;
+
+  if ((skip->pc == REG_PC) && (skip->until > cycles) && !memcmp(skip->regs, REG_DA, sizeof(skip->regs)))
+  {
+    uint period = cycles - skip->cycle;
+    uint limit = skip->until;
+
+    if (limit >= m68ki_cpu.cycle_end)
+    {
+      limit = m68ki_cpu.cycle_end - 1;
+    }
+
+    if (period && (limit > cycles))
+    {
+      period *= (limit - cycles) / period;
+      m68ki_cpu.cycles = cycles = cycles + period;
+      skip->skipped += period;
+    }
+  }
+  else
+  {
+    memcpy(skip->regs, REG_DA, sizeof(skip->regs));
+  }
+
+  /* start of next loop iteration */
+  skip->pc = REG_PC;
+  skip->cycle = cycles;
+  skip->until = 0xffffffff;
+}
+
 INLINE void m68ki_branch_8(uint offset)
 {
   REG_PC += MAKE_INT_8(offset);
+  if ((offset & 0x80) && m68ki_cpu.skip.enabled) m68ki_idle_loop();
 }
 
 INLINE void m68ki_branch_16(uint offset)
 {
   REG_PC += MAKE_INT_16(offset);
+  if ((offset & 0x8000) && m68ki_cpu.skip.enabled) m68ki_idle_loop();
 }
 
 INLINE void m68ki_branch_32(uint offset)
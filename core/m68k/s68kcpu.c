@@ -17,6 +17,7 @@ extern int scd_68k_irq_ack(int level);
 
 #include "s68kconf.h"
 #include "m68kcpu.h"
+#include "profile.h"
 #include "m68kops.h"
 
 /* ======================================================================== */
@@ -26,7 +27,7 @@ extern int scd_68k_irq_ack(int level);
 #ifdef BUILD_TABLES
 static unsigned char s68ki_cycles[0x10000];
 #endif
-static int irq_latency;
+static THREAD_CONTEXT int irq_latency;
 
 /* IRQ priority */
 static const uint8 irq_level[0x40] = 
@@ -41,7 +42,7 @@ static const uint8 irq_level[0x40] =
   6, 6, 6, 6, 6, 6, 6, 6
 };
 
-m68ki_cpu_core s68k;
+THREAD_CONTEXT m68ki_cpu_core s68k;
 
 
 /* ======================================================================== */
@@ -225,6 +226,8 @@ void s68k_run(unsigned int cycles)
     return;
   }
 
+  PROFILE_BEGIN(PROFILE_S68K_RUN);
+
   /* Check interrupt mask to process IRQ if needed */
   m68ki_check_interrupts();
 
@@ -232,6 +235,7 @@ void s68k_run(unsigned int cycles)
   if (CPU_STOPPED)
   {
     s68k.cycles = cycles;
+    PROFILE_END(PROFILE_S68K_RUN);
     return;
   }
 
@@ -263,19 +267,15 @@ void s68k_run(unsigned int cycles)
     /* Trace m68k_exception, if necessary */
     m68ki_exception_if_trace(); /* auto-disable (see m68kcpu.h) */
   }
+
+  PROFILE_END(PROFILE_S68K_RUN);
 }
 
 void s68k_init(void)
 {
 #ifdef BUILD_TABLES
-  static uint emulation_initialized = 0;
-
   /* The first call to this function initializes the opcode handler jump table */
-  if(!emulation_initialized)
-  {
-    m68ki_build_opcode_table();
-    emulation_initialized = 1;
-  }
+  RUN_ONCE(m68ki_build_opcode_table);
 #endif
 
 #if M68K_EMULATE_INT_ACK == OPT_ON
@@ -37,6 +37,53 @@
 #define M_PI 3.14159265358979323846264338327f
 #endif /* M_PI */
 
+/* Storage class of emulated hardware state.
+ * If you define USE_THREAD_CONTEXT in the makefile, each host thread runs its
+ * own independent virtual console: all hardware state becomes thread-local,
+ * while read-only lookup tables remain shared by all threads. Cartridge & CD
+ * hardware are then always dynamically allocated (see USE_DYNAMIC_ALLOC).
+ *
+ * There is no context switching: a virtual console belongs to the host thread
+ * which initialized it, for its whole life (from load_rom() & system_init() to
+ * system_shutdown()), and can not be run by another thread. With a thread pool,
+ * each console must be assigned to a single worker. Frontend configuration (config)
+ * is shared by all consoles. POSIX threads are required.
+ */
+#ifdef USE_THREAD_CONTEXT
+#ifdef _MSC_VER
+#define THREAD_CONTEXT __declspec(thread)
+#else
+#define THREAD_CONTEXT __thread
+#endif
+#ifndef USE_DYNAMIC_ALLOC
+#define USE_DYNAMIC_ALLOC
+#endif
+#else
+#define THREAD_CONTEXT
+#endif
+
+/* Shared look-up tables are initialized by the first call to 'func' (void function without argument),
+ * other threads wait until initialization is complete.
+ */
+#ifdef USE_THREAD_CONTEXT
+#include <pthread.h>
+#define RUN_ONCE(func) \
+  { \
+    static pthread_once_t once = PTHREAD_ONCE_INIT; \
+    pthread_once(&once, func); \
+  }
+#else
+#define RUN_ONCE(func) \
+  { \
+    static int once = 0; \
+    if (!once) \
+    { \
+      func(); \
+      once = 1; \
+    } \
+  }
+#endif
+
 /* Set to your compiler's static inline keyword to enable it, or
  * set it to blank to disable it.
  * If you define INLINE in the makefile, it will override this value.
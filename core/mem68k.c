@@ -159,6 +159,8 @@ unsigned int z80_read_byte(unsigned int address)
 
     default: /* ZRAM */
     {
+      /* Z80 bus is held by 68k */
+      m68k_idle_read(0xffffffff);
       return zram[address & 0x1FFF];
     }
   }
@@ -207,6 +209,7 @@ void z80_write_byte(unsigned int address, unsigned int data)
     default: /* ZRAM */
     {
       zram[address & 0x1FFF] = data;
+      MARK_DIRTY(DIRTY_ZRAM, address & 0x1FFF);
       m68k.cycles += 8; /* ZRAM access latency (fixes Pacman 2: New Adventures) */
       return;
     }
@@ -313,6 +316,9 @@ unsigned int ctrl_io_read_byte(unsigned int address)
     {
       if (!(address & 1))
       {
+        /* only modified by 68k writes */
+        m68k_idle_read(0xffffffff);
+
         /* Unused bits return prefetched bus data (Time Killers) */
         address = m68k.pc;
 
@@ -446,6 +452,9 @@ unsigned int ctrl_io_read_word(unsigned int address)
 
     case 0x11:  /* Z80 BUSACK */
     {
+      /* only modified by 68k writes */
+      m68k_idle_read(0xffffffff);
+
       /* Unused bits return prefetched bus data (Time Killers) */
       address = m68k.pc;
 
@@ -1104,7 +1113,12 @@ unsigned int vdp_read_byte(unsigned int address)
 
     case 0x04:  /* CTRL */
     {
-      unsigned int data = (vdp_68k_ctrl_r(m68k.cycles) >> 8) & 3;
+      unsigned int data = vdp_68k_ctrl_r(m68k.cycles);
+
+      /* idle loop skipping */
+      m68k_idle_read(vdp_68k_ctrl_until(m68k.cycles, data));
+
+      data = (data >> 8) & 3;
 
       /* Unused bits return prefetched bus data */
       address = m68k.pc;
@@ -1115,18 +1129,22 @@ unsigned int vdp_read_byte(unsigned int address)
 
     case 0x05:  /* CTRL */
     {
-      return (vdp_68k_ctrl_r(m68k.cycles) & 0xFF);
+      unsigned int data = vdp_68k_ctrl_r(m68k.cycles);
+      m68k_idle_read(vdp_68k_ctrl_until(m68k.cycles, data));
+      return (data & 0xFF);
     }
 
     case 0x08:  /* HVC */
     case 0x0C:
     {
+      m68k_idle_read(vdp_hvc_until(m68k.cycles, 0));
       return (vdp_hvc_r(m68k.cycles) >> 8);
     }
 
     case 0x09:  /* HVC */
     case 0x0D:
     {
+      m68k_idle_read(vdp_hvc_until(m68k.cycles, 1));
       return (vdp_hvc_r(m68k.cycles) & 0xFF);
     }
 
@@ -1156,7 +1174,12 @@ unsigned int vdp_read_word(unsigned int address)
 
     case 0x04:  /* CTRL */
     {
-      unsigned int data = vdp_68k_ctrl_r(m68k.cycles) & 0x3FF;
+      unsigned int data = vdp_68k_ctrl_r(m68k.cycles);
+
+      /* idle loop skipping */
+      m68k_idle_read(vdp_68k_ctrl_until(m68k.cycles, data));
+
+      data &= 0x3FF;
 
       /* Unused bits return prefetched bus data */
       address = m68k.pc;
@@ -1168,6 +1191,7 @@ unsigned int vdp_read_word(unsigned int address)
     case 0x08:  /* HVC */
     case 0x0C:
     {
+      m68k_idle_read(vdp_hvc_until(m68k.cycles, 1));
       return vdp_hvc_r(m68k.cycles);
     }
 
@@ -39,6 +39,9 @@
 
 #include "shared.h"
 
+/* Z80 bank (68k bus) memory map */
+THREAD_CONTEXT struct _zbank_memory_map zbank_memory_map[256];
+
 /*
   Handlers for access to unused addresses and those which make the
   machine lock up.
@@ -49,7 +49,7 @@ extern void zbank_write_ctrl_io(unsigned int address, unsigned int data);
 extern unsigned int zbank_read_vdp(unsigned int address);
 extern void zbank_write_vdp(unsigned int address, unsigned int data);
 
-struct _zbank_memory_map
+extern THREAD_CONTEXT struct _zbank_memory_map
 {
   unsigned int (*read)(unsigned int address);
   void (*write)(unsigned int address, unsigned int data);
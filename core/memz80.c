@@ -137,6 +137,7 @@ void z80_memory_w(unsigned int address, unsigned char data)
     case 1: 
     {
       zram[address & 0x1FFF] = data;
+      MARK_DIRTY(DIRTY_ZRAM, address & 0x1FFF);
       return;
     }
 
@@ -179,6 +180,7 @@ void z80_memory_w(unsigned int address, unsigned char data)
         return;
       }
       WRITE_BYTE(m68k.memory_map[address >> 16].base, address & 0xFFFF, data);
+      state_mark_dirty(m68k.memory_map[address >> 16].base + (address & 0xFFFF));
       return;
     }
   }
@@ -0,0 +1,655 @@
+/***************************************************************************************
+ *  Genesis Plus
+ *  Input movie recording & playback
+ *
+ *  Copyright (C) 2015  Eke-Eke (Genesis Plus GX)
+ *
+ *  Redistribution and use of this code or any derivative works are permitted
+ *  provided that the following conditions are met:
+ *
+ *   - Redistributions may not be sold, nor may they be used in a commercial
+ *     product or activity.
+ *
+ *   - Redistributions that are modified from the original source must include the
+ *     complete source code, including the source code for all components used by a
+ *     binary built from the modified sources. However, as a special exception, the
+ *     source code distributed need not include anything that is normally distributed
+ *     (in either source or binary form) with the major components (compiler, kernel,
+ *     and so on) of the operating system on which the executable runs, unless that
+ *     component itself accompanies the executable.
+ *
+ *   - Redistributions must reproduce the above copyright notice, this list of
+ *     conditions and the following disclaimer in the documentation and/or other
+ *     materials provided with the distribution.
+ *
+ *  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ *  AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ *  IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ *  ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE
+ *  LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ *  CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ *  SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ *  INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ *  CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ *  ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ *  POSSIBILITY OF SUCH DAMAGE.
+ *
+ ****************************************************************************************/
+
+#include "shared.h"
+
+#ifdef __LIBRETRO__
+#include "scrc32.h"
+#else
+#include <zlib.h>
+#endif
+
+/* Movie file format (multi-byte values are little-endian):
+ *
+ *   header   : "GENPLUS-GX MOVIE" id, version (1 byte)
+ *              ROM CRC32 (4 bytes), system_hw, region_code
+ *              config.system, config.region_detect, config.bios, config.lock_on,
+ *              config.force_dtack, config.addr_error, config.ym2413, config.vdp_mode,
+ *              config.master_clock, config.overscan, config.gg_extra
+ *              input.system[2], input.dev[MAX_DEVICES]
+ *              state hash interval (2 bytes), start flags (1 byte)
+ *              backup RAM (64 KB, if MOVIE_FLAG_SRAM is set)
+ *              savestate size (4 bytes) & data
+ *
+ *   records  : frame record = MOVIE_FRAME_* flags (1 byte) followed by
+ *                - changed digital inputs (MOVIE_FRAME_PAD) : device mask (1 byte) + 16-bit value per device
+ *                - changed analog inputs (MOVIE_FRAME_ANALOG) : device mask (1 byte) + 2 x 16-bit values per device
+ *                - PICO page (MOVIE_FRAME_PICO) : 1 byte
+ *                - state hash at the end of the frame (MOVIE_FRAME_HASH) : 4 bytes
+ *              event record = MOVIE_EVENT_* (1 byte), applied between frames
+ *                - system reset : savestate size (4 bytes) & data
+ *                - state hash at the end of the movie (4 bytes)
+ *
+ * Frames without input changes or state hash are stored as a single byte. Movies starting
+ * at power-on and system resets also include a savestate since reset starts CPUs at a
+ * random cycle.
+ */
+#define MOVIE_ID "GENPLUS-GX MOVIE"
+#define MOVIE_VERSION 1
+#define MOVIE_HEADER_SIZE (16 + 1 + 4 + 2 + 11 + 2 + MAX_DEVICES + 2 + 1)
+
+#define MOVIE_FLAG_POWER_ON 0x01
+#define MOVIE_FLAG_SRAM     0x02
+
+#define MOVIE_FRAME_PAD    0x01
+#define MOVIE_FRAME_ANALOG 0x02
+#define MOVIE_FRAME_PICO   0x04
+#define MOVIE_FRAME_HASH   0x08
+
+#define MOVIE_EVENT_RESET 0x80
+#define MOVIE_EVENT_END   0x81
+
+THREAD_CONTEXT t_movie movie;
+
+static void write_byte(int data)
+{
+  fputc(data & 0xff, movie.fd);
+}
+
+static void write_word(int data)
+{
+  write_byte(data);
+  write_byte(data >> 8);
+}
+
+static void write_long(uint32 data)
+{
+  write_word(data);
+  write_word(data >> 16);
+}
+
+static int write_state(void)
+{
+  int size;
+  uint8 *state = (uint8 *)malloc(STATE_SIZE);
+  if (!state) return 0;
+
+  size = state_save(state);
+  write_long(size);
+  fwrite(state, size, 1, movie.fd);
+
+  /* recording continues from loaded savestate, as playback does */
+  size = state_load(state, size);
+  free(state);
+  return (size != 0);
+}
+
+static uint32 read_long(const uint8 *ptr)
+{
+  return ptr[0] | (ptr[1] << 8) | (ptr[2] << 16) | ((uint32)ptr[3] << 24);
+}
+
+/* Returns size of savestate at current offset (0 if savestate is truncated) */
+static uint32 movie_state_size(void)
+{
+  uint32 size;
+  if ((movie.size - movie.ptr) < 4) return 0;
+  size = read_long(&movie.data[movie.ptr]) + 4;
+  return ((movie.size - movie.ptr) < size) ? 0 : size;
+}
+
+static int bit_count(int mask)
+{
+  int count = 0;
+  while (mask)
+  {
+    count += mask & 1;
+    mask >>= 1;
+  }
+  return count;
+}
+
+/* Returns size of frame record at current offset (0 if record is truncated) */
+static int movie_frame_size(void)
+{
+  int size = 1;
+  uint8 *ptr = &movie.data[movie.ptr];
+  uint32 left = movie.size - movie.ptr;
+
+  if (ptr[0] & MOVIE_FRAME_PAD)
+  {
+    if (left < (uint32)(size + 1)) return 0;
+    size += 1 + bit_count(ptr[size]) * 2;
+  }
+
+  if (ptr[0] & MOVIE_FRAME_ANALOG)
+  {
+    if (left < (uint32)(size + 1)) return 0;
+    size += 1 + bit_count(ptr[size]) * 4;
+  }
+
+  if (ptr[0] & MOVIE_FRAME_PICO)
+  {
+    size += 1;
+  }
+
+  if (ptr[0] & MOVIE_FRAME_HASH)
+  {
+    size += 4;
+  }
+
+  return (left < (uint32)size) ? 0 : size;
+}
+
+/* Compare state hash with expected value */
+static void movie_check(uint32 hash)
+{
+  movie.hash_checks++;
+  if (movie_hash() != hash)
+  {
+    if (!movie.hash_errors)
+    {
+      movie.hash_error_frame = movie.frame;
+    }
+    movie.hash_errors++;
+  }
+}
+
+/* Apply events recorded between frames, returns 0 once all frames have been played */
+static int movie_events(void)
+{
+  while (movie.ptr < movie.size)
+  {
+    switch (movie.data[movie.ptr])
+    {
+      case MOVIE_EVENT_RESET:
+      {
+        uint32 size;
+        movie.ptr++;
+        size = movie_state_size();
+        if (!size || !state_load(&movie.data[movie.ptr + 4], size - 4))
+        {
+          movie.ptr = movie.size;
+          return 0;
+        }
+        movie.ptr += size;
+        break;
+      }
+
+      case MOVIE_EVENT_END:
+      {
+        if ((movie.size - movie.ptr) >= 5)
+        {
+          movie_check(read_long(&movie.data[movie.ptr + 1]));
+        }
+        movie.ptr = movie.size;
+        return 0;
+      }
+
+      default:
+      {
+        /* next frame */
+        return movie_frame_size() ? 1 : 0;
+      }
+    }
+  }
+
+  return 0;
+}
+
+int movie_record(const char *filename, int start, int hash_interval)
+{
+  int i;
+
+  movie_stop();
+
+  movie.fd = fopen(filename, "wb");
+  if (!movie.fd) return 0;
+
+  fwrite(MOVIE_ID, 16, 1, movie.fd);
+  write_byte(MOVIE_VERSION);
+  write_long(crc32(0, cart.rom, cart.romsize));
+  write_byte(system_hw);
+  write_byte(region_code);
+  write_byte(config.system);
+  write_byte(config.region_detect);
+  write_byte(config.bios);
+  write_byte(config.lock_on);
+  write_byte(config.force_dtack);
+  write_byte(config.addr_error);
+  write_byte(config.ym2413);
+  write_byte(config.vdp_mode);
+  write_byte(config.master_clock);
+  write_byte(config.overscan);
+  write_byte(config.gg_extra);
+  write_byte(input.system[0]);
+  write_byte(input.system[1]);
+  for (i=0; i<MAX_DEVICES; i++)
+  {
+    write_byte(input.dev[i]);
+  }
+  write_word(hash_interval);
+  write_byte(((start == MOVIE_POWER_ON) ? MOVIE_FLAG_POWER_ON : 0) | (sram.on ? MOVIE_FLAG_SRAM : 0));
+
+  if (sram.on)
+  {
+    fwrite(sram.sram, 0x10000, 1, movie.fd);
+  }
+
+  if (!write_state())
+  {
+    fclose(movie.fd);
+    movie.fd = NULL;
+    return 0;
+  }
+
+  /* first frame inputs are always recorded */
+  for (i=0; i<MAX_DEVICES; i++)
+  {
+    movie.pad[i] = ~input.pad[i];
+    movie.analog[i][0] = ~input.analog[i][0];
+    movie.analog[i][1] = ~input.analog[i][1];
+  }
+  movie.pico = ~pico_current;
+
+  movie.frame = 0;
+  movie.hash_interval = hash_interval;
+  movie.mode = MOVIE_RECORD;
+  return 1;
+}
+
+int movie_load(const char *filename)
+{
+  uint8 *ptr;
+  long size;
+  FILE *fd;
+
+  movie_stop();
+
+  fd = fopen(filename, "rb");
+  if (!fd) return 0;
+
+  fseek(fd, 0, SEEK_END);
+  size = ftell(fd);
+  fseek(fd, 0, SEEK_SET);
+
+  if (size < MOVIE_HEADER_SIZE)
+  {
+    fclose(fd);
+    return 0;
+  }
+
+  movie.data = (uint8 *)malloc(size);
+  if (!movie.data || (fread(movie.data, size, 1, fd) != 1) || memcmp(movie.data, MOVIE_ID, 16) || (movie.data[16] != MOVIE_VERSION))
+  {
+    fclose(fd);
+    movie_stop();
+    return 0;
+  }
+
+  fclose(fd);
+  movie.size = size;
+
+  /* movie is played with the same settings */
+  ptr = &movie.data[16 + 1 + 4 + 2];
+  config.system       = *ptr++;
+  config.region_detect = *ptr++;
+  config.bios         = *ptr++;
+  config.lock_on      = *ptr++;
+  config.force_dtack  = *ptr++;
+  config.addr_error   = *ptr++;
+  config.ym2413       = *ptr++;
+  config.vdp_mode     = *ptr++;
+  config.master_clock = *ptr++;
+  config.overscan     = *ptr++;
+  config.gg_extra     = *ptr++;
+  input.system[0]     = *ptr++;
+  input.system[1]     = *ptr++;
+  ptr += MAX_DEVICES;
+  movie.hash_interval = ptr[0] | (ptr[1] << 8);
+  ptr += 2;
+
+  /* skip backup RAM & savestate */
+  movie.ptr = MOVIE_HEADER_SIZE;
+  if (*ptr & MOVIE_FLAG_SRAM)
+  {
+    movie.ptr += 0x10000;
+  }
+  if ((movie.ptr > movie.size) || !movie_state_size())
+  {
+    movie_stop();
+    return 0;
+  }
+  movie.ptr += movie_state_size();
+
+  /* count frames */
+  movie.frames = 0;
+  while (movie.ptr < movie.size)
+  {
+    uint8 tag = movie.data[movie.ptr];
+    if (tag == MOVIE_EVENT_RESET)
+    {
+      uint32 size;
+      movie.ptr++;
+      size = movie_state_size();
+      if (!size) break;
+      movie.ptr += size;
+    }
+    else if (tag & 0x80)
+    {
+      break;
+    }
+    else
+    {
+      int len = movie_frame_size();
+      if (!len) break;
+      movie.ptr += len;
+      movie.frames++;
+    }
+  }
+
+  return 1;
+}
+
+int movie_start(void)
+{
+  uint8 *ptr = &movie.data[16 + 1];
+  uint8 flags = movie.data[MOVIE_HEADER_SIZE - 1];
+
+  /* check loaded game */
+  if ((read_long(ptr) != crc32(0, cart.rom, cart.romsize)) || (ptr[4] != system_hw) || (ptr[5] != region_code))
+  {
+    return 0;
+  }
+
+  /* input devices */
+  ptr = &movie.data[MOVIE_HEADER_SIZE - 3 - MAX_DEVICES];
+  if (memcmp(input.dev, ptr, MAX_DEVICES))
+  {
+    memcpy(input.dev, ptr, MAX_DEVICES);
+    input_reset();
+  }
+
+  movie.ptr = MOVIE_HEADER_SIZE;
+
+  if (flags & MOVIE_FLAG_SRAM)
+  {
+    memcpy(sram.sram, &movie.data[movie.ptr], 0x10000);
+    movie.ptr += 0x10000;
+  }
+
+  if (!state_load(&movie.data[movie.ptr + 4], read_long(&movie.data[movie.ptr])))
+  {
+    return 0;
+  }
+  movie.ptr += 4 + read_long(&movie.data[movie.ptr]);
+
+  memset(movie.pad, 0, sizeof(movie.pad));
+  memset(movie.analog, 0, sizeof(movie.analog));
+  movie.pico = pico_current;
+  movie.frame = 0;
+  movie.hash_pending = 0;
+  movie.hash_checks = 0;
+  movie.hash_errors = 0;
+  movie.hash_error_frame = 0;
+  movie.mode = MOVIE_PLAY;
+
+  /* events recorded before first frame */
+  movie_events();
+  return 1;
+}
+
+void movie_input(void)
+{
+  int i, mask;
+  uint8 tag, *ptr;
+
+  if ((movie.mode != MOVIE_PLAY) || (movie.ptr >= movie.size) || (movie.data[movie.ptr] & 0x80) || !movie_frame_size())
+  {
+    return;
+  }
+
+  ptr = &movie.data[movie.ptr];
+  movie.ptr += movie_frame_size();
+  tag = *ptr++;
+
+  if (tag & MOVIE_FRAME_PAD)
+  {
+    mask = *ptr++;
+    for (i=0; i<MAX_DEVICES; i++)
+    {
+      if (mask & (1 << i))
+      {
+        movie.pad[i] = ptr[0] | (ptr[1] << 8);
+        ptr += 2;
+      }
+    }
+  }
+
+  if (tag & MOVIE_FRAME_ANALOG)
+  {
+    mask = *ptr++;
+    for (i=0; i<MAX_DEVICES; i++)
+    {
+      if (mask & (1 << i))
+      {
+        movie.analog[i][0] = ptr[0] | (ptr[1] << 8);
+        movie.analog[i][1] = ptr[2] | (ptr[3] << 8);
+        ptr += 4;
+      }
+    }
+  }
+
+  if (tag & MOVIE_FRAME_PICO)
+  {
+    movie.pico = *ptr++;
+  }
+
+  if (tag & MOVIE_FRAME_HASH)
+  {
+    movie.hash = read_long(ptr);
+    movie.hash_pending = 1;
+  }
+
+  /* recorded inputs replace current inputs */
+  memcpy(input.pad, movie.pad, sizeof(movie.pad));
+  memcpy(input.analog, movie.analog, sizeof(movie.analog));
+  pico_current = movie.pico;
+}
+
+int movie_frame(void)
+{
+  int i, pad = 0, analog = 0;
+  uint8 tag;
+
+  switch (movie.mode)
+  {
+    case MOVIE_RECORD:
+    {
+      /* inputs are only modified by frontend, once per frame */
+      for (i=0; i<MAX_DEVICES; i++)
+      {
+        if (input.pad[i] != movie.pad[i])
+        {
+          pad |= (1 << i);
+        }
+        if ((input.analog[i][0] != movie.analog[i][0]) || (input.analog[i][1] != movie.analog[i][1]))
+        {
+          analog |= (1 << i);
+        }
+      }
+
+      tag = (pad ? MOVIE_FRAME_PAD : 0) | (analog ? MOVIE_FRAME_ANALOG : 0);
+      if (pico_current != movie.pico)
+      {
+        tag |= MOVIE_FRAME_PICO;
+      }
+      if (movie.hash_interval && (((movie.frame + 1) % movie.hash_interval) == 0))
+      {
+        tag |= MOVIE_FRAME_HASH;
+      }
+
+      write_byte(tag);
+
+      if (pad)
+      {
+        write_byte(pad);
+        for (i=0; i<MAX_DEVICES; i++)
+        {
+          if (pad & (1 << i))
+          {
+            write_word(movie.pad[i] = input.pad[i]);
+          }
+        }
+      }
+
+      if (analog)
+      {
+        write_byte(analog);
+        for (i=0; i<MAX_DEVICES; i++)
+        {
+          if (analog & (1 << i))
+          {
+            write_word(movie.analog[i][0] = input.analog[i][0]);
+            write_word(movie.analog[i][1] = input.analog[i][1]);
+          }
+        }
+      }
+
+      if (tag & MOVIE_FRAME_PICO)
+      {
+        write_byte(movie.pico = pico_current);
+      }
+
+      if (tag & MOVIE_FRAME_HASH)
+      {
+        write_long(movie_hash());
+      }
+
+      movie.frame++;
+      return 1;
+    }
+
+    case MOVIE_PLAY:
+    {
+      if (movie.hash_pending)
+      {
+        movie_check(movie.hash);
+        movie.hash_pending = 0;
+      }
+
+      movie.frame++;
+      return movie_events();
+    }
+
+    default:
+    {
+      return 0;
+    }
+  }
+}
+
+/* Called after system reset */
+void movie_reset(void)
+{
+  if (movie.mode == MOVIE_RECORD)
+  {
+    write_byte(MOVIE_EVENT_RESET);
+    write_state();
+  }
+}
+
+void movie_stop(void)
+{
+  if (movie.fd)
+  {
+    /* final state hash */
+    write_byte(MOVIE_EVENT_END);
+    write_long(movie_hash());
+    fclose(movie.fd);
+    movie.fd = NULL;
+  }
+
+  if (movie.data)
+  {
+    free(movie.data);
+    movie.data = NULL;
+  }
+
+  movie.mode = MOVIE_NONE;
+}
+
+/* Emulated memories, VDP & CPU registers (savestates also include host pointers) */
+uint32 movie_hash(void)
+{
+  int i;
+  uint32 regs[18];
+  uint32 crc = crc32(0, work_ram, sizeof(work_ram));
+
+  crc = crc32(crc, zram, sizeof(zram));
+  crc = crc32(crc, vram, sizeof(vram));
+  crc = crc32(crc, cram, sizeof(cram));
+  crc = crc32(crc, vsram, sizeof(vsram));
+  crc = crc32(crc, reg, sizeof(reg));
+
+  if ((system_hw & SYSTEM_PBC) == SYSTEM_MD)
+  {
+    for (i=0; i<17; i++)
+    {
+      regs[i] = m68k_get_reg(M68K_REG_D0 + i);
+    }
+    regs[17] = m68k_get_reg(M68K_REG_SR);
+    crc = crc32(crc, (uint8 *)regs, sizeof(regs));
+  }
+
+  crc = crc32(crc, (uint8 *)&Z80, (uint8 *)&Z80.daisy - (uint8 *)&Z80);
+
+  if (system_hw == SYSTEM_MCD)
+  {
+    crc = crc32(crc, scd.prg_ram, sizeof(scd.prg_ram));
+    crc = crc32(crc, (uint8 *)scd.word_ram, sizeof(scd.word_ram));
+    crc = crc32(crc, scd.word_ram_2M, sizeof(scd.word_ram_2M));
+  }
+
+  if (sram.on)
+  {
+    crc = crc32(crc, sram.sram, 0x10000);
+  }
+
+  return crc;
+}
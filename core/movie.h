@@ -0,0 +1,87 @@
+/***************************************************************************************
+ *  Genesis Plus
+ *  Input movie recording & playback
+ *
+ *  Copyright (C) 2015  Eke-Eke (Genesis Plus GX)
+ *
+ *  Redistribution and use of this code or any derivative works are permitted
+ *  provided that the following conditions are met:
+ *
+ *   - Redistributions may not be sold, nor may they be used in a commercial
+ *     product or activity.
+ *
+ *   - Redistributions that are modified from the original source must include the
+ *     complete source code, including the source code for all components used by a
+ *     binary built from the modified sources. However, as a special exception, the
+ *     source code distributed need not include anything that is normally distributed
+ *     (in either source or binary form) with the major components (compiler, kernel,
+ *     and so on) of the operating system on which the executable runs, unless that
+ *     component itself accompanies the executable.
+ *
+ *   - Redistributions must reproduce the above copyright notice, this list of
+ *     conditions and the following disclaimer in the documentation and/or other
+ *     materials provided with the distribution.
+ *
+ *  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ *  AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ *  IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ *  ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE
+ *  LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ *  CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ *  SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ *  INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ *  CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ *  ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ *  POSSIBILITY OF SUCH DAMAGE.
+ *
+ ****************************************************************************************/
+
+#ifndef _MOVIE_H_
+#define _MOVIE_H_
+
+/* Movie modes */
+#define MOVIE_NONE   0
+#define MOVIE_RECORD 1
+#define MOVIE_PLAY   2
+
+/* Movie start */
+#define MOVIE_POWER_ON 0  /* recording starts right after system reset */
+#define MOVIE_STATE    1  /* recording starts from current state */
+
+/* Default number of frames between state hashes */
+#define MOVIE_HASH_INTERVAL 60
+
+typedef struct
+{
+  uint8 mode;                   /* MOVIE_NONE, MOVIE_RECORD or MOVIE_PLAY */
+  FILE *fd;                     /* recorded movie file */
+  uint8 *data;                  /* played movie file */
+  uint32 size;                  /* played movie file size */
+  uint32 ptr;                   /* played movie file offset */
+  uint32 frame;                 /* current frame */
+  uint32 frames;                /* played movie length (frames) */
+  uint16 hash_interval;         /* number of frames between state hashes */
+  uint8 hash_pending;           /* state hash should be checked at the end of current frame */
+  uint32 hash;                  /* expected state hash */
+  uint32 hash_checks;           /* number of checked state hashes */
+  uint32 hash_errors;           /* number of mismatching state hashes */
+  uint32 hash_error_frame;      /* first mismatching frame */
+  uint16 pad[MAX_DEVICES];      /* last recorded or played digital inputs */
+  int16 analog[MAX_DEVICES][2]; /* last recorded or played analog inputs */
+  uint8 pico;                   /* last recorded or played PICO page */
+} t_movie;
+
+/* Global variables */
+extern THREAD_CONTEXT t_movie movie;
+
+/* Function prototypes */
+extern int movie_record(const char *filename, int start, int hash_interval);
+extern int movie_load(const char *filename);
+extern int movie_start(void);
+extern void movie_input(void);
+extern int movie_frame(void);
+extern void movie_reset(void);
+extern void movie_stop(void);
+extern uint32 movie_hash(void);
+
+#endif /* _MOVIE_H_ */
@@ -0,0 +1,123 @@
+/***************************************************************************************
+ *  Genesis Plus
+ *  Hot-path profiling counters
+ *
+ *  Copyright (C) 2015  Eke-Eke (Genesis Plus GX)
+ *
+ *  Redistribution and use of this code or any derivative works are permitted
+ *  provided that the following conditions are met:
+ *
+ *   - Redistributions may not be sold, nor may they be used in a commercial
+ *     product or activity.
+ *
+ *   - Redistributions that are modified from the original source must include the
+ *     complete source code, including the source code for all components used by a
+ *     binary built from the modified sources. However, as a special exception, the
+ *     source code distributed need not include anything that is normally distributed
+ *     (in either source or binary form) with the major components (compiler, kernel,
+ *     and so on) of the operating system on which the executable runs, unless that
+ *     component itself accompanies the executable.
+ *
+ *   - Redistributions must reproduce the above copyright notice, this list of
+ *     conditions and the following disclaimer in the documentation and/or other
+ *     materials provided with the distribution.
+ *
+ *  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ *  AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ *  IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ *  ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE
+ *  LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ *  CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ *  SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ *  INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ *  CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ *  ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ *  POSSIBILITY OF SUCH DAMAGE.
+ *
+ ****************************************************************************************/
+
+#ifdef USE_PROFILER
+#if defined(HW_RVL) || defined(HW_DOL)
+#include <ogc/lwp_watchdog.h>
+#elif defined(_WIN32)
+#include <windows.h>
+#else
+#ifndef _POSIX_C_SOURCE
+#define _POSIX_C_SOURCE 199309L
+#endif
+#include <time.h>
+#endif
+#include <string.h>
+#endif /* USE_PROFILER */
+
+#include "profile.h"
+
+#ifdef USE_PROFILER
+
+/* counters of current frame */
+THREAD_CONTEXT t_profile profile;
+
+static const char *const profile_names[PROFILE_MAX] =
+{
+  "m68k_run",
+  "s68k_run",
+  "z80_run",
+  "ssp1601_run",
+  "render_line",
+  "parse_satb",
+  "update_bg_pattern_cache",
+  "vdp_dma_update",
+  "sound_update",
+  "YM2612Update",
+  "SN76489_Update",
+  "pcm_run",
+  "gfx_update",
+  "cdd_read_audio",
+  "remap_line"
+};
+
+/* host wall time, in seconds */
+double profile_time(void)
+{
+#if defined(HW_RVL) || defined(HW_DOL)
+  return (double)ticks_to_nanosecs(gettime()) / 1000000000.0;
+#elif defined(_WIN32)
+  LARGE_INTEGER freq, count;
+  QueryPerformanceFrequency(&freq);
+  QueryPerformanceCounter(&count);
+  return (double)count.QuadPart / (double)freq.QuadPart;
+#else
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return (double)ts.tv_sec + (double)ts.tv_nsec / 1000000000.0;
+#endif
+}
+
+/* copy counters accumulated since last call then reset them (should be called once per frame) */
+void profile_get(t_profile *dst)
+{
+  memcpy(dst, &profile, sizeof(t_profile));
+  memset(&profile, 0, sizeof(t_profile));
+}
+
+/* accumulate counters (to average them over several frames) */
+void profile_add(t_profile *dst, const t_profile *src)
+{
+  int i;
+
+  for (i=0; i<PROFILE_MAX; i++)
+  {
+    dst->func[i].calls += src->func[i].calls;
+    dst->func[i].time  += src->func[i].time;
+  }
+
+  dst->vdp_writes += src->vdp_writes;
+  dst->dma_words  += src->dma_words;
+}
+
+const char *profile_name(int id)
+{
+  return ((id >= 0) && (id < PROFILE_MAX)) ? profile_names[id] : "";
+}
+
+#endif /* USE_PROFILER */
@@ -0,0 +1,105 @@
+/***************************************************************************************
+ *  Genesis Plus
+ *  Hot-path profiling counters
+ *
+ *  Copyright (C) 2015  Eke-Eke (Genesis Plus GX)
+ *
+ *  Redistribution and use of this code or any derivative works are permitted
+ *  provided that the following conditions are met:
+ *
+ *   - Redistributions may not be sold, nor may they be used in a commercial
+ *     product or activity.
+ *
+ *   - Redistributions that are modified from the original source must include the
+ *     complete source code, including the source code for all components used by a
+ *     binary built from the modified sources. However, as a special exception, the
+ *     source code distributed need not include anything that is normally distributed
+ *     (in either source or binary form) with the major components (compiler, kernel,
+ *     and so on) of the operating system on which the executable runs, unless that
+ *     component itself accompanies the executable.
+ *
+ *   - Redistributions must reproduce the above copyright notice, this list of
+ *     conditions and the following disclaimer in the documentation and/or other
+ *     materials provided with the distribution.
+ *
+ *  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ *  AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ *  IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ *  ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE
+ *  LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ *  CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ *  SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ *  INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ *  CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ *  ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ *  POSSIBILITY OF SUCH DAMAGE.
+ *
+ ****************************************************************************************/
+
+#ifndef _PROFILE_H_
+#define _PROFILE_H_
+
+#include "macros.h"
+
+/* Profiled functions */
+enum
+{
+  PROFILE_M68K_RUN = 0,
+  PROFILE_S68K_RUN,
+  PROFILE_Z80_RUN,
+  PROFILE_SSP1601_RUN,
+  PROFILE_RENDER_LINE,
+  PROFILE_PARSE_SATB,
+  PROFILE_UPDATE_BG_PATTERN_CACHE,
+  PROFILE_VDP_DMA_UPDATE,
+  PROFILE_SOUND_UPDATE,
+  PROFILE_YM2612_UPDATE,
+  PROFILE_SN76489_UPDATE,
+  PROFILE_PCM_RUN,
+  PROFILE_GFX_UPDATE,
+  PROFILE_CDD_READ_AUDIO,
+  PROFILE_REMAP_LINE,
+  PROFILE_MAX
+};
+
+typedef struct
+{
+  unsigned int calls; /* number of calls */
+  double time;        /* wall time in seconds (including nested profiled functions) */
+  double start;       /* current call start time */
+} t_profile_func;
+
+typedef struct
+{
+  t_profile_func func[PROFILE_MAX];
+  unsigned int vdp_writes;  /* VDP data & control port writes */
+  unsigned int dma_words;   /* VDP DMA accesses (words, or bytes for VRAM Fill & Copy) */
+} t_profile;
+
+/* Profiling is only enabled if you define USE_PROFILER in the makefile,
+ * otherwise all macros below compile to nothing.
+ */
+#ifdef USE_PROFILER
+
+/* Global variables */
+extern THREAD_CONTEXT t_profile profile;
+
+/* Function prototypes */
+extern double profile_time(void);
+extern void profile_get(t_profile *dst);
+extern void profile_add(t_profile *dst, const t_profile *src);
+extern const char *profile_name(int id);
+
+#define PROFILE_BEGIN(id) (profile.func[id].start = profile_time())
+#define PROFILE_END(id) (profile.func[id].time += profile_time() - profile.func[id].start, profile.func[id].calls++)
+#define PROFILE_COUNT(counter, n) (profile.counter += (n))
+
+#else
+
+#define PROFILE_BEGIN(id)
+#define PROFILE_END(id)
+#define PROFILE_COUNT(counter, n)
+
+#endif /* USE_PROFILER */
+
+#endif /* _PROFILE_H_ */
@@ -30,6 +30,8 @@
 #include "areplay.h"
 #include "svp.h"
 #include "state.h"
+#include "profile.h"
+#include "movie.h"
 
 #endif /* _SHARED_H_ */
 
@@ -5,6 +5,10 @@
 /*    - fixed multiple time-frames support & removed m->avail         */
 /*    - modified blip_read_samples to always output to stereo streams */
 /*    - added blip_mix_samples function (see blip_buf.h)              */
+/*    - added blip_copy function (see blip_buf.h)                     */
+/*    - added blip_discard_samples function (see blip_buf.h)          */
+/*    - added stereo read & mix functions (see blip_buf.h)            */
+/*    - added x86 SIMD synthesis & readout functions                  */
 
 #include "blip_buf.h"
 
@@ -15,6 +19,13 @@
 #include <string.h>
 #include <stdlib.h>
 
+/* x86 SIMD functions (define NO_SIMD_BLIP in the makefile to disable them) */
+#if !defined(NO_SIMD_BLIP) && (defined(__x86_64__) || defined(__i386__)) && (defined(__clang__) || (__GNUC__ >= 5))
+#define SIMD_BLIP
+#include <immintrin.h>
+#include "macros.h"
+#endif
+
 /* Library Copyright (C) 2003-2009 Shay Green. This library is free software;
 you can redistribute it and/or modify it under the terms of the GNU Lesser
 General Public License as published by the Free Software Foundation; either
@@ -93,6 +104,26 @@ enum { min_sample = -32768 };
     else if ( n < min_sample) n = min_sample;\
 	}
 
+#ifdef SIMD_BLIP
+static void add_delta_avx2( buf_t* out, short const* in, short const* rev, int delta, int delta2 );
+static void stereo_sse2( blip_t* m0, blip_t* m1, short out [], int count, int mix );
+
+/* selected at runtime, output is identical to C functions */
+static void (*add_delta_simd)( buf_t* out, short const* in, short const* rev, int delta, int delta2 ) = NULL;
+static void (*stereo_simd)( blip_t* m0, blip_t* m1, short out [], int count, int mix ) = NULL;
+#endif
+
+#ifdef SIMD_BLIP
+static void select_simd( void )
+{
+	__builtin_cpu_init();
+	if ( __builtin_cpu_supports( "avx2" ) )
+		add_delta_simd = add_delta_avx2;
+	if ( __builtin_cpu_supports( "sse2" ) )
+		stereo_simd = stereo_sse2;
+}
+#endif
+
 #ifdef BLIP_ASSERT
 static void check_assumptions( void )
 {
@@ -134,6 +165,12 @@ blip_t* blip_new( int size )
 		check_assumptions();
 #endif
   }
+
+#ifdef SIMD_BLIP
+	/* select functions supported by host CPU (shared by all buffers) */
+	RUN_ONCE( select_simd );
+#endif
+
 	return m;
 }
 
@@ -166,6 +203,14 @@ void blip_set_rates( blip_t* m, double clock_rate, double sample_rate )
 	have been rounded down in the floating-point calculation. */
 }
 
+void blip_copy( blip_t* m, const blip_t* src )
+{
+#ifdef BLIP_ASSERT
+	assert( m->size == src->size );
+#endif
+	memcpy( m, src, sizeof *m + (m->size + buf_extra) * sizeof (buf_t) );
+}
+
 void blip_clear( blip_t* m )
 {
 	/* We could set offset to 0, factor/2, or factor-1. 0 is suitable if
@@ -220,6 +265,82 @@ static void remove_samples( blip_t* m, int count )
 	memset( &buf [remain], 0, count * sizeof buf [0] );
 }
 
+/* Integrates samples to every other element of 'out', returns integrator */
+static int read_samples( buf_t const* in, short out [], int count, int sum )
+{
+	buf_t const* end = in + count;
+	while ( in != end )
+	{
+		/* Eliminate fraction */
+		int s = ARITH_SHIFT( sum, delta_bits );
+		
+		sum += *in++;
+		
+		CLAMP( s );
+		
+		*out = s;
+		out += 2;
+		
+		/* High-pass filter */
+		sum -= s << (delta_bits - bass_shift);
+	}
+	return sum;
+}
+
+/* Same as above, except samples are added to 'out' previous values */
+static int mix_samples( buf_t const* in, short out [], int count, int sum )
+{
+	buf_t const* end = in + count;
+	while ( in != end )
+	{
+		/* Eliminate fraction */
+		int s = ARITH_SHIFT( sum, delta_bits );
+		
+		sum += *in++;
+		
+		/* High-pass filter */
+		sum -= s << (delta_bits - bass_shift);
+
+		/* Add current buffer value */
+		s += *out;
+		
+		CLAMP( s );
+		
+		*out = s;
+		out += 2;
+	}
+	return sum;
+}
+
+/* Reads or mixes samples from both buffers into interleaved stereo stream */
+static void stereo_samples( blip_t* m0, blip_t* m1, short out [], int count, int mix )
+{
+	int done = 0;
+
+#ifdef SIMD_BLIP
+	if ( stereo_simd && (count >= 4) )
+	{
+		/* both channels are integrated in parallel, four samples at a time */
+		done = count & ~3;
+		stereo_simd( m0, m1, out, done, mix );
+	}
+#endif
+
+	if ( mix )
+	{
+		m0->integrator = mix_samples( SAMPLES( m0 ) + done, out + done*2, count - done, m0->integrator );
+		m1->integrator = mix_samples( SAMPLES( m1 ) + done, out + done*2 + 1, count - done, m1->integrator );
+	}
+	else
+	{
+		m0->integrator = read_samples( SAMPLES( m0 ) + done, out + done*2, count - done, m0->integrator );
+		m1->integrator = read_samples( SAMPLES( m1 ) + done, out + done*2 + 1, count - done, m1->integrator );
+	}
+
+	remove_samples( m0, count );
+	remove_samples( m1, count );
+}
+
 int blip_read_samples( blip_t* m, short out [], int count)
 {
 #ifdef BLIP_ASSERT
@@ -227,34 +348,38 @@ int blip_read_samples( blip_t* m, short out [], int count)
 	
 	if ( count > (m->offset >> time_bits) )
 		count = m->offset >> time_bits;
+#endif
+	
+	m->integrator = read_samples( SAMPLES( m ), out, count, m->integrator );
+	remove_samples( m, count );
 	
-	if ( count )
+	return count;
+}
+
+int blip_read_samples_stereo( blip_t* m0, blip_t* m1, short out [], int count )
+{
+#ifdef BLIP_ASSERT
+	assert( count >= 0 );
+	assert( m0->offset >> time_bits == m1->offset >> time_bits );
+	
+	if ( count > (m0->offset >> time_bits) )
+		count = m0->offset >> time_bits;
 #endif
-  {
-		buf_t const* in  = SAMPLES( m );
-		buf_t const* end = in + count;
-		int sum = m->integrator;
-		do
-		{
-			/* Eliminate fraction */
-			int s = ARITH_SHIFT( sum, delta_bits );
-			
-			sum += *in++;
-			
-			CLAMP( s );
-			
-			*out = s;
-			out += 2;
-			
-			/* High-pass filter */
-			sum -= s << (delta_bits - bass_shift);
-		}
-		while ( in != end );
-		m->integrator = sum;
-		
-		remove_samples( m, count );
-	}
 	
+	stereo_samples( m0, m1, out, count, 0 );
+	return count;
+}
+
+int blip_discard_samples( blip_t* m, int count )
+{
+#ifdef BLIP_ASSERT
+	assert( count >= 0 );
+	
+	if ( count > (m->offset >> time_bits) )
+		count = m->offset >> time_bits;
+#endif
+	
+	remove_samples( m, count );
 	return count;
 }
 
@@ -265,37 +390,25 @@ int blip_mix_samples( blip_t* m, short out [], int count)
 	
 	if ( count > (m->offset >> time_bits) )
 		count = m->offset >> time_bits;
+#endif
+	
+	m->integrator = mix_samples( SAMPLES( m ), out, count, m->integrator );
+	remove_samples( m, count );
 	
-	if ( count )
+	return count;
+}
+
+int blip_mix_samples_stereo( blip_t* m0, blip_t* m1, short out [], int count )
+{
+#ifdef BLIP_ASSERT
+	assert( count >= 0 );
+	assert( m0->offset >> time_bits == m1->offset >> time_bits );
+	
+	if ( count > (m0->offset >> time_bits) )
+		count = m0->offset >> time_bits;
 #endif
-  {
-		buf_t const* in  = SAMPLES( m );
-		buf_t const* end = in + count;
-		int sum = m->integrator;
-		do
-		{
-			/* Eliminate fraction */
-			int s = ARITH_SHIFT( sum, delta_bits );
-			
-			sum += *in++;
-			
-			/* High-pass filter */
-			sum -= s << (delta_bits - bass_shift);
-
-            /* Add current buffer value */
-            s += *out;
-			
-			CLAMP( s );
-			
-			*out = s;
-			out += 2;
-		}
-		while ( in != end );
-		m->integrator = sum;
-		
-		remove_samples( m, count );
-	}
 	
+	stereo_samples( m0, m1, out, count, 1 );
 	return count;
 }
 
@@ -367,6 +480,14 @@ void blip_add_delta( blip_t* m, unsigned time, int delta )
 	assert( out <= &SAMPLES( m ) [m->size + end_frame_extra] );
 #endif
 
+#ifdef SIMD_BLIP
+	if ( add_delta_simd )
+	{
+		add_delta_simd( out, in, rev, delta, delta2 );
+		return;
+	}
+#endif
+
 	out [0] += in[0]*delta + in[half_width+0]*delta2;
 	out [1] += in[1]*delta + in[half_width+1]*delta2;
 	out [2] += in[2]*delta + in[half_width+2]*delta2;
@@ -403,3 +524,94 @@ void blip_add_delta_fast( blip_t* m, unsigned time, int delta )
 	out [7] += delta * delta_unit - delta2;
 	out [8] += delta2;
 }
+
+#ifdef SIMD_BLIP
+
+/* 16-tap kernel, one 8-lane multiply-add per half (next & previous phases follow each other in bl_step) */
+__attribute__((target("avx2"))) static void add_delta_avx2( buf_t* out, short const* in, short const* rev, int delta, int delta2 )
+{
+	__m256i const d1 = _mm256_set1_epi32( delta );
+	__m256i const d2 = _mm256_set1_epi32( delta2 );
+	__m256i const reverse = _mm256_set_epi32( 0, 1, 2, 3, 4, 5, 6, 7 );
+	__m256i a, b;
+	
+	a = _mm256_cvtepi16_epi32( _mm_loadu_si128( (__m128i const*) in ) );
+	b = _mm256_cvtepi16_epi32( _mm_loadu_si128( (__m128i const*) (in + half_width) ) );
+	a = _mm256_add_epi32( _mm256_mullo_epi32( a, d1 ), _mm256_mullo_epi32( b, d2 ) );
+	_mm256_storeu_si256( (__m256i*) out, _mm256_add_epi32( _mm256_loadu_si256( (__m256i const*) out ), a ) );
+	
+	a = _mm256_cvtepi16_epi32( _mm_loadu_si128( (__m128i const*) rev ) );
+	b = _mm256_cvtepi16_epi32( _mm_loadu_si128( (__m128i const*) (rev - half_width) ) );
+	a = _mm256_add_epi32( _mm256_mullo_epi32( a, d1 ), _mm256_mullo_epi32( b, d2 ) );
+	a = _mm256_permutevar8x32_epi32( a, reverse );
+	_mm256_storeu_si256( (__m256i*) (out + 8), _mm256_add_epi32( _mm256_loadu_si256( (__m256i const*) (out + 8) ), a ) );
+}
+
+/* Same as read_samples, for both channels in the two lower lanes */
+#define INTEGRATE_SSE2( sum, in, s ) \
+	{\
+		s   = _mm_srai_epi32( sum, delta_bits );\
+		sum = _mm_add_epi32( sum, in );\
+		sum = _mm_sub_epi32( sum, _mm_slli_epi32( s, delta_bits - bass_shift ) );\
+	}
+
+/* 4 stereo samples per loop, clamped & interleaved by saturating pack (count must be a multiple of 4) */
+__attribute__((target("sse2"))) static void stereo_sse2( blip_t* m0, blip_t* m1, short out [], int count, int mix )
+{
+	buf_t const* in0 = SAMPLES( m0 );
+	buf_t const* in1 = SAMPLES( m1 );
+	__m128i sum = _mm_unpacklo_epi32( _mm_cvtsi32_si128( m0->integrator ), _mm_cvtsi32_si128( m1->integrator ) );
+	
+	do
+	{
+		__m128i a  = _mm_loadu_si128( (__m128i const*) in0 );
+		__m128i b  = _mm_loadu_si128( (__m128i const*) in1 );
+		__m128i lo = _mm_unpacklo_epi32( a, b );
+		__m128i hi = _mm_unpackhi_epi32( a, b );
+		__m128i start = sum;
+		__m128i s0, s1, s2, s3, c;
+		
+		INTEGRATE_SSE2( sum, lo, s0 );
+		INTEGRATE_SSE2( sum, _mm_srli_si128( lo, 8 ), s1 );
+		INTEGRATE_SSE2( sum, hi, s2 );
+		INTEGRATE_SSE2( sum, _mm_srli_si128( hi, 8 ), s3 );
+		
+		s0 = _mm_unpacklo_epi64( s0, s1 );
+		s2 = _mm_unpacklo_epi64( s2, s3 );
+		
+		if ( mix )
+		{
+			/* Add current buffer values (sign-extended) */
+			__m128i o = _mm_loadu_si128( (__m128i const*) out );
+			s0 = _mm_add_epi32( s0, _mm_srai_epi32( _mm_unpacklo_epi16( o, o ), 16 ) );
+			s2 = _mm_add_epi32( s2, _mm_srai_epi32( _mm_unpackhi_epi16( o, o ), 16 ) );
+		}
+		
+		c = _mm_packs_epi32( s0, s2 );
+		
+		/* When reading, high-pass filter uses clamped samples: clipped samples are integrated again with C function */
+		if ( !mix && (_mm_movemask_epi8( _mm_and_si128(
+			_mm_cmpeq_epi32( s0, _mm_srai_epi32( _mm_unpacklo_epi16( c, c ), 16 ) ),
+			_mm_cmpeq_epi32( s2, _mm_srai_epi32( _mm_unpackhi_epi16( c, c ), 16 ) ) ) ) != 0xffff) )
+		{
+			int sum0 = read_samples( in0, out, 4, _mm_cvtsi128_si32( start ) );
+			int sum1 = read_samples( in1, out + 1, 4, _mm_cvtsi128_si32( _mm_srli_si128( start, 4 ) ) );
+			sum = _mm_unpacklo_epi32( _mm_cvtsi32_si128( sum0 ), _mm_cvtsi32_si128( sum1 ) );
+		}
+		else
+		{
+			_mm_storeu_si128( (__m128i*) out, c );
+		}
+		
+		in0 += 4;
+		in1 += 4;
+		out += 8;
+		count -= 4;
+	}
+	while ( count );
+	
+	m0->integrator = _mm_cvtsi128_si32( sum );
+	m1->integrator = _mm_cvtsi128_si32( _mm_srli_si128( sum, 4 ) );
+}
+
+#endif /* SIMD_BLIP */
@@ -28,6 +28,9 @@ blip_max_ratio = 1 << 20 };
 /** Clears entire buffer. Afterwards, blip_samples_avail() == 0. */
 void blip_clear( blip_t* );
 
+/* Copies rates, buffered samples and filter state from a buffer created with same sample_count */
+void blip_copy( blip_t*, const blip_t* src );
+
 /** Adds positive/negative delta into buffer at specified clock time. */
 void blip_add_delta( blip_t*, unsigned int clock_time, int delta );
 
@@ -60,6 +63,14 @@ int blip_read_samples( blip_t*, short out [], int count);
 /* This allows easy mixing of different blip buffers into a single output stream */
 int blip_mix_samples( blip_t* m, short out [], int count);
 
+/* Same as above functions, for two buffers with same number of samples available */
+/* Samples from first buffer are written to even elements of 'out', samples from second buffer to odd elements */
+int blip_read_samples_stereo( blip_t* m0, blip_t* m1, short out [], int count );
+int blip_mix_samples_stereo( blip_t* m0, blip_t* m1, short out [], int count );
+
+/* Removes at most 'count' samples without reading them (used when sound output is disabled) */
+int blip_discard_samples( blip_t* m, int count );
+
 /** Frees buffer. No effect if NULL is passed. */
 void blip_delete( blip_t* );
 
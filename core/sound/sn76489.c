@@ -92,7 +92,7 @@ static const uint16 PSGVolumeValues[16] =
   1516,1205,957,760,603,479,381,303,240,191,152,120,96,76,60,0
 };
 
-static SN76489_Context SN76489;
+static THREAD_CONTEXT SN76489_Context SN76489;
 
 void SN76489_Init(int type)
 {
@@ -172,7 +172,10 @@ INLINE void UpdateToneAmplitude(int i, int time)
   if (delta != 0)
   {
     SN76489.ChanOut[i][0] += delta;
-    blip_add_delta_fast(snd.blips[0][0], time, delta);
+    if (snd.enabled)
+    {
+      blip_add_delta_fast(snd.blips[0][0], time, delta);
+    }
   }
 
   /* right output */
@@ -180,7 +183,10 @@ INLINE void UpdateToneAmplitude(int i, int time)
   if (delta != 0)
   {
     SN76489.ChanOut[i][1] += delta;
-    blip_add_delta_fast(snd.blips[0][1], time, delta);
+    if (snd.enabled)
+    {
+      blip_add_delta_fast(snd.blips[0][1], time, delta);
+    }
   }
 }
 
@@ -194,7 +200,10 @@ INLINE void UpdateNoiseAmplitude(int time)
   if (delta != 0)
   {
     SN76489.ChanOut[3][0] += delta;
-    blip_add_delta_fast(snd.blips[0][0], time, delta);
+    if (snd.enabled)
+    {
+      blip_add_delta_fast(snd.blips[0][0], time, delta);
+    }
   }
 
   /* right output */
@@ -202,7 +211,10 @@ INLINE void UpdateNoiseAmplitude(int time)
   if (delta != 0)
   {
     SN76489.ChanOut[3][1] += delta;
-    blip_add_delta_fast(snd.blips[0][1], time, delta);
+    if (snd.enabled)
+    {
+      blip_add_delta_fast(snd.blips[0][1], time, delta);
+    }
   }
 }
 
@@ -217,6 +229,24 @@ static void RunTone(int i, int clocks)
   /* Time of next transition */
   time = SN76489.ToneFreqVals[i];
 
+  /* Only final flip-flop state is needed when sound output is disabled */
+  if (!snd.enabled && (time < clocks))
+  {
+    int period = SN76489.Registers[i*2] * PSG_MCYCLES_RATIO;
+    int count = (clocks - time + period - 1) / period;
+
+    if (SN76489.Registers[i*2]>PSG_CUTOFF) {
+      /* Flip the flip-flop an odd number of times */
+      if (count & 1) SN76489.ToneFreqPos[i] = -SN76489.ToneFreqPos[i];
+    } else {
+      /* stuck value */
+      SN76489.ToneFreqPos[i] = 1;
+    }
+    UpdateToneAmplitude(i, time);
+
+    time += count * period;
+  }
+
   /* Process any transitions that occur within clocks we're running */
   while (time < clocks)
   {
@@ -340,6 +370,8 @@ void SN76489_Update(unsigned int clocks)
 {
   int i;
 
+  PROFILE_BEGIN(PROFILE_SN76489_UPDATE);
+
   if (clocks > SN76489.clocks)
   {
     /* Run chip until current timestamp */
@@ -357,6 +389,8 @@ void SN76489_Update(unsigned int clocks)
 	{
 		SN76489.ToneFreqVals[i] -= clocks;
 	}
+
+  PROFILE_END(PROFILE_SN76489_UPDATE);
 }
 
 void SN76489_Write(unsigned int clocks, unsigned int data)
@@ -41,19 +41,26 @@
 #include "blip_buf.h"
 
 /* FM output buffer (large enough to hold a whole frame at original chips rate) */
-static int fm_buffer[1080 * 2];
-static int fm_last[2];
-static int *fm_ptr;
+static THREAD_CONTEXT int fm_buffer[1080 * 2];
+static THREAD_CONTEXT int fm_last[2];
+static THREAD_CONTEXT int *fm_ptr;
 
 /* Cycle-accurate FM samples */
-static uint32 fm_cycles_ratio;
-static uint32 fm_cycles_start;
-static uint32 fm_cycles_count;
+static THREAD_CONTEXT uint32 fm_cycles_ratio;
+static THREAD_CONTEXT uint32 fm_cycles_start;
+static THREAD_CONTEXT uint32 fm_cycles_count;
 
 /* YM chip function pointers */
-static void (*YM_Reset)(void);
-static void (*YM_Update)(int *buffer, int length);
-static void (*YM_Write)(unsigned int a, unsigned int v);
+static THREAD_CONTEXT void (*YM_Reset)(void);
+static THREAD_CONTEXT void (*YM_Update)(int *buffer, int length);
+static THREAD_CONTEXT void (*YM_Run)(int length);
+static THREAD_CONTEXT void (*YM_Write)(unsigned int a, unsigned int v);
+
+/* YM2413 output is simply discarded when sound output is disabled */
+static void ym2413_run(int length)
+{
+  YM2413Update(fm_buffer, length);
+}
 
 /* Run FM chip until required M-cycles */
 INLINE void fm_update(unsigned int cycles)
@@ -63,11 +70,19 @@ INLINE void fm_update(unsigned int cycles)
     /* number of samples to run */
     unsigned int samples = (cycles - fm_cycles_count + fm_cycles_ratio - 1) / fm_cycles_ratio;
 
-    /* run FM chip to sample buffer */
-    YM_Update(fm_ptr, samples);
+    if (snd.enabled)
+    {
+      /* run FM chip to sample buffer */
+      YM_Update(fm_ptr, samples);
 
-    /* update FM buffer pointer */
-    fm_ptr += (samples << 1);
+      /* update FM buffer pointer */
+      fm_ptr += (samples << 1);
+    }
+    else
+    {
+      /* only update FM chip state */
+      YM_Run(samples);
+    }
 
     /* update FM cycle counter */
     fm_cycles_count += samples * fm_cycles_ratio;
@@ -84,6 +99,7 @@ void sound_init( void )
     YM2612Config(config.dac_bits);
     YM_Reset = YM2612ResetChip;
     YM_Update = YM2612Update;
+    YM_Run = YM2612Run;
     YM_Write = YM2612Write;
 
     /* chip is running a VCLK / 144 = MCLK / 7 / 144 */
@@ -95,6 +111,7 @@ void sound_init( void )
     YM2413Init();
     YM_Reset = YM2413ResetChip;
     YM_Update = YM2413Update;
+    YM_Run = ym2413_run;
     YM_Write = YM2413Write;
 
     /* chip is running a ZCLK / 72 = MCLK / 15 / 72 */
@@ -123,10 +140,22 @@ void sound_reset(void)
   fm_cycles_start = fm_cycles_count = 0;
 }
 
+/* Same as sound_reset() but sound chips state is kept (see system_restore) */
+void sound_restore(void)
+{
+  /* reset FM buffer ouput */
+  fm_last[0] = fm_last[1] = 0;
+
+  /* reset FM buffer pointer */
+  fm_ptr = fm_buffer;
+}
+
 int sound_update(unsigned int cycles)
 {
   int delta, preamp, time, l, r, *ptr;
 
+  PROFILE_BEGIN(PROFILE_SOUND_UPDATE);
+
   /* Run PSG & FM chips until end of frame */
   SN76489_Update(cycles);
   fm_update(cycles);
@@ -145,20 +174,31 @@ int sound_update(unsigned int cycles)
   ptr = fm_buffer;
 
   /* flush FM samples */
-  if (config.hq_fm)
+  if (!snd.enabled)
+  {
+    /* sound output is disabled, only advance time counter */
+    time += ((cycles > (unsigned int)time) ? ((cycles - time + fm_cycles_ratio - 1) / fm_cycles_ratio) : 1) * fm_cycles_ratio;
+  }
+  else if (config.hq_fm)
   {
     /* high-quality Band-Limited synthesis */
     do
     {
-      /* left channel */
+      /* left channel (unchanged outputs are skipped) */
       delta = ((*ptr++ * preamp) / 100) - l;
-      l += delta;
-      blip_add_delta(snd.blips[0][0], time, delta);
+      if (delta)
+      {
+        l += delta;
+        blip_add_delta(snd.blips[0][0], time, delta);
+      }
       
       /* right channel */
       delta = ((*ptr++ * preamp) / 100) - r;
-      r += delta;
-      blip_add_delta(snd.blips[0][1], time, delta);
+      if (delta)
+      {
+        r += delta;
+        blip_add_delta(snd.blips[0][1], time, delta);
+      }
 
       /* increment time counter */
       time += fm_cycles_ratio;
@@ -170,15 +210,21 @@ int sound_update(unsigned int cycles)
     /* faster Linear Interpolation */
     do
     {
-      /* left channel */
+      /* left channel (unchanged outputs are skipped) */
       delta = ((*ptr++ * preamp) / 100) - l;
-      l += delta;
-      blip_add_delta_fast(snd.blips[0][0], time, delta);
+      if (delta)
+      {
+        l += delta;
+        blip_add_delta_fast(snd.blips[0][0], time, delta);
+      }
       
       /* right channel */
       delta = ((*ptr++ * preamp) / 100) - r;
-      r += delta;
-      blip_add_delta_fast(snd.blips[0][1], time, delta);
+      if (delta)
+      {
+        r += delta;
+        blip_add_delta_fast(snd.blips[0][1], time, delta);
+      }
 
       /* increment time counter */
       time += fm_cycles_ratio;
@@ -200,6 +246,8 @@ int sound_update(unsigned int cycles)
   blip_end_frame(snd.blips[0][0], cycles);
   blip_end_frame(snd.blips[0][1], cycles);
 
+  PROFILE_END(PROFILE_SOUND_UPDATE);
+
   /* return number of available samples */
   return blip_samples_avail(snd.blips[0][0]);
 }
@@ -246,6 +294,19 @@ int sound_context_load(uint8 *state)
   return bufferptr;
 }
 
+/* Last FM output (not included in savestates since only used for resampling) */
+void sound_get_output(int *last)
+{
+  last[0] = fm_last[0];
+  last[1] = fm_last[1];
+}
+
+void sound_set_output(const int *last)
+{
+  fm_last[0] = last[0];
+  fm_last[1] = last[1];
+}
+
 void fm_reset(unsigned int cycles)
 {
   /* synchronize FM chip with CPU */
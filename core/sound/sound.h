@@ -43,9 +43,12 @@
 /* Function prototypes */
 extern void sound_init(void);
 extern void sound_reset(void);
+extern void sound_restore(void);
 extern int sound_context_save(uint8 *state);
 extern int sound_context_load(uint8 *state);
 extern int sound_update(unsigned int cycles);
+extern void sound_get_output(int *last);
+extern void sound_set_output(const int *last);
 extern void fm_reset(unsigned int cycles);
 extern void fm_write(unsigned int cycles, unsigned int address, unsigned int data);
 extern unsigned int fm_read(unsigned int cycles, unsigned int address);
@@ -496,13 +496,13 @@ static unsigned char table[19][8] = {
   {0x05, 0x01, 0x00, 0x00, 0xf8, 0xba, 0x49, 0x55 },/* TOM(multi,env verified), TOP CYM(multi verified, env verified) */
 };
 
-static signed int output[2];
+static THREAD_CONTEXT signed int output[2];
 
-static UINT32  LFO_AM;
-static INT32  LFO_PM;
+static THREAD_CONTEXT UINT32  LFO_AM;
+static THREAD_CONTEXT INT32  LFO_PM;
 
 /* emulated chip */
-static YM2413 ym2413;
+static THREAD_CONTEXT YM2413 ym2413;
 
 /* advance LFO to next sample */
 INLINE void advance_lfo(void)
@@ -1005,7 +1005,7 @@ INLINE void rhythm_calc( YM2413_OPLL_CH *CH, unsigned int noise )
 
 
 /* generic table initialize */
-static int init_tables(void)
+static void init_tables(void)
 {
   signed int i,x;
   signed int n;
@@ -1067,8 +1067,6 @@ static int init_tables(void)
     else
       sin_tab[1*SIN_LEN+i] = sin_tab[i];
   }
-
-  return 1;
 }
 
 
@@ -1591,7 +1589,8 @@ static void OPLLWriteReg(int r, int v)
 
 void YM2413Init(void)
 {
-  init_tables();
+  /* generic tables are shared by all emulated chips and only need to be initialized once */
+  RUN_ONCE(init_tables);
 
   /* clear */
   memset(&ym2413,0,sizeof(YM2413));
@@ -130,6 +130,12 @@
 
 #include "shared.h"
 
+/* x86 SIMD synthesis functions (define NO_SIMD_YM2612 in the makefile to disable them) */
+#if !defined(NO_SIMD_YM2612) && (defined(__x86_64__) || defined(__i386__)) && (defined(__clang__) || (__GNUC__ >= 5))
+#define SIMD_YM2612
+#include <immintrin.h>
+#endif
+
 /* envelope generator */
 #define ENV_BITS    10
 #define ENV_LEN      (1<<ENV_BITS)
@@ -607,13 +613,13 @@ typedef struct
 } YM2612;
 
 /* emulated chip */
-static YM2612 ym2612;
+static THREAD_CONTEXT YM2612 ym2612;
 
 /* current chip state */
-static INT32  m2,c1,c2;   /* Phase Modulation input for operators 2,3,4 */
-static INT32  mem;        /* one sample delay memory */
-static INT32  out_fm[8];  /* outputs of working channels */
-static UINT32 bitmask;    /* working channels output bitmasking (DAC quantization) */ 
+static THREAD_CONTEXT INT32  m2,c1,c2;   /* Phase Modulation input for operators 2,3,4 */
+static THREAD_CONTEXT INT32  mem;        /* one sample delay memory */
+static THREAD_CONTEXT INT32  out_fm[8];  /* outputs of working channels */
+static THREAD_CONTEXT UINT32 bitmask;    /* working channels output bitmasking (DAC quantization) */ 
 
 
 INLINE void FM_KEYON(FM_CH *CH , int s )
@@ -1268,7 +1274,7 @@ INLINE void update_ssg_eg_channels(FM_CH *CH)
   } while (--i);
 }
 
-INLINE void update_phase_lfo_slot(FM_SLOT *SLOT, INT32 pms, UINT32 block_fnum)
+INLINE UINT32 lfo_slot_incr(FM_SLOT *SLOT, INT32 pms, UINT32 block_fnum)
 {
   INT32 lfo_fn_table_index_offset = lfo_pm_table[(((block_fnum & 0x7f0) >> 4) << 8) + pms + ym2612.OPN.LFO_PM];
   
@@ -1289,15 +1295,20 @@ INLINE void update_phase_lfo_slot(FM_SLOT *SLOT, INT32 pms, UINT32 block_fnum)
     /* (frequency) phase increment counter */
     fc = (((block_fnum << 5) >> (7 - blk)) + SLOT->DT[kc]) & DT_MASK;
 
-    /* update phase */
-    SLOT->phase += (fc * SLOT->mul) >> 1;
+    /* phase increment */
+    return (fc * SLOT->mul) >> 1;
   }
   else  /* LFO phase modulation  = zero */
   {
-    SLOT->phase += SLOT->Incr;
+    return SLOT->Incr;
   }
 }
 
+INLINE void update_phase_lfo_slot(FM_SLOT *SLOT, INT32 pms, UINT32 block_fnum)
+{
+  SLOT->phase += lfo_slot_incr(SLOT, pms, block_fnum);
+}
+
 INLINE void update_phase_lfo_channel(FM_CH *CH)
 {
   UINT32 block_fnum = CH->block_fnum;
@@ -1497,6 +1508,386 @@ INLINE void chan_calc(FM_CH *CH, int num)
   } while (--num);
 }
 
+/* Same as chan_calc() but only operators outputs stored in chip state (SLOT1 feedback & MEM) are calculated */
+INLINE void chan_calc_state(FM_CH *CH, int num)
+{
+  do
+  {
+    UINT32 AM = ym2612.OPN.LFO_AM >> CH->ams;
+    unsigned int eg_out = volume_calc(&CH->SLOT[SLOT1]);
+
+    m2 = c1 = c2 = mem = 0;
+
+    *CH->mem_connect = CH->mem_value;  /* restore delayed sample (MEM) value to m2 or c2 */
+    {
+      INT32 out = CH->op1_out[0] + CH->op1_out[1];
+      CH->op1_out[0] = CH->op1_out[1];
+
+      if( !CH->connect1 ){
+        /* algorithm 5  */
+        mem = c1 = c2 = CH->op1_out[0];
+      }else{
+        /* other algorithms */
+        *CH->connect1 += CH->op1_out[0];
+      }
+
+      CH->op1_out[1] = 0;
+      if( eg_out < ENV_QUIET )  /* SLOT 1 */
+      {
+        if (!CH->FB)
+          out=0;
+
+        CH->op1_out[1] = op_calc1(CH->SLOT[SLOT1].phase, eg_out, (out<<CH->FB) );
+      }
+    }
+
+    /* SLOT 2 output is stored in MEM with algorithms 0-3 (SLOT 3 & 4 outputs are never stored) */
+    if (CH->connect2 == &mem)
+    {
+      eg_out = volume_calc(&CH->SLOT[SLOT2]);
+      if( eg_out < ENV_QUIET )
+        mem += op_calc(CH->SLOT[SLOT2].phase, eg_out, c1);
+    }
+
+    /* store current MEM */
+    CH->mem_value = mem;
+
+    /* update phase counters */
+    if(CH->pms)
+    {
+      /* add support for 3 slot mode */
+      if ((ym2612.OPN.ST.mode & 0xC0) && (CH == &ym2612.CH[2]))
+      {
+        update_phase_lfo_slot(&CH->SLOT[SLOT1], CH->pms, ym2612.OPN.SL3.block_fnum[1]);
+        update_phase_lfo_slot(&CH->SLOT[SLOT2], CH->pms, ym2612.OPN.SL3.block_fnum[2]);
+        update_phase_lfo_slot(&CH->SLOT[SLOT3], CH->pms, ym2612.OPN.SL3.block_fnum[0]);
+        update_phase_lfo_slot(&CH->SLOT[SLOT4], CH->pms, CH->block_fnum);
+      }
+      else
+      {
+        update_phase_lfo_channel(CH);
+      }
+    }
+    else  /* no LFO phase modulation */
+    {
+      CH->SLOT[SLOT1].phase += CH->SLOT[SLOT1].Incr;
+      CH->SLOT[SLOT2].phase += CH->SLOT[SLOT2].Incr;
+      CH->SLOT[SLOT3].phase += CH->SLOT[SLOT3].Incr;
+      CH->SLOT[SLOT4].phase += CH->SLOT[SLOT4].Incr;
+    }
+
+    /* next channel */
+    CH++;
+  } while (--num);
+}
+
+#ifdef SIMD_YM2612
+
+/* 8 operators output (one per channel) computed per two table gathers */
+__attribute__((target("avx2"))) static __m256i op_calc_avx2(__m256i index, __m256i env)
+{
+  __m256i p = _mm256_add_epi32(_mm256_slli_epi32(env, 3), _mm256_i32gather_epi32((const int *)sin_tab, index, 4));
+
+  /* operators output is computed if (unsigned) EG output < ENV_QUIET and p < TL_TAB_LEN */
+  __m256i valid = _mm256_cmpeq_epi32(_mm256_min_epu32(env, _mm256_set1_epi32(ENV_QUIET - 1)), env);
+  valid = _mm256_and_si256(valid, _mm256_cmpgt_epi32(_mm256_set1_epi32(TL_TAB_LEN), p));
+
+  return _mm256_mask_i32gather_epi32(_mm256_setzero_si256(), tl_tab, p, valid, 4);
+}
+
+/* Phase increments of all operators for current LFO PM step */
+static void update_incr_lanes(INT32 incr[4][8], int channels)
+{
+  int c, s;
+
+  for (c=0; c<channels; c++)
+  {
+    FM_CH *CH = &ym2612.CH[c];
+
+    if (!CH->pms)
+    {
+      for (s=0; s<4; s++)
+        incr[s][c] = CH->SLOT[s].Incr;
+    }
+    else if ((ym2612.OPN.ST.mode & 0xC0) && (c == 2))
+    {
+      /* 3 slot mode */
+      incr[SLOT1][c] = lfo_slot_incr(&CH->SLOT[SLOT1], CH->pms, ym2612.OPN.SL3.block_fnum[1]);
+      incr[SLOT2][c] = lfo_slot_incr(&CH->SLOT[SLOT2], CH->pms, ym2612.OPN.SL3.block_fnum[2]);
+      incr[SLOT3][c] = lfo_slot_incr(&CH->SLOT[SLOT3], CH->pms, ym2612.OPN.SL3.block_fnum[0]);
+      incr[SLOT4][c] = lfo_slot_incr(&CH->SLOT[SLOT4], CH->pms, CH->block_fnum);
+    }
+    else
+    {
+      for (s=0; s<4; s++)
+        incr[s][c] = lfo_slot_incr(&CH->SLOT[s], CH->pms, CH->block_fnum);
+    }
+  }
+}
+
+/* EG outputs of all operators */
+static void update_vol_lanes(INT32 vol[4][8], int channels)
+{
+  int c, s;
+
+  for (c=0; c<channels; c++)
+  {
+    for (s=0; s<4; s++)
+      vol[s][c] = ym2612.CH[c].SLOT[s].vol_out;
+  }
+}
+
+/* Process samples with all channels in parallel (one per 32-bit lane).                 */
+/* Operators state is copied to lanes at start and only written back at the end, so this */
+/* can only be used when it is not modified between samples (no SSG-EG, no CSM mode).    */
+/* Output is identical to chan_calc().                                                   */
+__attribute__((target("avx2"))) static void ym2612_update_avx2(int *buffer, int length)
+{
+  const __m256i zero = _mm256_setzero_si256();
+  const __m256i sin_mask = _mm256_set1_epi32(SIN_MASK);
+  const __m256i out_max = _mm256_set1_epi32(8192);
+  const __m256i out_min = _mm256_set1_epi32(-8192);
+  INT32 lanes[4][8], incr[4][8], vol[4][8];
+  INT32 ams[8], fb[8], op1_0[8], op1_1[8], memv[8], panl[8], panr[8];
+  INT32 m1_c1[8], m1_mem[8], m1_c2[8], m1_out[8], mem_m2[8], mem_c2[8], mem_mem[8], m3_out[8], m2_out[8];
+  __m256i phase[4], incr_v[4], vol_v[4], amm_v[4], env[4];
+  __m256i ams_v, fb_v, fb_on, op1_v[2], mem_v, dac;
+  __m256i m1_c1_v, m1_mem_v, m1_c2_v, m1_out_v, mem_m2_v, mem_c2_v, mem_mem_v, m3_out_v, m2_out_v, panl_v, panr_v;
+  __m256i x, m2v, c1v, c2v, memo, out, r;
+  __m128i sum;
+  int c, s, i;
+  int channels = ym2612.dacen ? 5 : 6;
+  UINT8 lfo_cnt;
+
+  /* unused lanes (including DAC channel) have quiet operators & no output */
+  memset(lanes, 0, sizeof(lanes));
+  memset(ams, 0, sizeof(ams));
+  memset(fb, 0, sizeof(fb));
+  memset(op1_0, 0, sizeof(op1_0));
+  memset(op1_1, 0, sizeof(op1_1));
+  memset(memv, 0, sizeof(memv));
+  memset(panl, 0, sizeof(panl));
+  memset(panr, 0, sizeof(panr));
+  memset(incr, 0, sizeof(incr));
+  memset(m1_c1, 0, sizeof(m1_c1));
+  memset(m1_mem, 0, sizeof(m1_mem));
+  memset(m1_c2, 0, sizeof(m1_c2));
+  memset(m1_out, 0, sizeof(m1_out));
+  memset(mem_m2, 0, sizeof(mem_m2));
+  memset(mem_c2, 0, sizeof(mem_c2));
+  memset(mem_mem, 0, sizeof(mem_mem));
+  memset(m3_out, 0, sizeof(m3_out));
+  memset(m2_out, 0, sizeof(m2_out));
+  for (s=0; s<4; s++)
+    for (c=0; c<8; c++)
+      vol[s][c] = MAX_ATT_INDEX;
+
+  /* channels & operators state */
+  for (c=0; c<channels; c++)
+  {
+    FM_CH *CH = &ym2612.CH[c];
+    INT32 *carrier = &out_fm[c];
+
+    ams[c] = CH->ams;
+    fb[c] = CH->FB;
+    op1_0[c] = CH->op1_out[0];
+    op1_1[c] = CH->op1_out[1];
+    memv[c] = CH->mem_value;
+
+    /* operators connections (see setup_connection) */
+    m1_c1[c]  = (!CH->connect1 || (CH->connect1 == &c1)) ? -1 : 0;
+    m1_mem[c] = (!CH->connect1 || (CH->connect1 == &mem)) ? -1 : 0;
+    m1_c2[c]  = (!CH->connect1 || (CH->connect1 == &c2)) ? -1 : 0;
+    m1_out[c] = (CH->connect1 == carrier) ? -1 : 0;
+    mem_m2[c]  = (CH->mem_connect == &m2) ? -1 : 0;
+    mem_c2[c]  = (CH->mem_connect == &c2) ? -1 : 0;
+    mem_mem[c] = (CH->mem_connect == &mem) ? -1 : 0;
+    m3_out[c] = (CH->connect3 == carrier) ? -1 : 0;
+    m2_out[c] = (CH->connect2 == carrier) ? -1 : 0;
+
+    for (s=0; s<4; s++)
+    {
+      lanes[s][c] = CH->SLOT[s].phase;
+    }
+  }
+
+  /* stereo outputs (DAC channel output is added separately) */
+  for (c=0; c<6; c++)
+  {
+    panl[c] = ym2612.OPN.pan[c*2];
+    panr[c] = ym2612.OPN.pan[c*2+1];
+  }
+  dac = _mm256_setzero_si256();
+  if (ym2612.dacen)
+  {
+    dac = _mm256_insert_epi32(dac, ym2612.dacout, 5);
+  }
+
+  for (s=0; s<4; s++)
+  {
+    phase[s] = _mm256_loadu_si256((__m256i *)lanes[s]);
+    for (c=0; c<channels; c++)
+      lanes[s][c] = ym2612.CH[c].SLOT[s].AMmask;
+    amm_v[s] = _mm256_loadu_si256((__m256i *)lanes[s]);
+  }
+
+  ams_v = _mm256_loadu_si256((__m256i *)ams);
+  fb_v = _mm256_loadu_si256((__m256i *)fb);
+  fb_on = _mm256_xor_si256(_mm256_cmpeq_epi32(fb_v, zero), _mm256_set1_epi32(-1));
+  op1_v[0] = _mm256_loadu_si256((__m256i *)op1_0);
+  op1_v[1] = _mm256_loadu_si256((__m256i *)op1_1);
+  mem_v = _mm256_loadu_si256((__m256i *)memv);
+  m1_c1_v = _mm256_loadu_si256((__m256i *)m1_c1);
+  m1_mem_v = _mm256_loadu_si256((__m256i *)m1_mem);
+  m1_c2_v = _mm256_loadu_si256((__m256i *)m1_c2);
+  m1_out_v = _mm256_loadu_si256((__m256i *)m1_out);
+  mem_m2_v = _mm256_loadu_si256((__m256i *)mem_m2);
+  mem_c2_v = _mm256_loadu_si256((__m256i *)mem_c2);
+  mem_mem_v = _mm256_loadu_si256((__m256i *)mem_mem);
+  m3_out_v = _mm256_loadu_si256((__m256i *)m3_out);
+  m2_out_v = _mm256_loadu_si256((__m256i *)m2_out);
+  panl_v = _mm256_loadu_si256((__m256i *)panl);
+  panr_v = _mm256_loadu_si256((__m256i *)panr);
+
+  /* phase increments & EG outputs only change on LFO or EG steps */
+  update_incr_lanes(incr, channels);
+  update_vol_lanes(vol, channels);
+  for (s=0; s<4; s++)
+  {
+    incr_v[s] = _mm256_loadu_si256((__m256i *)incr[s]);
+    vol_v[s] = _mm256_loadu_si256((__m256i *)vol[s]);
+  }
+  x = _mm256_srlv_epi32(_mm256_set1_epi32(ym2612.OPN.LFO_AM), ams_v);
+  for (s=0; s<4; s++)
+    env[s] = _mm256_add_epi32(vol_v[s], _mm256_and_si256(x, amm_v[s]));
+
+  for (i=0; i<length; i++)
+  {
+    /* restore delayed sample (MEM) value to m2 or c2 */
+    m2v = _mm256_and_si256(mem_v, mem_m2_v);
+    c2v = _mm256_and_si256(mem_v, mem_c2_v);
+    memo = _mm256_and_si256(mem_v, mem_mem_v);
+
+    /* SLOT 1 previous output (feedback) */
+    r = _mm256_add_epi32(op1_v[0], op1_v[1]);
+    op1_v[0] = op1_v[1];
+    c1v = _mm256_and_si256(op1_v[0], m1_c1_v);
+    memo = _mm256_add_epi32(memo, _mm256_and_si256(op1_v[0], m1_mem_v));
+    c2v = _mm256_add_epi32(c2v, _mm256_and_si256(op1_v[0], m1_c2_v));
+    out = _mm256_add_epi32(dac, _mm256_and_si256(op1_v[0], m1_out_v));
+
+    /* SLOT 1 */
+    r = _mm256_and_si256(_mm256_sllv_epi32(r, fb_v), fb_on);
+    x = _mm256_and_si256(_mm256_srli_epi32(_mm256_add_epi32(phase[SLOT1], r), SIN_BITS), sin_mask);
+    op1_v[1] = op_calc_avx2(x, env[SLOT1]);
+
+    /* SLOT 3 */
+    x = _mm256_and_si256(_mm256_add_epi32(_mm256_srli_epi32(phase[SLOT3], SIN_BITS), _mm256_srli_epi32(m2v, 1)), sin_mask);
+    r = op_calc_avx2(x, env[SLOT3]);
+    out = _mm256_add_epi32(out, _mm256_and_si256(r, m3_out_v));
+    c2v = _mm256_add_epi32(c2v, _mm256_andnot_si256(m3_out_v, r));
+
+    /* SLOT 2 */
+    x = _mm256_and_si256(_mm256_add_epi32(_mm256_srli_epi32(phase[SLOT2], SIN_BITS), _mm256_srli_epi32(c1v, 1)), sin_mask);
+    r = op_calc_avx2(x, env[SLOT2]);
+    out = _mm256_add_epi32(out, _mm256_and_si256(r, m2_out_v));
+    memo = _mm256_add_epi32(memo, _mm256_andnot_si256(m2_out_v, r));
+
+    /* SLOT 4 */
+    x = _mm256_and_si256(_mm256_add_epi32(_mm256_srli_epi32(phase[SLOT4], SIN_BITS), _mm256_srli_epi32(c2v, 1)), sin_mask);
+    out = _mm256_add_epi32(out, op_calc_avx2(x, env[SLOT4]));
+
+    /* store current MEM */
+    mem_v = memo;
+
+    /* update phase counters AFTER output calculations */
+    for (s=0; s<4; s++)
+      phase[s] = _mm256_add_epi32(phase[s], incr_v[s]);
+
+    /* advance LFO */
+    lfo_cnt = ym2612.OPN.lfo_cnt;
+    advance_lfo();
+    if (ym2612.OPN.lfo_cnt != lfo_cnt)
+    {
+      update_incr_lanes(incr, channels);
+      for (s=0; s<4; s++)
+        incr_v[s] = _mm256_loadu_si256((__m256i *)incr[s]);
+    }
+
+    /* advance envelope generator */
+    ym2612.OPN.eg_timer ++;
+
+    /* EG is updated every 3 samples */
+    if (ym2612.OPN.eg_timer >= 3)
+    {
+      ym2612.OPN.eg_timer = 0;
+      ym2612.OPN.eg_cnt++;
+      advance_eg_channels(&ym2612.CH[0], ym2612.OPN.eg_cnt);
+      update_vol_lanes(vol, channels);
+      for (s=0; s<4; s++)
+        vol_v[s] = _mm256_loadu_si256((__m256i *)vol[s]);
+    }
+
+    /* apply LFO AM to EG outputs */
+    x = _mm256_srlv_epi32(_mm256_set1_epi32(ym2612.OPN.LFO_AM), ams_v);
+    for (s=0; s<4; s++)
+      env[s] = _mm256_add_epi32(vol_v[s], _mm256_and_si256(x, amm_v[s]));
+
+    /* 14-bit accumulator channels outputs (range is -8192;+8192) */
+    out = _mm256_min_epi32(_mm256_max_epi32(out, out_min), out_max);
+
+    /* stereo DAC channels outputs mixing */
+    x = _mm256_hadd_epi32(_mm256_and_si256(out, panl_v), _mm256_and_si256(out, panr_v));
+    x = _mm256_hadd_epi32(x, x);
+    sum = _mm_add_epi32(_mm256_castsi256_si128(x), _mm256_extracti128_si256(x, 1));
+
+    /* buffering */
+    *buffer++ = _mm_cvtsi128_si32(sum);
+    *buffer++ = _mm_extract_epi32(sum, 1);
+
+    /* CSM mode: if CSM Key ON has occured, CSM Key OFF need to be sent       */
+    /* only if Timer A does not overflow again (i.e CSM Key ON not set again) */
+    ym2612.OPN.SL3.key_csm <<= 1;
+
+    /* timer A control */
+    INTERNAL_TIMER_A();
+
+    /* CSM Mode Key ON still disabled */
+    if (ym2612.OPN.SL3.key_csm & 2)
+    {
+      /* CSM Mode Key OFF (verified by Nemesis on real hardware) */
+      FM_KEYOFF_CSM(&ym2612.CH[2],SLOT1);
+      FM_KEYOFF_CSM(&ym2612.CH[2],SLOT2);
+      FM_KEYOFF_CSM(&ym2612.CH[2],SLOT3);
+      FM_KEYOFF_CSM(&ym2612.CH[2],SLOT4);
+      ym2612.OPN.SL3.key_csm = 0;
+    }
+  }
+
+  /* write back channels & operators state */
+  for (s=0; s<4; s++)
+    _mm256_storeu_si256((__m256i *)lanes[s], phase[s]);
+  _mm256_storeu_si256((__m256i *)op1_0, op1_v[0]);
+  _mm256_storeu_si256((__m256i *)op1_1, op1_v[1]);
+  _mm256_storeu_si256((__m256i *)memv, mem_v);
+
+  for (c=0; c<channels; c++)
+  {
+    FM_CH *CH = &ym2612.CH[c];
+
+    for (s=0; s<4; s++)
+      CH->SLOT[s].phase = lanes[s][c];
+    CH->op1_out[0] = op1_0[c];
+    CH->op1_out[1] = op1_1[c];
+    CH->mem_value = memv[c];
+  }
+}
+
+/* Parallel synthesis function (selected by host CPU features) */
+static void (*ym2612_update_simd)(int *buffer, int length) = NULL;
+
+#endif /* SIMD_YM2612 */
+
 /* write a OPN mode register 0x20-0x2f */
 INLINE void OPNWriteMode(int r, int v)
 {
@@ -1772,7 +2163,7 @@ static void reset_channels(FM_CH *CH , int num )
 /* initialize generic tables */
 static void init_tables(void)
 {
-  signed int d,i,x;
+  signed int i,x;
   signed int n;
   double o,m;
 
@@ -1866,16 +2257,14 @@ static void init_tables(void)
     }
   }
 
-  /* build DETUNE table */
-  for (d = 0;d <= 3;d++)
+#ifdef SIMD_YM2612
+  /* select synthesis function supported by host CPU */
+  __builtin_cpu_init();
+  if (__builtin_cpu_supports("avx2"))
   {
-    for (i = 0;i <= 31;i++)
-    {
-      ym2612.OPN.ST.dt_tab[d][i]   = (INT32) dt_tab[d*32 + i];
-      ym2612.OPN.ST.dt_tab[d+4][i] = -ym2612.OPN.ST.dt_tab[d][i];
-    }
+    ym2612_update_simd = ym2612_update_avx2;
   }
-
+#endif
 }
 
 
@@ -1883,8 +2272,22 @@ static void init_tables(void)
 /* initialize ym2612 emulator */
 void YM2612Init(void)
 {
+  int d,i;
+
   memset(&ym2612,0,sizeof(YM2612));
-  init_tables();
+
+  /* generic tables are shared by all emulated chips and only need to be initialized once */
+  RUN_ONCE(init_tables);
+
+  /* build DETUNE table */
+  for (d = 0;d <= 3;d++)
+  {
+    for (i = 0;i <= 31;i++)
+    {
+      ym2612.OPN.ST.dt_tab[d][i]   = (INT32) dt_tab[d*32 + i];
+      ym2612.OPN.ST.dt_tab[d+4][i] = -ym2612.OPN.ST.dt_tab[d][i];
+    }
+  }
 }
 
 /* reset OPN registers */
@@ -1981,11 +2384,10 @@ unsigned int YM2612Read(void)
   return ym2612.OPN.ST.status & 0xff;
 }
 
-/* Generate samples for ym2612 */
-void YM2612Update(int *buffer, int length)
+/* refresh PG increments and EG rates if required, returns SSG-EG enabled flag */
+INLINE int refresh_fc_eg(void)
 {
-  int i;
-  int lt,rt;
+  int i, ssg;
 
   /* refresh PG increments and EG rates if required */
   refresh_fc_eg_chan(&ym2612.CH[0]);
@@ -2011,6 +2413,38 @@ void YM2612Update(int *buffer, int length)
   refresh_fc_eg_chan(&ym2612.CH[4]);
   refresh_fc_eg_chan(&ym2612.CH[5]);
 
+  /* check if SSG-EG is enabled on any operator (only changed by register writes) */
+  for (i=0, ssg=0; i < 6*4; i++)
+  {
+    ssg |= ym2612.CH[i >> 2].SLOT[i & 3].ssg;
+  }
+  return ssg & 0x08;
+}
+
+/* Generate samples for ym2612 */
+void YM2612Update(int *buffer, int length)
+{
+  int i, ssg;
+  int lt,rt;
+
+  PROFILE_BEGIN(PROFILE_YM2612_UPDATE);
+
+  ssg = refresh_fc_eg();
+
+#ifdef SIMD_YM2612
+  /* all channels processed in parallel, unless operators state is updated between samples */
+  if (ym2612_update_simd && !ssg && ((ym2612.OPN.ST.mode & 0xC0) != 0x80) && (length >= 4))
+  {
+    ym2612_update_simd(buffer, length);
+
+    /* timer B control */
+    INTERNAL_TIMER_B(length);
+
+    PROFILE_END(PROFILE_YM2612_UPDATE);
+    return;
+  }
+#endif
+
   /* buffering */
   for(i=0; i < length ; i++)
   {
@@ -2023,7 +2457,10 @@ void YM2612Update(int *buffer, int length)
     out_fm[5] = 0;
 
     /* update SSG-EG output */
-    update_ssg_eg_channels(&ym2612.CH[0]);
+    if (ssg)
+    {
+      update_ssg_eg_channels(&ym2612.CH[0]);
+    }
 
     /* calculate FM */
     if (!ym2612.dacen)
@@ -2104,6 +2541,65 @@ void YM2612Update(int *buffer, int length)
 
   /* timer B control */
   INTERNAL_TIMER_B(length);
+
+  PROFILE_END(PROFILE_YM2612_UPDATE);
+}
+
+/* Run ym2612 without generating samples (chip state is updated the same way as YM2612Update) */
+void YM2612Run(int length)
+{
+  int i, ssg;
+
+  PROFILE_BEGIN(PROFILE_YM2612_UPDATE);
+
+  ssg = refresh_fc_eg();
+
+  for(i=0; i < length ; i++)
+  {
+    /* update SSG-EG output */
+    if (ssg)
+    {
+      update_ssg_eg_channels(&ym2612.CH[0]);
+    }
+
+    /* channel 6 is not calculated in DAC Mode */
+    chan_calc_state(&ym2612.CH[0], ym2612.dacen ? 5 : 6);
+
+    /* advance LFO */
+    advance_lfo();
+
+    /* advance envelope generator */
+    ym2612.OPN.eg_timer ++;
+
+    /* EG is updated every 3 samples */
+    if (ym2612.OPN.eg_timer >= 3)
+    {
+      ym2612.OPN.eg_timer = 0;
+      ym2612.OPN.eg_cnt++;
+      advance_eg_channels(&ym2612.CH[0], ym2612.OPN.eg_cnt);
+    }
+
+    /* CSM mode Key OFF if Timer A does not overflow again */
+    ym2612.OPN.SL3.key_csm <<= 1;
+
+    /* timer A control */
+    INTERNAL_TIMER_A();
+
+    /* CSM Mode Key ON still disabled */
+    if (ym2612.OPN.SL3.key_csm & 2)
+    {
+      FM_KEYOFF_CSM(&ym2612.CH[2],SLOT1);
+      FM_KEYOFF_CSM(&ym2612.CH[2],SLOT2);
+      FM_KEYOFF_CSM(&ym2612.CH[2],SLOT3);
+      FM_KEYOFF_CSM(&ym2612.CH[2],SLOT4);
+      ym2612.OPN.SL3.key_csm = 0;
+    }
+  }
+
+  /* timer B control */
+  INTERNAL_TIMER_B(length);
+
+  PROFILE_END(PROFILE_YM2612_UPDATE);
 }
 
 void YM2612Config(unsigned char dac_bits)
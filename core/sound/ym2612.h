@@ -20,6 +20,7 @@ extern void YM2612Init(void);
 extern void YM2612Config(unsigned char dac_bits);
 extern void YM2612ResetChip(void);
 extern void YM2612Update(int *buffer, int length);
+extern void YM2612Run(int length);
 extern void YM2612Write(unsigned int a, unsigned int v);
 extern unsigned int YM2612Read(void);
 extern int YM2612LoadContext(unsigned char *state);
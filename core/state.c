@@ -38,44 +38,31 @@
 
 #include "shared.h"
 
-int state_load(unsigned char *state)
-{
-  int i, bufferptr = 0;
+/* Tracked memory pages modified since last savestate */
+THREAD_CONTEXT unsigned char state_dirty[DIRTY_PAGES];
 
-  /* signature check (GENPLUS-GX x.x.x) */
-  char version[17];
-  load_param(version,16);
-  version[16] = 0;
-  if (memcmp(version,STATE_VERSION,11))
-  {
-    return 0;
-  }
+/* Incremental savestate flag */
+static THREAD_CONTEXT int state_delta;
 
-  /* version check */
-  if ((version[11] < 0x31) || (version[13] < 0x37) || (version[15] < 0x35))
-  {
-    return 0;
-  }
+/* In-place savestate restore flag */
+static THREAD_CONTEXT int state_inplace;
 
-  /* reset system */
-  system_reset();
+/* Savestate sections */
+typedef struct
+{
+  char tag[4];
+  int (*load)(unsigned char *state);
+  int (*save)(unsigned char *state);
+} t_state_section;
 
-  /* enable VDP access for TMSS systems */
-  for (i=0xc0; i<0xe0; i+=8)
-  {
-    m68k.memory_map[i].read8    = vdp_read_byte;
-    m68k.memory_map[i].read16   = vdp_read_word;
-    m68k.memory_map[i].write8   = vdp_write_byte;
-    m68k.memory_map[i].write16  = vdp_write_word;
-    zbank_memory_map[i].read    = zbank_read_vdp;
-    zbank_memory_map[i].write   = zbank_write_vdp;
-  }
+static int ram_load(unsigned char *state)
+{
+  int bufferptr = 0;
 
-  /* GENESIS */
   if ((system_hw & SYSTEM_PBC) == SYSTEM_MD)
   {
-    load_param(work_ram, sizeof(work_ram));
-    load_param(zram, sizeof(zram));
+    load_pages(work_ram, sizeof(work_ram), DIRTY_WORK_RAM);
+    load_pages(zram, sizeof(zram), DIRTY_ZRAM);
     load_param(&zstate, sizeof(zstate));
     load_param(&zbank, sizeof(zbank));
     if (zstate == 3)
@@ -95,10 +82,35 @@ int state_load(unsigned char *state)
   }
   else
   {
-    load_param(work_ram, 0x2000);
+    load_pages(work_ram, 0x2000, DIRTY_WORK_RAM);
   }
 
-  /* IO */
+  return bufferptr;
+}
+
+static int ram_save(unsigned char *state)
+{
+  int bufferptr = 0;
+
+  if ((system_hw & SYSTEM_PBC) == SYSTEM_MD)
+  {
+    save_pages(work_ram, sizeof(work_ram), DIRTY_WORK_RAM);
+    save_pages(zram, sizeof(zram), DIRTY_ZRAM);
+    save_param(&zstate, sizeof(zstate));
+    save_param(&zbank, sizeof(zbank));
+  }
+  else
+  {
+    save_pages(work_ram, 0x2000, DIRTY_WORK_RAM);
+  }
+
+  return bufferptr;
+}
+
+static int io_load(unsigned char *state)
+{
+  int bufferptr = 0;
+
   load_param(io_reg, sizeof(io_reg));
   if ((system_hw & SYSTEM_PBC) == SYSTEM_MD)
   {
@@ -107,13 +119,29 @@ int state_load(unsigned char *state)
   else
   {
     io_reg[0] = 0x80 | (region_code >> 1);
+
+    /* PAUSE button state (NMI is edge-triggered) */
+    load_param(&pause_b, sizeof(pause_b));
   }
 
-  /* VDP */
-  bufferptr += vdp_context_load(&state[bufferptr]);
+  return bufferptr;
+}
+
+static int io_save(unsigned char *state)
+{
+  int bufferptr = 0;
+  save_param(io_reg, sizeof(io_reg));
+  if ((system_hw & SYSTEM_PBC) != SYSTEM_MD)
+  {
+    save_param(&pause_b, sizeof(pause_b));
+  }
+  return bufferptr;
+}
+
+static int sound_load(unsigned char *state)
+{
+  int bufferptr = sound_context_load(state);
 
-  /* SOUND */
-  bufferptr += sound_context_load(&state[bufferptr]);
   if ((system_hw & SYSTEM_PBC) == SYSTEM_MD)
   {
     SN76489_Config(0, config.psg_preamp, config.psgBoostNoise, 0xff);
@@ -123,161 +151,560 @@ int state_load(unsigned char *state)
     SN76489_Config(0, config.psg_preamp, config.psgBoostNoise, io_reg[6]);
   }
 
-  /* 68000 */
-  if ((system_hw & SYSTEM_PBC) == SYSTEM_MD)
-  {
-    uint16 tmp16;
-    uint32 tmp32;
-    load_param(&tmp32, 4); m68k_set_reg(M68K_REG_D0, tmp32);
-    load_param(&tmp32, 4); m68k_set_reg(M68K_REG_D1, tmp32);
-    load_param(&tmp32, 4); m68k_set_reg(M68K_REG_D2, tmp32);
-    load_param(&tmp32, 4); m68k_set_reg(M68K_REG_D3, tmp32);
-    load_param(&tmp32, 4); m68k_set_reg(M68K_REG_D4, tmp32);
-    load_param(&tmp32, 4); m68k_set_reg(M68K_REG_D5, tmp32);
-    load_param(&tmp32, 4); m68k_set_reg(M68K_REG_D6, tmp32);
-    load_param(&tmp32, 4); m68k_set_reg(M68K_REG_D7, tmp32);
-    load_param(&tmp32, 4); m68k_set_reg(M68K_REG_A0, tmp32);
-    load_param(&tmp32, 4); m68k_set_reg(M68K_REG_A1, tmp32);
-    load_param(&tmp32, 4); m68k_set_reg(M68K_REG_A2, tmp32);
-    load_param(&tmp32, 4); m68k_set_reg(M68K_REG_A3, tmp32);
-    load_param(&tmp32, 4); m68k_set_reg(M68K_REG_A4, tmp32);
-    load_param(&tmp32, 4); m68k_set_reg(M68K_REG_A5, tmp32);
-    load_param(&tmp32, 4); m68k_set_reg(M68K_REG_A6, tmp32);
-    load_param(&tmp32, 4); m68k_set_reg(M68K_REG_A7, tmp32);
-    load_param(&tmp32, 4); m68k_set_reg(M68K_REG_PC, tmp32);  
-    load_param(&tmp16, 2); m68k_set_reg(M68K_REG_SR, tmp16);
-    load_param(&tmp32, 4); m68k_set_reg(M68K_REG_USP,tmp32);
-    load_param(&tmp32, 4); m68k_set_reg(M68K_REG_ISP,tmp32);
-
-  	load_param(&m68k.cycles, sizeof(m68k.cycles));
-    load_param(&m68k.int_level, sizeof(m68k.int_level));
-    load_param(&m68k.stopped, sizeof(m68k.stopped));
-  }
-
-  /* Z80 */ 
+  return bufferptr;
+}
+
+static int m68k_load(unsigned char *state)
+{
+  int bufferptr = 0;
+  uint16 tmp16;
+  uint32 tmp32;
+
+  /* interrupts pending before state was loaded should not be processed when SR is restored */
+  m68k.int_level = 0;
+
+  load_param(&tmp32, 4); m68k_set_reg(M68K_REG_D0, tmp32);
+  load_param(&tmp32, 4); m68k_set_reg(M68K_REG_D1, tmp32);
+  load_param(&tmp32, 4); m68k_set_reg(M68K_REG_D2, tmp32);
+  load_param(&tmp32, 4); m68k_set_reg(M68K_REG_D3, tmp32);
+  load_param(&tmp32, 4); m68k_set_reg(M68K_REG_D4, tmp32);
+  load_param(&tmp32, 4); m68k_set_reg(M68K_REG_D5, tmp32);
+  load_param(&tmp32, 4); m68k_set_reg(M68K_REG_D6, tmp32);
+  load_param(&tmp32, 4); m68k_set_reg(M68K_REG_D7, tmp32);
+  load_param(&tmp32, 4); m68k_set_reg(M68K_REG_A0, tmp32);
+  load_param(&tmp32, 4); m68k_set_reg(M68K_REG_A1, tmp32);
+  load_param(&tmp32, 4); m68k_set_reg(M68K_REG_A2, tmp32);
+  load_param(&tmp32, 4); m68k_set_reg(M68K_REG_A3, tmp32);
+  load_param(&tmp32, 4); m68k_set_reg(M68K_REG_A4, tmp32);
+  load_param(&tmp32, 4); m68k_set_reg(M68K_REG_A5, tmp32);
+  load_param(&tmp32, 4); m68k_set_reg(M68K_REG_A6, tmp32);
+  load_param(&tmp32, 4); m68k_set_reg(M68K_REG_A7, tmp32);
+  load_param(&tmp32, 4); m68k_set_reg(M68K_REG_PC, tmp32);  
+  load_param(&tmp16, 2); m68k_set_reg(M68K_REG_SR, tmp16);
+  load_param(&tmp32, 4); m68k_set_reg(M68K_REG_USP,tmp32);
+  load_param(&tmp32, 4); m68k_set_reg(M68K_REG_ISP,tmp32);
+
+  load_param(&m68k.cycles, sizeof(m68k.cycles));
+  load_param(&m68k.int_level, sizeof(m68k.int_level));
+  load_param(&m68k.stopped, sizeof(m68k.stopped));
+
+  return bufferptr;
+}
+
+static int m68k_save(unsigned char *state)
+{
+  int bufferptr = 0;
+  uint16 tmp16;
+  uint32 tmp32;
+
+  tmp32 = m68k_get_reg(M68K_REG_D0);  save_param(&tmp32, 4);
+  tmp32 = m68k_get_reg(M68K_REG_D1);  save_param(&tmp32, 4);
+  tmp32 = m68k_get_reg(M68K_REG_D2);  save_param(&tmp32, 4);
+  tmp32 = m68k_get_reg(M68K_REG_D3);  save_param(&tmp32, 4);
+  tmp32 = m68k_get_reg(M68K_REG_D4);  save_param(&tmp32, 4);
+  tmp32 = m68k_get_reg(M68K_REG_D5);  save_param(&tmp32, 4);
+  tmp32 = m68k_get_reg(M68K_REG_D6);  save_param(&tmp32, 4);
+  tmp32 = m68k_get_reg(M68K_REG_D7);  save_param(&tmp32, 4);
+  tmp32 = m68k_get_reg(M68K_REG_A0);  save_param(&tmp32, 4);
+  tmp32 = m68k_get_reg(M68K_REG_A1);  save_param(&tmp32, 4);
+  tmp32 = m68k_get_reg(M68K_REG_A2);  save_param(&tmp32, 4);
+  tmp32 = m68k_get_reg(M68K_REG_A3);  save_param(&tmp32, 4);
+  tmp32 = m68k_get_reg(M68K_REG_A4);  save_param(&tmp32, 4);
+  tmp32 = m68k_get_reg(M68K_REG_A5);  save_param(&tmp32, 4);
+  tmp32 = m68k_get_reg(M68K_REG_A6);  save_param(&tmp32, 4);
+  tmp32 = m68k_get_reg(M68K_REG_A7);  save_param(&tmp32, 4);
+  tmp32 = m68k_get_reg(M68K_REG_PC);  save_param(&tmp32, 4);
+  tmp16 = m68k_get_reg(M68K_REG_SR);  save_param(&tmp16, 2); 
+  tmp32 = m68k_get_reg(M68K_REG_USP); save_param(&tmp32, 4);
+  tmp32 = m68k_get_reg(M68K_REG_ISP); save_param(&tmp32, 4);
+
+  save_param(&m68k.cycles, sizeof(m68k.cycles));
+  save_param(&m68k.int_level, sizeof(m68k.int_level));
+  save_param(&m68k.stopped, sizeof(m68k.stopped));
+
+  return bufferptr;
+}
+
+static int z80_load(unsigned char *state)
+{
+  int bufferptr = 0;
   load_param(&Z80, sizeof(Z80_Regs));
   Z80.irq_callback = z80_irq_callback;
+  return bufferptr;
+}
 
-  /* Extra HW */
-  if (system_hw == SYSTEM_MCD)
-  {
-    /* handle case of MD cartridge using or not CD hardware */
-    char id[5];
-    load_param(id,4);
-    id[4] = 0;
+static int z80_save(unsigned char *state)
+{
+  int bufferptr = 0;
+  save_param(&Z80, sizeof(Z80_Regs));
+  return bufferptr;
+}
 
-    /* check if CD hardware was enabled before attempting to restore */
-    if (memcmp(id,"SCD!",4))
-    {
-       return 0;
-    }
+static int cart_load(unsigned char *state)
+{
+  int bufferptr;
 
-    /* CD hardware */
-    bufferptr += scd_context_load(&state[bufferptr]);
-  }
-  else if ((system_hw & SYSTEM_PBC) == SYSTEM_MD)
-  {  
+  if ((system_hw & SYSTEM_PBC) == SYSTEM_MD)
+  {
     /* MD cartridge hardware */
-    bufferptr += md_cart_context_load(&state[bufferptr]);
+    bufferptr = md_cart_context_load(state);
   }
   else
   {
     /* MS cartridge hardware */
-    bufferptr += sms_cart_context_load(&state[bufferptr]);
+    bufferptr = sms_cart_context_load(state);
     sms_cart_switch(~io_reg[0x0E]);
   }
 
   return bufferptr;
 }
 
-int state_save(unsigned char *state)
+static int cart_save(unsigned char *state)
 {
-  /* buffer size */
-  int bufferptr = 0;
+  if ((system_hw & SYSTEM_PBC) == SYSTEM_MD)
+  {
+    /* MD cartridge hardware */
+    return md_cart_context_save(state);
+  }
 
-  /* version string */
-  char version[16];
-  strncpy(version,STATE_VERSION,16);
-  save_param(version, 16);
+  /* MS cartridge hardware */
+  return sms_cart_context_save(state);
+}
 
-  /* GENESIS */
-  if ((system_hw & SYSTEM_PBC) == SYSTEM_MD)
+#define SECTION_RAM   0
+#define SECTION_IO    1
+#define SECTION_VDP   2
+#define SECTION_SOUND 3
+#define SECTION_M68K  4
+#define SECTION_Z80   5
+#define SECTION_SCD   6
+#define SECTION_CART  7
+#define SECTION_MAX   8
+
+/* sections are saved in this order, each one being preceded by its tag and length */
+static const t_state_section state_sections[SECTION_MAX] =
+{
+  {{'R','A','M',' '}, ram_load,         ram_save},
+  {{'I','O',' ',' '}, io_load,          io_save},
+  {{'V','D','P',' '}, vdp_context_load, vdp_context_save},
+  {{'S','N','D',' '}, sound_load,       sound_context_save},
+  {{'6','8','K',' '}, m68k_load,        m68k_save},
+  {{'Z','8','0',' '}, z80_load,         z80_save},
+  {{'S','C','D',' '}, scd_context_load, scd_context_save},   /* CD hardware (including MD cartridge hardware) */
+  {{'C','A','R','T'}, cart_load,        cart_save}
+};
+
+/* last section tag */
+static const char state_end[4] = {'E','N','D',' '};
+
+/* sections needed by current hardware */
+static int state_section_used(int id)
+{
+  switch (id)
   {
-    save_param(work_ram, sizeof(work_ram));
-    save_param(zram, sizeof(zram));
-    save_param(&zstate, sizeof(zstate));
-    save_param(&zbank, sizeof(zbank));
+    case SECTION_M68K:
+      return ((system_hw & SYSTEM_PBC) == SYSTEM_MD);
+
+    case SECTION_SCD:
+      return (system_hw == SYSTEM_MCD);
+
+    case SECTION_CART:
+      return (system_hw != SYSTEM_MCD);
+
+    default:
+      return 1;
   }
-  else
+}
+
+/* Check all sections are within savestate buffer, up to end of savestate */
+static int state_check_sections(unsigned char *state, int length)
+{
+  int size, bufferptr = 16;
+  char tag[4];
+
+  while ((length - bufferptr) >= 8)
   {
-    save_param(work_ram, 0x2000);
+    /* section header */
+    load_param(tag, 4);
+    load_param(&size, 4);
+
+    if (!memcmp(tag, state_end, 4))
+    {
+      return 1;
+    }
+
+    if ((size < 0) || (size > (length - bufferptr)))
+    {
+      return 0;
+    }
+
+    bufferptr += size;
   }
 
-  /* IO */
-  save_param(io_reg, sizeof(io_reg));
+  return 0;
+}
 
-  /* VDP */
-  bufferptr += vdp_context_save(&state[bufferptr]);
+static int state_save_sections(unsigned char *state);
 
-  /* SOUND */
-  bufferptr += sound_context_save(&state[bufferptr]);
+/* Get size of each hardware section included in a checked savestate (-1 if not included) */
+static void state_section_sizes(unsigned char *state, int *sizes)
+{
+  int i, size, bufferptr = 16;
+  char tag[4];
 
-  /* 68000 */ 
-  if ((system_hw & SYSTEM_PBC) == SYSTEM_MD)
+  for (i=0; i<SECTION_MAX; i++)
   {
-    uint16 tmp16;
-    uint32 tmp32;
-    tmp32 = m68k_get_reg(M68K_REG_D0);  save_param(&tmp32, 4);
-    tmp32 = m68k_get_reg(M68K_REG_D1);  save_param(&tmp32, 4);
-    tmp32 = m68k_get_reg(M68K_REG_D2);  save_param(&tmp32, 4);
-    tmp32 = m68k_get_reg(M68K_REG_D3);  save_param(&tmp32, 4);
-    tmp32 = m68k_get_reg(M68K_REG_D4);  save_param(&tmp32, 4);
-    tmp32 = m68k_get_reg(M68K_REG_D5);  save_param(&tmp32, 4);
-    tmp32 = m68k_get_reg(M68K_REG_D6);  save_param(&tmp32, 4);
-    tmp32 = m68k_get_reg(M68K_REG_D7);  save_param(&tmp32, 4);
-    tmp32 = m68k_get_reg(M68K_REG_A0);  save_param(&tmp32, 4);
-    tmp32 = m68k_get_reg(M68K_REG_A1);  save_param(&tmp32, 4);
-    tmp32 = m68k_get_reg(M68K_REG_A2);  save_param(&tmp32, 4);
-    tmp32 = m68k_get_reg(M68K_REG_A3);  save_param(&tmp32, 4);
-    tmp32 = m68k_get_reg(M68K_REG_A4);  save_param(&tmp32, 4);
-    tmp32 = m68k_get_reg(M68K_REG_A5);  save_param(&tmp32, 4);
-    tmp32 = m68k_get_reg(M68K_REG_A6);  save_param(&tmp32, 4);
-    tmp32 = m68k_get_reg(M68K_REG_A7);  save_param(&tmp32, 4);
-    tmp32 = m68k_get_reg(M68K_REG_PC);  save_param(&tmp32, 4);
-    tmp16 = m68k_get_reg(M68K_REG_SR);  save_param(&tmp16, 2); 
-    tmp32 = m68k_get_reg(M68K_REG_USP); save_param(&tmp32, 4);
-    tmp32 = m68k_get_reg(M68K_REG_ISP); save_param(&tmp32, 4);
-
-    save_param(&m68k.cycles, sizeof(m68k.cycles));
-    save_param(&m68k.int_level, sizeof(m68k.int_level));
-    save_param(&m68k.stopped, sizeof(m68k.stopped));
-  }
-
-  /* Z80 */ 
-  save_param(&Z80, sizeof(Z80_Regs));
+    sizes[i] = -1;
+  }
 
-  /* External HW */
-  if (system_hw == SYSTEM_MCD)
+  while (1)
   {
-    /* CD hardware ID flag */
-    char id[5];
-    strncpy(id,"SCD!",4);
-    save_param(id, 4);
+    /* section header */
+    load_param(tag, 4);
+    load_param(&size, 4);
 
-    /* CD hardware */
-    bufferptr += scd_context_save(&state[bufferptr]);
+    if (!memcmp(tag, state_end, 4))
+    {
+      return;
+    }
+
+    for (i=0; i<SECTION_MAX; i++)
+    {
+      if (!memcmp(tag, state_sections[i].tag, 4))
+      {
+        sizes[i] = size;
+        break;
+      }
+    }
+
+    bufferptr += size;
   }
-  else if ((system_hw & SYSTEM_PBC) == SYSTEM_MD)
+}
+
+/* Check hardware sections have the same size as the ones saved by current hardware */
+static int state_check_hardware(unsigned char *state)
+{
+  int i, sizes[SECTION_MAX], current_sizes[SECTION_MAX];
+  unsigned char *current = malloc(STATE_SIZE);
+
+  if (!current)
   {
-    /* MD cartridge hardware */
-    bufferptr += md_cart_context_save(&state[bufferptr]);
+    return 0;
+  }
+
+  state_save_sections(current);
+  state_section_sizes(current, current_sizes);
+  state_section_sizes(state, sizes);
+  free(current);
+
+  for (i=0; i<SECTION_MAX; i++)
+  {
+    if (sizes[i] != current_sizes[i])
+    {
+      return 0;
+    }
+  }
+
+  return 1;
+}
+
+int state_load(unsigned char *state, int length)
+{
+  int i, size, loaded = 0, bufferptr = 0;
+  char tag[4];
+
+  /* signature check (GENPLUS-GX x.x.x) */
+  char version[17];
+  if (length < 16)
+  {
+    return 0;
+  }
+  load_param(version,16);
+  version[16] = 0;
+
+  if (state_delta)
+  {
+    /* incremental savestates are applied over current state */
+    if (memcmp(version,STATE_DELTA_ID,16))
+    {
+      return 0;
+    }
   }
   else
   {
-    /* MS cartridge hardware */
-    bufferptr += sms_cart_context_save(&state[bufferptr]);
+    if (memcmp(version,STATE_VERSION,11))
+    {
+      return 0;
+    }
+
+    /* version check */
+    if ((version[11] < 0x31) || (version[13] < 0x37) || (version[15] < 0x36))
+    {
+      return 0;
+    }
+  }
+
+  /* corrupted savestates are rejected before current state is modified */
+  if (!state_check_sections(state, length))
+  {
+    return 0;
   }
 
+  if (!state_delta)
+  {
+    /* savestates from other hardware are rejected before current state is reset */
+    if (!state_check_hardware(state))
+    {
+      return 0;
+    }
+
+    /* reset system */
+    if (state_inplace)
+    {
+      system_restore();
+    }
+    else
+    {
+      system_reset();
+    }
+  }
+
+  /* enable VDP access for TMSS systems */
+  for (i=0xc0; i<0xe0; i+=8)
+  {
+    m68k.memory_map[i].read8    = vdp_read_byte;
+    m68k.memory_map[i].read16   = vdp_read_word;
+    m68k.memory_map[i].write8   = vdp_write_byte;
+    m68k.memory_map[i].write16  = vdp_write_word;
+    zbank_memory_map[i].read    = zbank_read_vdp;
+    zbank_memory_map[i].write   = zbank_write_vdp;
+  }
+
+  while (1)
+  {
+    /* section header */
+    load_param(tag, 4);
+    load_param(&size, 4);
+
+    if (!memcmp(tag, state_end, 4))
+    {
+      break;
+    }
+
+    for (i=0; i<SECTION_MAX; i++)
+    {
+      if (!memcmp(tag, state_sections[i].tag, 4))
+      {
+        break;
+      }
+    }
+
+    /* unknown sections are skipped */
+    if (i < SECTION_MAX)
+    {
+      /* section should match current hardware */
+      if (!state_section_used(i) || (state_sections[i].load(&state[bufferptr]) != size))
+      {
+        return 0;
+      }
+
+      loaded |= (1 << i);
+    }
+
+    bufferptr += size;
+  }
+
+  /* check all sections needed by current hardware were loaded */
+  for (i=0; i<SECTION_MAX; i++)
+  {
+    if (state_section_used(i) && !(loaded & (1 << i)))
+    {
+      return 0;
+    }
+  }
+
+  /* loaded state is the new reference for incremental savestates */
+  memset(state_dirty, 0, sizeof(state_dirty));
+
+  return bufferptr;
+}
+
+static int state_save_sections(unsigned char *state)
+{
+  int i, size, bufferptr = 0;
+
+  /* version string (not null-terminated) */
+  save_param(state_delta ? STATE_DELTA_ID : STATE_VERSION, 16);
+
+  /* hardware sections */
+  for (i=0; i<SECTION_MAX; i++)
+  {
+    if (state_section_used(i))
+    {
+      save_param(state_sections[i].tag, 4);
+      size = state_sections[i].save(&state[bufferptr + 4]);
+      save_param(&size, 4);
+      bufferptr += size;
+    }
+  }
+
+  /* end of savestate */
+  size = 0;
+  save_param(state_end, 4);
+  save_param(&size, 4);
+
+  return bufferptr;
+}
+
+int state_save(unsigned char *state)
+{
+  int size = state_save_sections(state);
+
+  /* saved state is the new reference for incremental savestates */
+  memset(state_dirty, 0, sizeof(state_dirty));
+
   /* return total size */
+  return size;
+}
+
+/* Exact savestate size for current hardware (at most STATE_SIZE) */
+int state_size(void)
+{
+  int size = STATE_SIZE;
+  unsigned char *state = malloc(STATE_SIZE);
+
+  if (state)
+  {
+    size = state_save_sections(state);
+    free(state);
+  }
+
+  return size;
+}
+
+/* Incremental savestates only include memory pages modified since last saved or loaded state.
+ * They must be loaded in the same order, starting from the full savestate they are based on.
+ */
+int state_load_delta(unsigned char *state, int length)
+{
+  int size;
+  state_delta = 1;
+  size = state_load(state, length);
+  state_delta = 0;
+  return size;
+}
+
+int state_save_delta(unsigned char *state)
+{
+  int size;
+  state_delta = 1;
+  size = state_save(state);
+  state_delta = 0;
+  return size;
+}
+
+/* Same as state_load() but emulated hardware is not reset (memory maps & Z80 bank handlers are rebuilt from
+ * loaded registers), display bitmap is not cleared and pattern cache is only updated for modified VRAM patterns,
+ * for frequent restores of savestates made during current session (rewind, rollback).
+ */
+int state_restore(unsigned char *state, int length)
+{
+  int size;
+  state_inplace = 1;
+  size = state_load(state, length);
+  state_inplace = 0;
+  return size;
+}
+
+int state_load_pages(unsigned char *state, unsigned char *param, int size, int region)
+{
+  int i, bufferptr = 0;
+  unsigned char *flags;
+
+  if (!state_delta)
+  {
+    load_param(param, size);
+    return bufferptr;
+  }
+
+  /* page flags */
+  flags = &state[bufferptr];
+  bufferptr += size >> STATE_PAGE_SHIFT;
+
+  /* modified pages */
+  for (i=0; i<(size >> STATE_PAGE_SHIFT); i++)
+  {
+    if (flags[i])
+    {
+      load_param(param + (i << STATE_PAGE_SHIFT), STATE_PAGE_SIZE);
+    }
+  }
+
   return bufferptr;
 }
+
+int state_save_pages(unsigned char *state, unsigned char *param, int size, int region)
+{
+  int i, bufferptr = 0;
+
+  if (!state_delta)
+  {
+    save_param(param, size);
+    return bufferptr;
+  }
+
+  /* page flags */
+  save_param(&state_dirty[region], size >> STATE_PAGE_SHIFT);
+
+  /* modified pages */
+  for (i=0; i<(size >> STATE_PAGE_SHIFT); i++)
+  {
+    if (state_dirty[region + i])
+    {
+      save_param(param + (i << STATE_PAGE_SHIFT), STATE_PAGE_SIZE);
+    }
+  }
+
+  return bufferptr;
+}
+
+/* Memory directly accessed through CPU memory maps */
+void state_mark_dirty(unsigned char *ptr)
+{
+  unsigned long offset = (unsigned long)(ptr - work_ram);
+
+  if (offset < sizeof(work_ram))
+  {
+    MARK_DIRTY(DIRTY_WORK_RAM, offset);
+    return;
+  }
+
+  if (system_hw == SYSTEM_MCD)
+  {
+    offset = (unsigned long)(ptr - scd.prg_ram);
+    if (offset < sizeof(scd.prg_ram))
+    {
+      MARK_DIRTY(DIRTY_PRG_RAM, offset);
+      return;
+    }
+
+    offset = (unsigned long)(ptr - scd.word_ram[0]);
+    if (offset < sizeof(scd.word_ram))
+    {
+      MARK_DIRTY(DIRTY_WORD_RAM, offset);
+      return;
+    }
+
+    offset = (unsigned long)(ptr - scd.word_ram_2M);
+    if (offset < sizeof(scd.word_ram_2M))
+    {
+      MARK_DIRTY(DIRTY_WORD_RAM_2M, offset);
+    }
+  }
+}
+
+/* Hardware reset */
+void state_mark_all(void)
+{
+  memset(state_dirty, 1, sizeof(state_dirty));
+}
@@ -39,8 +39,12 @@
 #ifndef _STATE_H_
 #define _STATE_H_
 
+/* Savestates are made of tagged sections (4-char tag, 32-bit length, data),
+   only hardware sections used by current system are saved. STATE_SIZE is the
+   maximal savestate size, use state_size() to get the exact size. */
 #define STATE_SIZE    0xfd000
-#define STATE_VERSION "GENPLUS-GX 1.7.5"
+#define STATE_VERSION "GENPLUS-GX 1.7.6"
+#define STATE_DELTA_ID "GENPLUS-GX-DELTA"
 
 #define load_param(param, size) \
   memcpy(param, &state[bufferptr], size); \
@@ -50,8 +54,46 @@
   memcpy(&state[bufferptr], param, size); \
   bufferptr+= size;
 
+/* Large memory regions are tracked by pages for incremental savestates */
+#define STATE_PAGE_SHIFT 10
+#define STATE_PAGE_SIZE  (1 << STATE_PAGE_SHIFT)
+
+/* First page of each tracked memory region */
+#define DIRTY_WORK_RAM    0
+#define DIRTY_ZRAM        (DIRTY_WORK_RAM    + (0x10000 >> STATE_PAGE_SHIFT))
+#define DIRTY_VRAM        (DIRTY_ZRAM        + (0x02000 >> STATE_PAGE_SHIFT))
+#define DIRTY_PRG_RAM     (DIRTY_VRAM        + (0x10000 >> STATE_PAGE_SHIFT))
+#define DIRTY_WORD_RAM    (DIRTY_PRG_RAM     + (0x80000 >> STATE_PAGE_SHIFT))
+#define DIRTY_WORD_RAM_2M (DIRTY_WORD_RAM    + (0x40000 >> STATE_PAGE_SHIFT))
+#define DIRTY_PAGES       (DIRTY_WORD_RAM_2M + (0x40000 >> STATE_PAGE_SHIFT))
+
+/* Mark page(s) of a tracked memory region as modified (range must be page aligned) */
+#define MARK_DIRTY(region, offset) \
+  state_dirty[(region) + ((offset) >> STATE_PAGE_SHIFT)] = 1
+
+#define MARK_DIRTY_RANGE(region, offset, size) \
+  memset(&state_dirty[(region) + ((offset) >> STATE_PAGE_SHIFT)], 1, (size) >> STATE_PAGE_SHIFT)
+
+/* Save or load a tracked memory region (only modified pages in incremental savestates) */
+#define load_pages(param, size, region) \
+  bufferptr += state_load_pages(&state[bufferptr], param, size, region);
+
+#define save_pages(param, size, region) \
+  bufferptr += state_save_pages(&state[bufferptr], param, size, region);
+
+/* Global variables */
+extern THREAD_CONTEXT unsigned char state_dirty[DIRTY_PAGES];
+
 /* Function prototypes */
-extern int state_load(unsigned char *state);
+extern int state_load(unsigned char *state, int length);
 extern int state_save(unsigned char *state);
+extern int state_size(void);
+extern int state_load_delta(unsigned char *state, int length);
+extern int state_save_delta(unsigned char *state);
+extern int state_restore(unsigned char *state, int length);
+extern int state_load_pages(unsigned char *state, unsigned char *param, int size, int region);
+extern int state_save_pages(unsigned char *state, unsigned char *param, int size, int region);
+extern void state_mark_dirty(unsigned char *ptr);
+extern void state_mark_all(void);
 
 #endif
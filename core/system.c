@@ -43,17 +43,29 @@
 #include "eq.h"
 
 /* Global variables */
-t_bitmap bitmap;
-t_snd snd;
-uint32 mcycles_vdp;
-uint8 system_hw;
-uint8 system_bios;
-uint32 system_clock;
-int16 SVP_cycles = 800; 
-
-static uint8 pause_b;
-static EQSTATE eq;
-static int16 llp,rrp;
+THREAD_CONTEXT t_bitmap bitmap;
+THREAD_CONTEXT t_snd snd;
+THREAD_CONTEXT uint32 mcycles_vdp;
+THREAD_CONTEXT uint8 system_hw;
+THREAD_CONTEXT uint8 system_bios;
+THREAD_CONTEXT uint32 system_clock;
+THREAD_CONTEXT int16 SVP_cycles = 800;
+THREAD_CONTEXT uint8 pause_b;
+
+static THREAD_CONTEXT EQSTATE eq;
+static THREAD_CONTEXT int16 llp,rrp;
+
+/* Audio output state saved while muted */
+static THREAD_CONTEXT struct
+{
+  int muted;
+  int size;
+  blip_t* blips[3][2];
+  EQSTATE eq;
+  int16 llp,rrp;
+  int fm_last[2];
+  int16 cdda_last[2];
+} mute;
 
 /******************************************************************************************/
 /* Audio subsystem                                                                        */
@@ -67,6 +79,9 @@ int audio_init(int samplerate, double framerate)
   /* Clear the sound data context */
   memset(&snd, 0, sizeof (snd));
 
+  /* Blip Buffers size (also used for muted output copies) */
+  mute.size = samplerate / 10;
+
   /* Initialize Blip Buffers */
   snd.blips[0][0] = blip_new(samplerate / 10);
   snd.blips[0][1] = blip_new(samplerate / 10);
@@ -189,6 +204,9 @@ void audio_shutdown(void)
 {
   int i,j;
   
+  /* Restore audio output */
+  audio_mute(0);
+
   /* Delete blip buffers */
   for (i=0; i<3; i++)
   {
@@ -196,8 +214,87 @@ void audio_shutdown(void)
     {
       blip_delete(snd.blips[i][j]);
       snd.blips[i][j] = 0;
+      blip_delete(mute.blips[i][j]);
+      mute.blips[i][j] = 0;
+    }
+  }
+}
+
+/* Emulated sound hardware keeps running while audio output is muted, but resampling and */
+/* filtering state is left unchanged, so that audio output continues seamlessly once it */
+/* is unmuted, even if a previous savestate was loaded in between (run-ahead).           */
+int audio_mute(int muted)
+{
+  int i,j;
+
+  if (muted == mute.muted)
+  {
+    return 1;
+  }
+
+  if (muted)
+  {
+    /* muted output goes to a copy of blip buffers */
+    for (i=0; i<3; i++)
+    {
+      for (j=0; j<2; j++)
+      {
+        if (snd.blips[i][j])
+        {
+          if (!mute.blips[i][j])
+          {
+            mute.blips[i][j] = blip_new(mute.size);
+            if (!mute.blips[i][j])
+            {
+              return 0;
+            }
+          }
+          blip_copy(mute.blips[i][j], snd.blips[i][j]);
+        }
+      }
+    }
+
+    /* save output state */
+    mute.eq = eq;
+    mute.llp = llp;
+    mute.rrp = rrp;
+    sound_get_output(mute.fm_last);
+    if (system_hw == SYSTEM_MCD)
+    {
+      mute.cdda_last[0] = cdd.audio[0];
+      mute.cdda_last[1] = cdd.audio[1];
     }
   }
+  else
+  {
+    /* restore output state */
+    eq = mute.eq;
+    llp = mute.llp;
+    rrp = mute.rrp;
+    sound_set_output(mute.fm_last);
+    if (system_hw == SYSTEM_MCD)
+    {
+      cdd.audio[0] = mute.cdda_last[0];
+      cdd.audio[1] = mute.cdda_last[1];
+    }
+  }
+
+  /* swap blip buffers */
+  for (i=0; i<3; i++)
+  {
+    for (j=0; j<2; j++)
+    {
+      if (snd.blips[i][j])
+      {
+        blip_t* temp = snd.blips[i][j];
+        snd.blips[i][j] = mute.blips[i][j];
+        mute.blips[i][j] = temp;
+      }
+    }
+  }
+
+  mute.muted = muted;
+  return 1;
 }
 
 int audio_update(int16 *buffer)
@@ -220,13 +317,31 @@ int audio_update(int16 *buffer)
   size &= ALIGN_SND;
 #endif
 
+  /* sound output is disabled */
+  if (!snd.enabled)
+  {
+    int i, j;
+
+    /* discard samples (output buffer is not modified) */
+    for (i=0; i<3; i++)
+    {
+      for (j=0; j<2; j++)
+      {
+        if (snd.blips[i][j])
+        {
+          blip_discard_samples(snd.blips[i][j], size);
+        }
+      }
+    }
+
+    return size;
+  }
+
   /* resample FM & PSG mixed stream to output buffer */
 #ifdef LSB_FIRST
-  blip_read_samples(snd.blips[0][0], buffer, size);
-  blip_read_samples(snd.blips[0][1], buffer + 1, size);
+  blip_read_samples_stereo(snd.blips[0][0], snd.blips[0][1], buffer, size);
 #else
-  blip_read_samples(snd.blips[0][0], buffer + 1, size);
-  blip_read_samples(snd.blips[0][1], buffer, size);
+  blip_read_samples_stereo(snd.blips[0][1], snd.blips[0][0], buffer, size);
 #endif
 
   /* Mega CD specific */
@@ -234,15 +349,11 @@ int audio_update(int16 *buffer)
   {
     /* resample PCM & CD-DA streams to output buffer */
 #ifdef LSB_FIRST
-    blip_mix_samples(snd.blips[1][0], buffer, size);
-    blip_mix_samples(snd.blips[1][1], buffer + 1, size);
-    blip_mix_samples(snd.blips[2][0], buffer, size);
-    blip_mix_samples(snd.blips[2][1], buffer + 1, size);
+    blip_mix_samples_stereo(snd.blips[1][0], snd.blips[1][1], buffer, size);
+    blip_mix_samples_stereo(snd.blips[2][0], snd.blips[2][1], buffer, size);
 #else
-    blip_mix_samples(snd.blips[1][0], buffer + 1, size);
-    blip_mix_samples(snd.blips[1][1], buffer, size);
-    blip_mix_samples(snd.blips[2][0], buffer + 1, size);
-    blip_mix_samples(snd.blips[2][1], buffer, size);
+    blip_mix_samples_stereo(snd.blips[1][1], snd.blips[1][0], buffer, size);
+    blip_mix_samples_stereo(snd.blips[2][1], snd.blips[2][0], buffer, size);
 #endif
   }
 
@@ -348,6 +459,44 @@ void system_reset(void)
   audio_reset();
 }
 
+/* Same as system_reset() but only state not included in savestates is reinitialized: chips are not reset */
+/* and display bitmap, VRAM & pattern cache are kept (see state_restore) */
+void system_restore(void)
+{
+  gen_restore();
+  input_reset();
+  render_restore();
+  vdp_restore();
+  sound_restore();
+
+  /* CD hardware state not included in savestates is reinitialized as with scd_reset() */
+  if (system_hw == SYSTEM_MCD)
+  {
+    /* clear CPU polling detection */
+    memset(&m68k.poll, 0, sizeof(m68k.poll));
+    memset(&s68k.poll, 0, sizeof(s68k.poll));
+
+    /* reset PCM master clocks counter */
+    scd.pcm_hw.cycles = 0;
+
+    /* clear CD hardware audio output */
+    cdd.audio[0] = cdd.audio[1] = 0;
+  }
+
+  audio_reset();
+}
+
+void system_shutdown(void)
+{
+  /* close any opened CD image */
+  if (system_hw == SYSTEM_MCD)
+  {
+    cdd_unload();
+  }
+
+  gen_shutdown();
+}
+
 void system_frame_gen(int do_skip)
 {
   /* line counters */
@@ -363,6 +512,9 @@ void system_frame_gen(int do_skip)
   fifo_write_cnt = 0;
   fifo_slots = 0;
 
+  /* skipped frames only update VDP status flags */
+  render_skip = do_skip;
+
   /* check if display setings have changed during previous frame */
   if (bitmap.viewport.changed & 2)
   {
@@ -657,10 +809,7 @@ void system_frame_gen(int do_skip)
     }
 
     /* render scanline */
-    if (!do_skip)
-    {
-      render_line(line);
-    }
+    render_line_async(line);
 
     /* update 6-Buttons & Lightguns */
     input_refresh();
@@ -707,6 +856,9 @@ void system_frame_gen(int do_skip)
   }
   while (++line < bitmap.viewport.h);
 
+  /* wait for last lines to be rendered */
+  render_sync();
+
   /* check viewport changes */
   if (bitmap.viewport.w != bitmap.viewport.ow)
   {
@@ -735,6 +887,9 @@ void system_frame_scd(int do_skip)
   fifo_write_cnt = 0;
   fifo_slots = 0;
 
+  /* skipped frames only update VDP status flags */
+  render_skip = do_skip;
+
   /* check if display setings have changed during previous frame */
   if (bitmap.viewport.changed & 2)
   {
@@ -1017,10 +1172,7 @@ void system_frame_scd(int do_skip)
     }
 
     /* render scanline */
-    if (!do_skip)
-    {
-      render_line(line);
-    }
+    render_line_async(line);
     
     /* update 6-Buttons & Lightguns */
     input_refresh();
@@ -1063,6 +1215,9 @@ void system_frame_scd(int do_skip)
   }
   while (++line < bitmap.viewport.h);
 
+  /* wait for last lines to be rendered */
+  render_sync();
+
   /* check viewport changes */
   if (bitmap.viewport.w != bitmap.viewport.ow)
   {
@@ -1090,6 +1245,9 @@ void system_frame_sms(int do_skip)
   fifo_write_cnt = 0;
   fifo_slots = 0;
 
+  /* skipped frames only update VDP status flags */
+  render_skip = do_skip;
+
   /* check if display settings has changed during previous frame */
   if (bitmap.viewport.changed & 2)
   {
@@ -1293,8 +1451,22 @@ void system_frame_sms(int do_skip)
     /* Master System & Game Gear VDP specific */
     if ((system_hw < SYSTEM_MD) && (line > (lines_per_frame - 16)))
     {
+      /* Update pattern cache (Mode 4 sprites, VRAM may have been modified during vertical blanking) */
+      if (bg_list_index && (parse_satb == parse_satb_m4))
+      {
+        update_bg_pattern_cache(bg_list_index);
+        bg_list_index = 0;
+      }
+
       /* Sprites are still processed during top border */
-      render_obj((line - lines_per_frame) & 1);
+      if (do_skip)
+      {
+        render_obj_status((line - lines_per_frame) & 1);
+      }
+      else
+      {
+        render_obj((line - lines_per_frame) & 1);
+      }
       parse_satb(line - lines_per_frame);
     }
 
@@ -1348,6 +1520,7 @@ void system_frame_sms(int do_skip)
 
   /* 3-D glasses faking: skip rendering of left lens frame */
   do_skip |= (work_ram[0x1ffb] & cart.special & HW_3D_GLASSES);
+  render_skip = do_skip;
 
   /* Mega Drive VDP specific */
   if (system_hw & SYSTEM_MD)
@@ -1374,7 +1547,14 @@ void system_frame_sms(int do_skip)
     /* Sprites are still processed during vertical borders */
     if (reg[1] & 0x40)
     {
-      render_obj(1);
+      if (do_skip)
+      {
+        render_obj_status(1);
+      }
+      else
+      {
+        render_obj(1);
+      }
     }
     
     /* Sprites pre-processing occurs even when display is disabled */
@@ -1412,10 +1592,7 @@ void system_frame_sms(int do_skip)
       v_counter = line;
 
       /* render scanline */
-      if (!do_skip)
-      {
-        render_line(line);
-      }
+      render_line(line);
     }
 
     /* update 6-Buttons & Lightguns */
@@ -90,19 +90,20 @@ typedef struct
 {
   int sample_rate;      /* Output Sample rate (8000-48000) */
   double frame_rate;    /* Output Frame rate (usually 50 or 60 frames per second) */
-  int enabled;          /* 1= sound emulation is enabled */
+  int enabled;          /* 1= sound output is enabled (0= sound chips are emulated without generating samples) */
   blip_t* blips[3][2];  /* Blip Buffer resampling */
 } t_snd;
 
 
 /* Global variables */
-extern t_bitmap bitmap;
-extern t_snd snd;
-extern uint32 mcycles_vdp;
-extern int16 SVP_cycles; 
-extern uint8 system_hw;
-extern uint8 system_bios;
-extern uint32 system_clock;
+extern THREAD_CONTEXT t_bitmap bitmap;
+extern THREAD_CONTEXT t_snd snd;
+extern THREAD_CONTEXT uint32 mcycles_vdp;
+extern THREAD_CONTEXT int16 SVP_cycles;
+extern THREAD_CONTEXT uint8 system_hw;
+extern THREAD_CONTEXT uint8 system_bios;
+extern THREAD_CONTEXT uint32 system_clock;
+extern THREAD_CONTEXT uint8 pause_b;
 
 /* Function prototypes */
 extern int audio_init(int samplerate, double framerate);
@@ -110,9 +111,12 @@ extern void audio_set_rate(int samplerate, double framerate);
 extern void audio_reset(void);
 extern void audio_shutdown(void);
 extern int audio_update(int16 *buffer);
+extern int audio_mute(int muted);
 extern void audio_set_equalizer(void);
 extern void system_init(void);
 extern void system_reset(void);
+extern void system_restore(void);
+extern void system_shutdown(void);
 extern void system_frame_gen(int do_skip);
 extern void system_frame_scd(int do_skip);
 extern void system_frame_sms(int do_skip);
@@ -42,7 +42,7 @@
 #include "shared.h"
 #include "hvc.h"
 
-/* Mark a pattern as modified */
+/* Mark a pattern (and VRAM page) as modified */
 #define MARK_BG_DIRTY(addr)                         \
 {                                                   \
   name = (addr >> 5) & 0x7FF;                       \
@@ -51,52 +51,53 @@
     bg_name_list[bg_list_index++] = name;           \
   }                                                 \
   bg_name_dirty[name] |= (1 << ((addr >> 2) & 7));  \
+  MARK_DIRTY(DIRTY_VRAM, addr);                     \
 }
 
 /* VDP context */
-uint8 sat[0x400];     /* Internal copy of sprite attribute table */
-uint8 vram[0x10000];  /* Video RAM (64K x 8-bit) */
-uint8 cram[0x80];     /* On-chip color RAM (64 x 9-bit) */
-uint8 vsram[0x80];    /* On-chip vertical scroll RAM (40 x 11-bit) */
-uint8 reg[0x20];      /* Internal VDP registers (23 x 8-bit) */
-uint8 hint_pending;   /* 0= Line interrupt is pending */
-uint8 vint_pending;   /* 1= Frame interrupt is pending */
-uint16 status;        /* VDP status flags */
-uint32 dma_length;    /* DMA remaining length */
+THREAD_CONTEXT uint8 sat[0x400];     /* Internal copy of sprite attribute table */
+THREAD_CONTEXT uint8 vram[0x10000];  /* Video RAM (64K x 8-bit) */
+THREAD_CONTEXT uint8 cram[0x80];     /* On-chip color RAM (64 x 9-bit) */
+THREAD_CONTEXT uint8 vsram[0x80];    /* On-chip vertical scroll RAM (40 x 11-bit) */
+THREAD_CONTEXT uint8 reg[0x20];      /* Internal VDP registers (23 x 8-bit) */
+THREAD_CONTEXT uint8 hint_pending;   /* 0= Line interrupt is pending */
+THREAD_CONTEXT uint8 vint_pending;   /* 1= Frame interrupt is pending */
+THREAD_CONTEXT uint16 status;        /* VDP status flags */
+THREAD_CONTEXT uint32 dma_length;    /* DMA remaining length */
 
 /* Global variables */
-uint16 ntab;                      /* Name table A base address */
-uint16 ntbb;                      /* Name table B base address */
-uint16 ntwb;                      /* Name table W base address */
-uint16 satb;                      /* Sprite attribute table base address */
-uint16 hscb;                      /* Horizontal scroll table base address */
-uint8 bg_name_dirty[0x800];       /* 1= This pattern is dirty */
-uint16 bg_name_list[0x800];       /* List of modified pattern indices */
-uint16 bg_list_index;             /* # of modified patterns in list */
-uint8 hscroll_mask;               /* Horizontal Scrolling line mask */
-uint8 playfield_shift;            /* Width of planes A, B (in bits) */
-uint8 playfield_col_mask;         /* Playfield column mask */
-uint16 playfield_row_mask;        /* Playfield row mask */
-uint16 vscroll;                   /* Latched vertical scroll value */
-uint8 odd_frame;                  /* 1: odd field, 0: even field */
-uint8 im2_flag;                   /* 1= Interlace mode 2 is being used */
-uint8 interlaced;                 /* 1: Interlaced mode 1 or 2 */
-uint8 vdp_pal;                    /* 1: PAL , 0: NTSC (default) */
-uint8 h_counter;                  /* Horizontal counter */
-uint16 v_counter;                 /* Vertical counter */
-uint16 vc_max;                    /* Vertical counter overflow value */
-uint16 lines_per_frame;           /* PAL: 313 lines, NTSC: 262 lines */
-uint16 max_sprite_pixels;         /* Max. sprites pixels per line (parsing & rendering) */
-int32 fifo_write_cnt;             /* VDP FIFO write count */
-uint32 fifo_slots;                /* VDP FIFO access slot count */
-uint32 hvc_latch;                 /* latched HV counter */
-const uint8 *hctab;               /* pointer to H Counter table */
+THREAD_CONTEXT uint16 ntab;                      /* Name table A base address */
+THREAD_CONTEXT uint16 ntbb;                      /* Name table B base address */
+THREAD_CONTEXT uint16 ntwb;                      /* Name table W base address */
+THREAD_CONTEXT uint16 satb;                      /* Sprite attribute table base address */
+THREAD_CONTEXT uint16 hscb;                      /* Horizontal scroll table base address */
+THREAD_CONTEXT uint8 bg_name_dirty[0x800];       /* 1= This pattern is dirty */
+THREAD_CONTEXT uint16 bg_name_list[0x800];       /* List of modified pattern indices */
+THREAD_CONTEXT uint16 bg_list_index;             /* # of modified patterns in list */
+THREAD_CONTEXT uint8 hscroll_mask;               /* Horizontal Scrolling line mask */
+THREAD_CONTEXT uint8 playfield_shift;            /* Width of planes A, B (in bits) */
+THREAD_CONTEXT uint8 playfield_col_mask;         /* Playfield column mask */
+THREAD_CONTEXT uint16 playfield_row_mask;        /* Playfield row mask */
+THREAD_CONTEXT uint16 vscroll;                   /* Latched vertical scroll value */
+THREAD_CONTEXT uint8 odd_frame;                  /* 1: odd field, 0: even field */
+THREAD_CONTEXT uint8 im2_flag;                   /* 1= Interlace mode 2 is being used */
+THREAD_CONTEXT uint8 interlaced;                 /* 1: Interlaced mode 1 or 2 */
+THREAD_CONTEXT uint8 vdp_pal;                    /* 1: PAL , 0: NTSC (default) */
+THREAD_CONTEXT uint8 h_counter;                  /* Horizontal counter */
+THREAD_CONTEXT uint16 v_counter;                 /* Vertical counter */
+THREAD_CONTEXT uint16 vc_max;                    /* Vertical counter overflow value */
+THREAD_CONTEXT uint16 lines_per_frame;           /* PAL: 313 lines, NTSC: 262 lines */
+THREAD_CONTEXT uint16 max_sprite_pixels;         /* Max. sprites pixels per line (parsing & rendering) */
+THREAD_CONTEXT int32 fifo_write_cnt;             /* VDP FIFO write count */
+THREAD_CONTEXT uint32 fifo_slots;                /* VDP FIFO access slot count */
+THREAD_CONTEXT uint32 hvc_latch;                 /* latched HV counter */
+THREAD_CONTEXT const uint8 *hctab;               /* pointer to H Counter table */
 
 /* Function pointers */
-void (*vdp_68k_data_w)(unsigned int data);
-void (*vdp_z80_data_w)(unsigned int data);
-unsigned int (*vdp_68k_data_r)(void);
-unsigned int (*vdp_z80_data_r)(void);
+THREAD_CONTEXT void (*vdp_68k_data_w)(unsigned int data);
+THREAD_CONTEXT void (*vdp_z80_data_w)(unsigned int data);
+THREAD_CONTEXT unsigned int (*vdp_68k_data_r)(void);
+THREAD_CONTEXT unsigned int (*vdp_z80_data_r)(void);
 
 /* Function prototypes */
 static void vdp_68k_data_w_m4(unsigned int data);
@@ -125,26 +126,29 @@ static const uint8 shift_table[]        = { 6, 7, 0, 8 };
 static const uint8 col_mask_table[]     = { 0x0F, 0x1F, 0x0F, 0x3F };
 static const uint16 row_mask_table[]    = { 0x0FF, 0x1FF, 0x2FF, 0x3FF };
 
-static uint8 border;          /* Border color index */
-static uint8 pending;         /* Pending write flag */
-static uint8 code;            /* Code register */
-static uint8 dma_type;        /* DMA mode */
-static uint16 addr;           /* Address register */
-static uint16 addr_latch;     /* Latched A15, A14 of address */
-static uint16 sat_base_mask;  /* Base bits of SAT */
-static uint16 sat_addr_mask;  /* Index bits of SAT */
-static uint16 dma_src;        /* DMA source address */
-static uint32 dma_endCycles;  /* 68k cycles to DMA end */
-static int dmafill;           /* DMA Fill pending flag */
-static int cached_write;      /* 2nd part of 32-bit CTRL port write (Genesis mode) or LSB of CRAM data (Game Gear mode) */
-static uint16 fifo[4];        /* FIFO ring-buffer */
-static int fifo_idx;          /* FIFO write index */
-static int fifo_byte_access;  /* FIFO byte access flag */
-static uint32 fifo_cycles;    /* FIFO next access cycle */
+static THREAD_CONTEXT uint8 border;          /* Border color index */
+static THREAD_CONTEXT uint8 pending;         /* Pending write flag */
+static THREAD_CONTEXT uint8 code;            /* Code register */
+static THREAD_CONTEXT uint8 dma_type;        /* DMA mode */
+static THREAD_CONTEXT uint16 addr;           /* Address register */
+static THREAD_CONTEXT uint16 addr_latch;     /* Latched A15, A14 of address */
+static THREAD_CONTEXT uint16 sat_base_mask;  /* Base bits of SAT */
+static THREAD_CONTEXT uint16 sat_addr_mask;  /* Index bits of SAT */
+static THREAD_CONTEXT uint16 dma_src;        /* DMA source address */
+static THREAD_CONTEXT uint32 dma_endCycles;  /* 68k cycles to DMA end */
+static THREAD_CONTEXT int dmafill;           /* DMA Fill pending flag */
+static THREAD_CONTEXT int cached_write;      /* 2nd part of 32-bit CTRL port write (Genesis mode) or LSB of CRAM data (Game Gear mode) */
+static THREAD_CONTEXT uint16 fifo[4];        /* FIFO ring-buffer */
+static THREAD_CONTEXT int fifo_idx;          /* FIFO write index */
+static THREAD_CONTEXT int fifo_byte_access;  /* FIFO byte access flag */
+static THREAD_CONTEXT uint32 fifo_cycles;    /* FIFO next access cycle */
 
  /* set Z80 or 68k interrupt lines */
-static void (*set_irq_line)(unsigned int level);
-static void (*set_irq_line_delay)(unsigned int level);
+static THREAD_CONTEXT void (*set_irq_line)(unsigned int level);
+static THREAD_CONTEXT void (*set_irq_line_delay)(unsigned int level);
+
+/* pattern cache update function when pattern cache is kept by vdp_restore() */
+static THREAD_CONTEXT void (*bg_cache_update)(int index);
 
 /* Vertical counter overflow values (see hvc.h) */
 static const uint16 vc_table[4][2] = 
@@ -205,12 +209,11 @@ void vdp_init(void)
   }
 }
 
-void vdp_reset(void)
+static void vdp_reset_context(void)
 {
   int i;
 
   memset ((char *) sat, 0, sizeof (sat));
-  memset ((char *) vram, 0, sizeof (vram));
   memset ((char *) cram, 0, sizeof (cram));
   memset ((char *) vsram, 0, sizeof (vsram));
   memset ((char *) reg, 0, sizeof (reg));
@@ -399,12 +402,48 @@ void vdp_reset(void)
   color_update_m4(0x40, 0x00);
 }
 
+void vdp_reset(void)
+{
+  memset ((char *) vram, 0, sizeof (vram));
+  bg_cache_update = NULL;
+  vdp_reset_context();
+}
+
+/* Reset before an in-place savestate restore: VRAM and pattern cache are kept */
+void vdp_restore(void)
+{
+  render_sync();
+
+  /* pattern cache could be out of sync with VRAM in TMS modes */
+  if (parse_satb != parse_satb_tms)
+  {
+    /* apply pending pattern cache changes */
+    if (bg_list_index)
+    {
+      update_bg_pattern_cache(bg_list_index);
+      bg_list_index = 0;
+    }
+
+    /* pattern cache now matches VRAM */
+    bg_cache_update = update_bg_pattern_cache;
+  }
+  else
+  {
+    bg_cache_update = NULL;
+  }
+
+  vdp_reset_context();
+}
+
+/* Mode 4 & TMS99xx VDP only address 16KB of VRAM */
+#define VRAM_STATE_SIZE ((system_hw & SYSTEM_MD) ? sizeof(vram) : 0x4000)
+
 int vdp_context_save(uint8 *state)
 {
   int bufferptr = 0;
 
   save_param(sat, sizeof(sat));
-  save_param(vram, sizeof(vram));
+  save_pages(vram, VRAM_STATE_SIZE, DIRTY_VRAM);
   save_param(cram, sizeof(cram));
   save_param(vsram, sizeof(vsram));
   save_param(reg, sizeof(reg));
@@ -423,6 +462,10 @@ int vdp_context_save(uint8 *state)
   save_param(&dma_type, sizeof(dma_type));
   save_param(&dma_src, sizeof(dma_src));
   save_param(&cached_write, sizeof(cached_write));
+  save_param(&odd_frame, sizeof(odd_frame));
+  save_param(&im2_flag, sizeof(im2_flag));
+  save_param(&interlaced, sizeof(interlaced));
+  bufferptr += render_context_save(&state[bufferptr]);
   return bufferptr;
 }
 
@@ -430,9 +473,23 @@ int vdp_context_load(uint8 *state)
 {
   int i, bufferptr = 0;
   uint8 temp_reg[0x20];
+  uint8 modified[0x800];
+  void (*cache_update)(int index) = bg_cache_update;
+
+  bg_cache_update = NULL;
 
   load_param(sat, sizeof(sat));
-  load_param(vram, sizeof(vram));
+
+  /* modified patterns when restoring in place */
+  if (cache_update)
+  {
+    for (i=0; i<(VRAM_STATE_SIZE >> 5); i++)
+    {
+      modified[i] = memcmp(&vram[i << 5], &state[bufferptr + (i << 5)], 32) ? 0xFF : 0x00;
+    }
+  }
+
+  load_pages(vram, VRAM_STATE_SIZE, DIRTY_VRAM);
   load_param(cram, sizeof(cram));
   load_param(vsram, sizeof(vsram));
   load_param(temp_reg, sizeof(temp_reg));
@@ -451,6 +508,9 @@ int vdp_context_load(uint8 *state)
     }
     else
     {
+      /* VRAM was saved with current 4K/16K address decoding */
+      reg[1] = (reg[1] & 0x7F) | (temp_reg[1] & 0x80);
+
       for (i=0;i<0x08;i++) 
       {
         pending = 1;
@@ -482,6 +542,10 @@ int vdp_context_load(uint8 *state)
   load_param(&dma_type, sizeof(dma_type));
   load_param(&dma_src, sizeof(dma_src));
   load_param(&cached_write, sizeof(cached_write));
+  load_param(&odd_frame, sizeof(odd_frame));
+  load_param(&im2_flag, sizeof(im2_flag));
+  load_param(&interlaced, sizeof(interlaced));
+  bufferptr += render_context_load(&state[bufferptr]);
 
   /* restore FIFO byte access flag */
   fifo_byte_access = ((code & 0x0F) < 0x03);
@@ -497,6 +561,13 @@ int vdp_context_load(uint8 *state)
     /* Mode 5 */
     bg_list_index = 0x800;
 
+    /* interlaced mode 2 rendering (registers were restored before interlaced mode flags) */
+    if (im2_flag)
+    {
+      render_bg = (reg[11] & 0x04) ? render_bg_m5_im2_vs : render_bg_m5_im2;
+      render_obj = (reg[12] & 0x08) ? render_obj_m5_im2_ste : render_obj_m5_im2;
+    }
+
     /* reinitialize palette */
     color_update_m5(0, *(uint16 *)&cram[border << 1]);
     for(i = 1; i < 0x40; i++)
@@ -517,6 +588,22 @@ int vdp_context_load(uint8 *state)
     color_update_m4(0x40, *(uint16 *)&cram[(0x10 | (border & 0x0F)) << 1]);
   }
 
+  /* only invalidate modified patterns if pattern cache still matches previous VRAM content */
+  if (cache_update == update_bg_pattern_cache)
+  {
+    int count = 0;
+    for (i=0;i<bg_list_index;i++) 
+    {
+      bg_name_dirty[i] = modified[i];
+      if (modified[i])
+      {
+        bg_name_list[count++] = i;
+      }
+    }
+    bg_list_index = count;
+    return bufferptr;
+  }
+
   /* invalidate cache */
   for (i=0;i<bg_list_index;i++) 
   {
@@ -564,6 +651,11 @@ void vdp_dma_update(unsigned int cycles)
   */
   unsigned int rate = dma_timing[(status & 8) || !(reg[1] & 0x40)][reg[12] & 1];
 
+  /* DMA modifies VDP memory */
+  render_sync();
+
+  PROFILE_BEGIN(PROFILE_VDP_DMA_UPDATE);
+
   /* Adjust for 68k bus DMA to VRAM (one word = 2 access) or DMA Copy (one read + one write = 2 access) */
   rate = rate >> (dma_type & 1);
 
@@ -623,6 +715,7 @@ void vdp_dma_update(unsigned int cycles)
   {
     /* Update DMA length */
     dma_length -= dma_bytes;
+    PROFILE_COUNT(dma_words, dma_bytes);
 
     /* Process DMA operation */
     dma_func[reg[23] >> 4](dma_bytes);
@@ -646,6 +739,8 @@ void vdp_dma_update(unsigned int cycles)
       }
     }
   }
+
+  PROFILE_END(PROFILE_VDP_DMA_UPDATE);
 }
 
 
@@ -655,6 +750,11 @@ void vdp_dma_update(unsigned int cycles)
 
 void vdp_68k_ctrl_w(unsigned int data)
 {
+  PROFILE_COUNT(vdp_writes, 1);
+
+  /* wait for pending line rendering */
+  render_sync();
+
   /* Check pending flag */
   if (pending == 0)
   {
@@ -803,6 +903,11 @@ void vdp_68k_ctrl_w(unsigned int data)
 /* Mega Drive VDP control port specific (MS compatibility mode) */
 void vdp_z80_ctrl_w(unsigned int data)
 {
+  PROFILE_COUNT(vdp_writes, 1);
+
+  /* wait for pending line rendering */
+  render_sync();
+
   switch (pending)
   {
     case 0:
@@ -924,6 +1029,11 @@ void vdp_z80_ctrl_w(unsigned int data)
 /* Master System & Game Gear VDP control port specific */
 void vdp_sms_ctrl_w(unsigned int data)
 {
+  PROFILE_COUNT(vdp_writes, 1);
+
+  /* wait for pending line rendering */
+  render_sync();
+
   if (pending == 0)
   {
     /* Update address register LSB */
@@ -1102,6 +1212,11 @@ void vdp_sms_ctrl_w(unsigned int data)
 /* SG-1000 VDP (TMS99xx) control port specific */
 void vdp_tms_ctrl_w(unsigned int data)
 {
+  PROFILE_COUNT(vdp_writes, 1);
+
+  /* wait for pending line rendering */
+  render_sync();
+
   if (pending == 0)
   {
     /* Latch LSB */
@@ -1218,6 +1333,9 @@ unsigned int vdp_68k_ctrl_r(unsigned int cycles)
 {
   unsigned int temp;
 
+  /* sprite status flags are set by line rendering */
+  render_sync();
+
   /* Update FIFO status flags if not empty */
   if (fifo_write_cnt)
   {
@@ -1267,6 +1385,9 @@ unsigned int vdp_z80_ctrl_r(unsigned int cycles)
 {
   unsigned int temp;
 
+  /* sprite status flags are set by line rendering */
+  render_sync();
+
   /* Check if DMA busy flag is set (Mega Drive VDP specific) */
   if (status & 2)
   {
@@ -1438,6 +1559,63 @@ unsigned int vdp_hvc_r(unsigned int cycles)
   return (data);
 }
 
+/*--------------------------------------------------------------------------*/
+/* 68k idle loop skipping                                                   */
+/*--------------------------------------------------------------------------*/
+
+/* Cycle count until which VDP status returned by last 68k read remains unchanged */
+unsigned int vdp_68k_ctrl_until(unsigned int cycles, unsigned int data)
+{
+  unsigned int until;
+
+  /* FIFO flags being updated, DMA transfer in progress or sprite flags cleared by last read */
+  if (fifo_write_cnt || dma_length || (data & 0x60))
+  {
+    return cycles;
+  }
+
+  /* next HBLANK flag transition */
+  until = cycles - (cycles % MCYCLES_PER_LINE);
+  until += ((cycles - until) < 588) ? 588 : MCYCLES_PER_LINE;
+
+  /* DMA Busy flag is cleared once VRAM Fill or Copy is finished */
+  if ((status & 2) && (dma_endCycles < until))
+  {
+    until = dma_endCycles;
+  }
+
+  return until;
+}
+
+/* Cycle count until which VCounter (and HCounter if requested) returned by last 68k read remains unchanged */
+unsigned int vdp_hvc_until(unsigned int cycles, int hcounter)
+{
+  /* Mode 5: HV counters are frozen */
+  if (hvc_latch && (reg[1] & 0x04))
+  {
+    return 0xffffffff;
+  }
+
+  /* HCounter is only frozen in Mode 4 */
+  if (hcounter && !hvc_latch)
+  {
+    return cycles;
+  }
+
+  /* VCounter is incremented at the end of current line */
+  if (cycles < mcycles_vdp)
+  {
+    return mcycles_vdp;
+  }
+
+  if ((cycles - mcycles_vdp) < MCYCLES_PER_LINE)
+  {
+    return mcycles_vdp + MCYCLES_PER_LINE;
+  }
+
+  return 0xffffffff;
+}
+
 
 /*--------------------------------------------------------------------------*/
 /* Test registers                                                           */
@@ -1629,6 +1807,8 @@ static void vdp_reg_w(unsigned int r, unsigned int d, unsigned int cycles)
               *(uint16 *)(vram + ((i & 0x203F) | ((i >> 6) & 0x40) | ((i << 1) & 0x1F80))) = *(uint16 *)(vram + 0x4000 + i);
             }
           }
+
+          MARK_DIRTY_RANGE(DIRTY_VRAM, 0, 0x8000);
         }
       }
 
@@ -2297,6 +2477,11 @@ static void vdp_bus_w(unsigned int data)
 
 static void vdp_68k_data_w_m4(unsigned int data)
 {
+  PROFILE_COUNT(vdp_writes, 1);
+
+  /* wait for pending line rendering */
+  render_sync();
+
   /* Clear pending flag */
   pending = 0;
 
@@ -2389,6 +2574,11 @@ static void vdp_68k_data_w_m4(unsigned int data)
 
 static void vdp_68k_data_w_m5(unsigned int data)
 {
+  PROFILE_COUNT(vdp_writes, 1);
+
+  /* wait for pending line rendering */
+  render_sync();
+
   /* Clear pending flag */
   pending = 0;
 
@@ -2558,6 +2748,11 @@ static unsigned int vdp_68k_data_r_m5(void)
 
 static void vdp_z80_data_w_m4(unsigned int data)
 {
+  PROFILE_COUNT(vdp_writes, 1);
+
+  /* wait for pending line rendering */
+  render_sync();
+
   /* Clear pending flag */
   pending = 0;
 
@@ -2610,6 +2805,11 @@ static void vdp_z80_data_w_m4(unsigned int data)
 
 static void vdp_z80_data_w_m5(unsigned int data)
 {
+  PROFILE_COUNT(vdp_writes, 1);
+
+  /* wait for pending line rendering */
+  render_sync();
+
   /* Clear pending flag */
   pending = 0;
 
@@ -2794,6 +2994,11 @@ static unsigned int vdp_z80_data_r_m5(void)
 
 static void vdp_z80_data_w_ms(unsigned int data)
 {
+  PROFILE_COUNT(vdp_writes, 1);
+
+  /* wait for pending line rendering */
+  render_sync();
+
   /* Clear pending flag */
   pending = 0;
 
@@ -2870,6 +3075,11 @@ static void vdp_z80_data_w_ms(unsigned int data)
 
 static void vdp_z80_data_w_gg(unsigned int data)
 {
+  PROFILE_COUNT(vdp_writes, 1);
+
+  /* wait for pending line rendering */
+  render_sync();
+
   /* Clear pending flag */
   pending = 0;
 
@@ -2959,11 +3169,17 @@ static void vdp_z80_data_w_sg(unsigned int data)
   /* VRAM address */
   int index = addr & 0x3FFF;
 
+  PROFILE_COUNT(vdp_writes, 1);
+
+  /* wait for pending line rendering */
+  render_sync();
+
   /* Clear pending flag */
   pending = 0;
 
   /* VRAM write */
   vram[index] = data;
+  MARK_DIRTY(DIRTY_VRAM, index);
 
   /* Update address register */
   addr++;
@@ -43,53 +43,54 @@
 #define _VDP_H_
 
 /* VDP context */
-extern uint8 reg[0x20];
-extern uint8 sat[0x400];
-extern uint8 vram[0x10000];
-extern uint8 cram[0x80];
-extern uint8 vsram[0x80];
-extern uint8 hint_pending;
-extern uint8 vint_pending;
-extern uint16 status;
-extern uint32 dma_length;
+extern THREAD_CONTEXT uint8 reg[0x20];
+extern THREAD_CONTEXT uint8 sat[0x400];
+extern THREAD_CONTEXT uint8 vram[0x10000];
+extern THREAD_CONTEXT uint8 cram[0x80];
+extern THREAD_CONTEXT uint8 vsram[0x80];
+extern THREAD_CONTEXT uint8 hint_pending;
+extern THREAD_CONTEXT uint8 vint_pending;
+extern THREAD_CONTEXT uint16 status;
+extern THREAD_CONTEXT uint32 dma_length;
 
 /* Global variables */
-extern uint16 ntab;
-extern uint16 ntbb;
-extern uint16 ntwb;
-extern uint16 satb;
-extern uint16 hscb;
-extern uint8 bg_name_dirty[0x800];
-extern uint16 bg_name_list[0x800];
-extern uint16 bg_list_index;
-extern uint8 hscroll_mask;
-extern uint8 playfield_shift;
-extern uint8 playfield_col_mask;
-extern uint16 playfield_row_mask;
-extern uint8 odd_frame;
-extern uint8 im2_flag;
-extern uint8 interlaced;
-extern uint8 vdp_pal;
-extern uint8 h_counter;
-extern uint16 v_counter;
-extern uint16 vc_max;
-extern uint16 vscroll;
-extern uint16 lines_per_frame;
-extern uint16 max_sprite_pixels;
-extern int32 fifo_write_cnt;
-extern uint32 fifo_slots;
-extern uint32 hvc_latch;
-extern const uint8 *hctab;
+extern THREAD_CONTEXT uint16 ntab;
+extern THREAD_CONTEXT uint16 ntbb;
+extern THREAD_CONTEXT uint16 ntwb;
+extern THREAD_CONTEXT uint16 satb;
+extern THREAD_CONTEXT uint16 hscb;
+extern THREAD_CONTEXT uint8 bg_name_dirty[0x800];
+extern THREAD_CONTEXT uint16 bg_name_list[0x800];
+extern THREAD_CONTEXT uint16 bg_list_index;
+extern THREAD_CONTEXT uint8 hscroll_mask;
+extern THREAD_CONTEXT uint8 playfield_shift;
+extern THREAD_CONTEXT uint8 playfield_col_mask;
+extern THREAD_CONTEXT uint16 playfield_row_mask;
+extern THREAD_CONTEXT uint8 odd_frame;
+extern THREAD_CONTEXT uint8 im2_flag;
+extern THREAD_CONTEXT uint8 interlaced;
+extern THREAD_CONTEXT uint8 vdp_pal;
+extern THREAD_CONTEXT uint8 h_counter;
+extern THREAD_CONTEXT uint16 v_counter;
+extern THREAD_CONTEXT uint16 vc_max;
+extern THREAD_CONTEXT uint16 vscroll;
+extern THREAD_CONTEXT uint16 lines_per_frame;
+extern THREAD_CONTEXT uint16 max_sprite_pixels;
+extern THREAD_CONTEXT int32 fifo_write_cnt;
+extern THREAD_CONTEXT uint32 fifo_slots;
+extern THREAD_CONTEXT uint32 hvc_latch;
+extern THREAD_CONTEXT const uint8 *hctab;
 
 /* Function pointers */
-extern void (*vdp_68k_data_w)(unsigned int data);
-extern void (*vdp_z80_data_w)(unsigned int data);
-extern unsigned int (*vdp_68k_data_r)(void);
-extern unsigned int (*vdp_z80_data_r)(void);
+extern THREAD_CONTEXT void (*vdp_68k_data_w)(unsigned int data);
+extern THREAD_CONTEXT void (*vdp_z80_data_w)(unsigned int data);
+extern THREAD_CONTEXT unsigned int (*vdp_68k_data_r)(void);
+extern THREAD_CONTEXT unsigned int (*vdp_z80_data_r)(void);
 
 /* Function prototypes */
 extern void vdp_init(void);
 extern void vdp_reset(void);
+extern void vdp_restore(void);
 extern int vdp_context_save(uint8 *state);
 extern int vdp_context_load(uint8 *state);
 extern void vdp_dma_update(unsigned int cycles);
@@ -100,6 +101,8 @@ extern void vdp_tms_ctrl_w(unsigned int data);
 extern unsigned int vdp_68k_ctrl_r(unsigned int cycles);
 extern unsigned int vdp_z80_ctrl_r(unsigned int cycles);
 extern unsigned int vdp_hvc_r(unsigned int cycles);
+extern unsigned int vdp_68k_ctrl_until(unsigned int cycles, unsigned int data);
+extern unsigned int vdp_hvc_until(unsigned int cycles, int hcounter);
 extern void vdp_test_w(unsigned int data);
 extern int vdp_68k_irq_ack(int int_level);
 
@@ -43,6 +43,15 @@
 #include "md_ntsc.h"
 #include "sms_ntsc.h"
 
+#ifdef USE_RENDER_THREAD
+#ifdef USE_THREAD_CONTEXT
+#error "USE_RENDER_THREAD cannot be used with USE_THREAD_CONTEXT"
+#endif
+#include <pthread.h>
+#include <sched.h>
+#include <unistd.h>
+#endif
+
 /*** NTSC Filters ***/
 extern md_ntsc_t *md_ntsc;
 extern sms_ntsc_t *sms_ntsc;
@@ -58,6 +67,12 @@ extern sms_ntsc_t *sms_ntsc;
 #endif
 
 
+/* x86 SIMD pixel functions (define NO_SIMD_RENDER in the makefile to disable them) */
+#if !defined(NO_SIMD_RENDER) && (defined(__x86_64__) || defined(__i386__)) && (defined(__clang__) || (__GNUC__ >= 5))
+#define SIMD_RENDER
+#include <immintrin.h>
+#endif
+
 /* Pixel priority look-up tables information */
 #define LUT_MAX     (6)
 #define LUT_SIZE    (0x10000)
@@ -417,7 +432,7 @@ INLINE void WRITE_LONG(void *address, uint32 data)
     { \
       temp |= (lb[i] << 8); \
       lb[i] = TABLE[temp | ATTR]; \
-      status |= ((temp & 0x8000) >> 10); \
+      SPRITE_STATUS |= ((temp & 0x8000) >> 10); \
     } \
   }
 
@@ -482,7 +497,7 @@ INLINE void WRITE_LONG(void *address, uint32 data)
 #endif
 
 /* Window & Plane A clipping */
-static struct clip_t
+static THREAD_CONTEXT struct clip_t
 {
   uint8 left;
   uint8 right;
@@ -550,7 +565,7 @@ static const uint32 tms_palette[16] =
 #endif
 
 /* Cached and flipped patterns */
-static uint8 bg_pattern_cache[0x80000];
+static THREAD_CONTEXT uint8 bg_pattern_cache[0x80000];
 
 /* Sprite pattern name offset look-up table (Mode 5) */
 static uint8 name_lut[0x400];
@@ -562,15 +577,15 @@ static uint32 bp_lut[0x10000];
 static uint8 lut[LUT_MAX][LUT_SIZE];
 
 /* Output pixel data look-up tables*/
-static PIXEL_OUT_T pixel[0x100];
+static THREAD_CONTEXT PIXEL_OUT_T pixel[0x100 + 1]; /* extra entry for SIMD table reads */
 static PIXEL_OUT_T pixel_lut[3][0x200];
 static PIXEL_OUT_T pixel_lut_m4[0x40];
 
 /* Background & Sprite line buffers */
-static uint8 linebuf[2][0x200];
+static THREAD_CONTEXT uint8 linebuf[2][0x200];
 
 /* Sprite limit flag */
-static uint8 spr_ovr;
+static THREAD_CONTEXT uint8 spr_ovr;
 
 /* Sprite parsing lists */
 typedef struct 
@@ -581,19 +596,31 @@ typedef struct
   uint16 size;
 } object_info_t;
 
-static object_info_t obj_info[2][20];
+static THREAD_CONTEXT object_info_t obj_info[2][20];
 
 /* Sprite Counter */
-static uint8 object_count[2];
+static THREAD_CONTEXT uint8 object_count[2];
 
 /* Sprite Collision Info */
-uint16 spr_col;
+THREAD_CONTEXT uint16 spr_col;
+
+/* 1= frame is not displayed, only VDP status flags are updated */
+THREAD_CONTEXT uint8 render_skip;
+
+/* Mode 5 sprite collision & overflow flags */
+#ifdef USE_RENDER_THREAD
+/* latched into VDP status by render_sync() as VDP status can be modified concurrently */
+static uint16 spr_status;
+#define SPRITE_STATUS spr_status
+#else
+#define SPRITE_STATUS status
+#endif
 
 /* Function pointers */
-void (*render_bg)(int line);
-void (*render_obj)(int line);
-void (*parse_satb)(int line);
-void (*update_bg_pattern_cache)(int index);
+THREAD_CONTEXT void (*render_bg)(int line);
+THREAD_CONTEXT void (*render_obj)(int line);
+THREAD_CONTEXT void (*parse_satb)(int line);
+THREAD_CONTEXT void (*update_bg_pattern_cache)(int index);
 
 
 /*--------------------------------------------------------------------------*/
@@ -940,7 +967,7 @@ static uint32 make_lut_bgobj_m4(uint32 bx, uint32 sx)
 /* Pixel layer merging function                                             */
 /*--------------------------------------------------------------------------*/
 
-INLINE void merge(uint8 *srca, uint8 *srcb, uint8 *dst, uint8 *table, int width)
+static void merge_c(uint8 *srca, uint8 *srcb, uint8 *dst, uint8 *table, int width)
 {
   do
   {
@@ -950,6 +977,173 @@ INLINE void merge(uint8 *srca, uint8 *srcb, uint8 *dst, uint8 *table, int width)
 }
 
 
+/*--------------------------------------------------------------------------*/
+/* Pixel color remapping functions                                          */
+/*--------------------------------------------------------------------------*/
+
+static void remap_c(uint8 *src, PIXEL_OUT_T *dst, PIXEL_OUT_T *table, int width)
+{
+  do
+  {
+    *dst++ = table[*src++];
+  }
+  while (--width);
+}
+
+static void remap_lcd_c(uint8 *src, PIXEL_OUT_T *dst, PIXEL_OUT_T *table, int width, int rate)
+{
+  do
+  {
+    RENDER_PIXEL_LCD(src,dst,table,rate);
+  }
+  while (--width);
+}
+
+
+/*--------------------------------------------------------------------------*/
+/* x86 SIMD pixel functions (selected at runtime, output is identical)      */
+/*--------------------------------------------------------------------------*/
+
+#ifdef SIMD_RENDER
+
+/* 16 pixels merged per two table gathers (lut[] tables are followed by another table so 32-bit reads never overflow) */
+__attribute__((target("avx2"))) static void merge_avx2(uint8 *srca, uint8 *srcb, uint8 *dst, uint8 *table, int width)
+{
+  const __m256i mask = _mm256_set1_epi32(0xff);
+
+  while (width >= 16)
+  {
+    __m256i a0 = _mm256_cvtepu8_epi32(_mm_loadl_epi64((const __m128i *)srca));
+    __m256i b0 = _mm256_cvtepu8_epi32(_mm_loadl_epi64((const __m128i *)srcb));
+    __m256i a1 = _mm256_cvtepu8_epi32(_mm_loadl_epi64((const __m128i *)(srca + 8)));
+    __m256i b1 = _mm256_cvtepu8_epi32(_mm_loadl_epi64((const __m128i *)(srcb + 8)));
+    __m256i c0 = _mm256_i32gather_epi32((const int *)table, _mm256_or_si256(_mm256_slli_epi32(b0, 8), a0), 1);
+    __m256i c1 = _mm256_i32gather_epi32((const int *)table, _mm256_or_si256(_mm256_slli_epi32(b1, 8), a1), 1);
+    __m128i d;
+    c0 = _mm256_permute4x64_epi64(_mm256_packus_epi32(_mm256_and_si256(c0, mask), _mm256_and_si256(c1, mask)), 0xd8);
+    d = _mm_packus_epi16(_mm256_castsi256_si128(c0), _mm256_extracti128_si256(c0, 1));
+    _mm_storeu_si128((__m128i *)dst, d);
+    srca += 16;
+    srcb += 16;
+    dst += 16;
+    width -= 16;
+  }
+
+  if (width)
+  {
+    merge_c(srca, srcb, dst, table, width);
+  }
+}
+
+#ifndef USE_8BPP_RENDERING
+/* 16 pixels converted per two table gathers (pixel[] table has one extra entry so 32-bit reads never overflow) */
+__attribute__((target("avx2"))) static void remap_avx2(uint8 *src, PIXEL_OUT_T *dst, PIXEL_OUT_T *table, int width)
+{
+  while (width >= 16)
+  {
+    __m256i a = _mm256_cvtepu8_epi32(_mm_loadl_epi64((const __m128i *)src));
+    __m256i b = _mm256_cvtepu8_epi32(_mm_loadl_epi64((const __m128i *)(src + 8)));
+#if defined(USE_32BPP_RENDERING)
+    _mm256_storeu_si256((__m256i *)dst, _mm256_i32gather_epi32((const int *)table, a, 4));
+    _mm256_storeu_si256((__m256i *)(dst + 8), _mm256_i32gather_epi32((const int *)table, b, 4));
+#else
+    const __m256i mask = _mm256_set1_epi32(0xffff);
+    a = _mm256_and_si256(_mm256_i32gather_epi32((const int *)table, a, 2), mask);
+    b = _mm256_and_si256(_mm256_i32gather_epi32((const int *)table, b, 2), mask);
+    _mm256_storeu_si256((__m256i *)dst, _mm256_permute4x64_epi64(_mm256_packus_epi32(a, b), 0xd8));
+#endif
+    src += 16;
+    dst += 16;
+    width -= 16;
+  }
+
+  if (width)
+  {
+    remap_c(src, dst, table, width);
+  }
+}
+
+/* LCD ghosting filter: new = new + ((rate * (old - new)) >> 8) for each color channel, if old > new */
+#define LCD_DECAY(old, new, rate) \
+  _mm_add_epi16(new, _mm_srli_epi16(_mm_mullo_epi16(_mm_max_epi16(_mm_sub_epi16(old, new), zero), rate), 8))
+
+#if defined(USE_32BPP_RENDERING)
+
+__attribute__((target("sse2"))) static void remap_lcd_sse2(uint8 *src, PIXEL_OUT_T *dst, PIXEL_OUT_T *table, int width, int rate)
+{
+  const __m128i zero = _mm_setzero_si128();
+  const __m128i alpha = _mm_set1_epi32(0xff << 24);
+  const __m128i r = _mm_set1_epi16(rate);
+
+  /* 4 pixels at once, 8-bit color channels are processed as 16-bit values */
+  while (width >= 4)
+  {
+    __m128i n = _mm_set_epi32(table[src[3]], table[src[2]], table[src[1]], table[src[0]]);
+    __m128i o = _mm_loadu_si128((const __m128i *)dst);
+    __m128i lo = LCD_DECAY(_mm_unpacklo_epi8(o, zero), _mm_unpacklo_epi8(n, zero), r);
+    __m128i hi = LCD_DECAY(_mm_unpackhi_epi8(o, zero), _mm_unpackhi_epi8(n, zero), r);
+    _mm_storeu_si128((__m128i *)dst, _mm_or_si128(_mm_packus_epi16(lo, hi), alpha));
+    src += 4;
+    dst += 4;
+    width -= 4;
+  }
+
+  if (width)
+  {
+    remap_lcd_c(src, dst, table, width, rate);
+  }
+}
+#else
+#if defined(USE_15BPP_RENDERING)
+#define LCD_R_SHIFT 10
+#define LCD_G_MASK  0x1f
+#define LCD_ALPHA   0x8000
+#else
+#define LCD_R_SHIFT 11
+#define LCD_G_MASK  0x3f
+#define LCD_ALPHA   0x0000
+#endif
+
+__attribute__((target("sse2"))) static void remap_lcd_sse2(uint8 *src, PIXEL_OUT_T *dst, PIXEL_OUT_T *table, int width, int rate)
+{
+  const __m128i zero = _mm_setzero_si128();
+  const __m128i rb_mask = _mm_set1_epi16(0x1f);
+  const __m128i g_mask = _mm_set1_epi16(LCD_G_MASK);
+  const __m128i alpha = _mm_set1_epi16(LCD_ALPHA);
+  const __m128i r = _mm_set1_epi16(rate);
+
+  /* 8 pixels at once */
+  while (width >= 8)
+  {
+    __m128i n = _mm_set_epi16(table[src[7]], table[src[6]], table[src[5]], table[src[4]],
+                              table[src[3]], table[src[2]], table[src[1]], table[src[0]]);
+    __m128i o = _mm_loadu_si128((const __m128i *)dst);
+    __m128i cr = LCD_DECAY(_mm_and_si128(_mm_srli_epi16(o, LCD_R_SHIFT), rb_mask), _mm_and_si128(_mm_srli_epi16(n, LCD_R_SHIFT), rb_mask), r);
+    __m128i cg = LCD_DECAY(_mm_and_si128(_mm_srli_epi16(o, 5), g_mask), _mm_and_si128(_mm_srli_epi16(n, 5), g_mask), r);
+    __m128i cb = LCD_DECAY(_mm_and_si128(o, rb_mask), _mm_and_si128(n, rb_mask), r);
+    n = _mm_or_si128(_mm_or_si128(_mm_slli_epi16(cr, LCD_R_SHIFT), _mm_slli_epi16(cg, 5)), _mm_or_si128(cb, alpha));
+    _mm_storeu_si128((__m128i *)dst, n);
+    src += 8;
+    dst += 8;
+    width -= 8;
+  }
+
+  if (width)
+  {
+    remap_lcd_c(src, dst, table, width, rate);
+  }
+}
+#endif
+#endif /* USE_8BPP_RENDERING */
+
+#endif /* SIMD_RENDER */
+
+/* Selected pixel functions */
+static void (*merge_line)(uint8 *srca, uint8 *srcb, uint8 *dst, uint8 *table, int width) = merge_c;
+static void (*remap_pixels)(uint8 *src, PIXEL_OUT_T *dst, PIXEL_OUT_T *table, int width) = remap_c;
+static void (*remap_pixels_lcd)(uint8 *src, PIXEL_OUT_T *dst, PIXEL_OUT_T *table, int width, int rate) = remap_lcd_c;
+
+
 /*--------------------------------------------------------------------------*/
 /* Pixel color lookup tables initialization                                 */
 /*--------------------------------------------------------------------------*/
@@ -1643,7 +1837,7 @@ void render_bg_m5(int line)
   }
 
   /* Merge background layers */
-  merge(&linebuf[1][0x20], &linebuf[0][0x20], &linebuf[0][0x20], lut[(reg[12] & 0x08) >> 2], bitmap.viewport.w);
+  merge_line(&linebuf[1][0x20], &linebuf[0][0x20], &linebuf[0][0x20], lut[(reg[12] & 0x08) >> 2], bitmap.viewport.w);
 }
 
 void render_bg_m5_vs(int line)
@@ -1833,7 +2027,7 @@ void render_bg_m5_vs(int line)
   }
 
   /* Merge background layers */
-  merge(&linebuf[1][0x20], &linebuf[0][0x20], &linebuf[0][0x20], lut[(reg[12] & 0x08) >> 2], bitmap.viewport.w);
+  merge_line(&linebuf[1][0x20], &linebuf[0][0x20], &linebuf[0][0x20], lut[(reg[12] & 0x08) >> 2], bitmap.viewport.w);
 }
 
 void render_bg_m5_im2(int line)
@@ -1985,7 +2179,7 @@ void render_bg_m5_im2(int line)
   }
 
   /* Merge background layers */
-  merge(&linebuf[1][0x20], &linebuf[0][0x20], &linebuf[0][0x20], lut[(reg[12] & 0x08) >> 2], bitmap.viewport.w);
+  merge_line(&linebuf[1][0x20], &linebuf[0][0x20], &linebuf[0][0x20], lut[(reg[12] & 0x08) >> 2], bitmap.viewport.w);
 }
 
 void render_bg_m5_im2_vs(int line)
@@ -2176,7 +2370,7 @@ void render_bg_m5_im2_vs(int line)
   }
 
   /* Merge background layers */
-  merge(&linebuf[1][0x20], &linebuf[0][0x20], &linebuf[0][0x20], lut[(reg[12] & 0x08) >> 2], bitmap.viewport.w);
+  merge_line(&linebuf[1][0x20], &linebuf[0][0x20], &linebuf[0][0x20], lut[(reg[12] & 0x08) >> 2], bitmap.viewport.w);
 }
 
 #else
@@ -3349,7 +3543,7 @@ void render_obj_m5_ste(int line)
       spr_ovr = (pixelcount >= bitmap.viewport.w);
 
       /* Merge background & sprite layers */
-      merge(&linebuf[1][0x20], &linebuf[0][0x20], &linebuf[0][0x20], lut[4], bitmap.viewport.w);
+      merge_line(&linebuf[1][0x20], &linebuf[0][0x20], &linebuf[0][0x20], lut[4], bitmap.viewport.w);
 
       /* Stop sprite rendering */
       return;
@@ -3363,7 +3557,7 @@ void render_obj_m5_ste(int line)
   spr_ovr = 0;
 
   /* Merge background & sprite layers */
-  merge(&linebuf[1][0x20], &linebuf[0][0x20], &linebuf[0][0x20], lut[4], bitmap.viewport.w);
+  merge_line(&linebuf[1][0x20], &linebuf[0][0x20], &linebuf[0][0x20], lut[4], bitmap.viewport.w);
 }
 
 void render_obj_m5_im2(int line)
@@ -3576,7 +3770,7 @@ void render_obj_m5_im2_ste(int line)
       spr_ovr = (pixelcount >= bitmap.viewport.w);
 
       /* Merge background & sprite layers */
-      merge(&linebuf[1][0x20], &linebuf[0][0x20], &linebuf[0][0x20], lut[4], bitmap.viewport.w);
+      merge_line(&linebuf[1][0x20], &linebuf[0][0x20], &linebuf[0][0x20], lut[4], bitmap.viewport.w);
 
       /* Stop sprite rendering */
       return;
@@ -3590,7 +3784,274 @@ void render_obj_m5_im2_ste(int line)
   spr_ovr = 0;
 
   /* Merge background & sprite layers */
-  merge(&linebuf[1][0x20], &linebuf[0][0x20], &linebuf[0][0x20], lut[4], bitmap.viewport.w);
+  merge_line(&linebuf[1][0x20], &linebuf[0][0x20], &linebuf[0][0x20], lut[4], bitmap.viewport.w);
+}
+
+
+/*--------------------------------------------------------------------------*/
+/* Sprite status functions (used when rendering is skipped)                 */
+/*--------------------------------------------------------------------------*/
+
+/* Sprite collisions are detected using sprite pixel markers (d7) in line buffer, including markers */
+/* left by previous lines in areas not overwritten by background layers. When rendering is skipped, */
+/* background layers only clear these markers, so that VDP status flags are updated exactly as when */
+/* lines are rendered. Mode 5 sprite pixels are read directly from VRAM so that the pattern cache  */
+/* does not need to be updated.                                                                     */
+
+static void status_bg(int line)
+{
+  int start = 0x20;
+  int end = 0x20 + 256;
+
+  /* Mode 5 */
+  if (parse_satb == parse_satb_m5)
+  {
+    /* Horizontal scrolling */
+    uint32 xscroll = *(uint32 *)&vram[hscb + ((line & hscroll_mask) << 2)];
+
+    /* Plane B scroll */
+#ifdef LSB_FIRST
+    int shift = (xscroll >> 16) & 0x0F;
+#else
+    int shift = (xscroll & 0x0F);
+#endif
+
+    /* Left-most column is partially shown */
+    if (shift)
+    {
+      start = 0x10 + shift;
+    }
+
+    end = 0x20 + bitmap.viewport.w + shift;
+
+#ifdef ALT_RENDERER
+    {
+      /* Window vertical range (cell 0-31) */
+      int a = (reg[18] & 0x1F) << 3;
+
+      /* Window position (0=top, 1=bottom) */
+      int w = (reg[18] >> 7) & 1;
+
+      /* Plane A is drawn in the same line buffer */
+      if ((w != (line >= a)) && clip[0].enable)
+      {
+#ifdef LSB_FIRST
+        shift = (xscroll & 0x0F);
+#else
+        shift = (xscroll >> 16) & 0x0F;
+#endif
+        a = 0x20 + (clip[0].left << 4) + shift;
+        w = 0x20 + (clip[0].right << 4) + shift;
+
+        if (shift)
+        {
+          a -= 0x10;
+        }
+
+        if (a < start)
+        {
+          start = a;
+        }
+
+        if (w > end)
+        {
+          end = w;
+        }
+      }
+    }
+#endif
+  }
+
+  /* Mode 4 */
+  else if (render_bg == render_bg_m4)
+  {
+    /* Horizontal scrolling */
+    int index = ((reg[0] & 0x40) && (line < 0x10)) ? 0x100 : reg[0x08];
+    end += (index & 7);
+  }
+
+  /* Clear sprite pixel markers */
+  memset(&linebuf[0][start], 0, end - start);
+}
+
+static void status_obj_m5(int line)
+{
+  int i, column;
+  int xpos, width;
+  int pixelcount = 0;
+  int masked = 0;
+
+  uint8 *s, *lb, *sg;
+  uint32 temp, v_line, mask;
+  uint32 attr, name, row;
+
+  /* Interlaced mode 2 (16 pixels high patterns) */
+  int im2 = (render_obj == render_obj_m5_im2) || (render_obj == render_obj_m5_im2_ste);
+
+  /* Sprite list for current line */
+  object_info_t *object_info = obj_info[line];
+  int count = object_count[line];
+
+  /* Sprite line buffer */
+  uint8 *buf = linebuf[0];
+
+  /* Shadow & Highlight mode */
+  if ((render_obj == render_obj_m5_ste) || (render_obj == render_obj_m5_im2_ste))
+  {
+    /* Clear sprite line buffer */
+    buf = linebuf[1];
+    memset(&buf[0], 0, bitmap.viewport.w + 0x40);
+  }
+
+  while (count--)
+  {
+    /* Sprite X position */
+    xpos = object_info->xpos;
+
+    /* Sprite masking  */
+    if (xpos)
+    {
+      /* Requires at least one sprite with xpos > 0 */
+      spr_ovr = 1;
+    }
+    else if (spr_ovr)
+    {
+      /* Remaining sprites are not drawn */
+      masked = 1;
+    }
+
+    /* Display area offset */
+    xpos = xpos - 0x80;
+
+    /* Sprite size */
+    temp = object_info->size;
+
+    /* Sprite width */
+    width = 8 + ((temp & 0x0C) << 1);
+
+    /* Update pixel count (off-screen sprites are included) */
+    pixelcount += width;
+
+    /* Is sprite across visible area ? */
+    if (((xpos + width) > 0) && (xpos < bitmap.viewport.w) && !masked)
+    {
+      /* Sprite attributes */
+      attr = object_info->attr;
+
+      /* Sprite vertical offset */
+      v_line = object_info->ypos;
+
+      /* Pattern name base */
+      name = attr & (im2 ? 0x03FF : 0x07FF);
+
+      /* Mask vflip/hflip */
+      attr &= 0x1800;
+
+      /* Pointer into pattern name offset look-up table */
+      s = &name_lut[((attr >> 3) & 0x300) | (temp << 4) | ((v_line & 0x18) >> 1)];
+
+      /* Pointer into line buffer */
+      lb = &buf[0x20 + xpos];
+
+      /* Max. number of sprite pixels rendered per line */
+      if (pixelcount > max_sprite_pixels)
+      {
+        /* Adjust number of pixels to draw */
+        width -= (pixelcount - max_sprite_pixels);
+      }
+
+      /* Number of tiles to draw */
+      width = width >> 3;
+
+      /* Pattern row index */
+      if (im2)
+      {
+        v_line = ((v_line & 7) << 1) | odd_frame;
+      }
+      else
+      {
+        v_line = v_line & 7;
+      }
+
+      for (column = 0; column < width; column++, lb+=8)
+      {
+        /* Pattern line (vertically flipped if required) */
+        if (im2)
+        {
+          temp = ((((name + s[column]) & 0x3FF) << 1) | (v_line >> 3)) ^ ((attr >> 12) & 1);
+          row = v_line & 7;
+        }
+        else
+        {
+          temp = (name + s[column]) & 0x7FF;
+          row = v_line;
+        }
+        row ^= ((attr >> 12) & 1) * 7;
+        sg = &vram[(temp << 5) | (row << 2)];
+
+        /* Opaque pixels (horizontally flipped if required) */
+        mask = 0;
+        for (i = 0; i < 4; i++)
+        {
+#ifdef LSB_FIRST
+          /* byte0 = p2p3, byte1 = p0p1, byte2 = p6p7, byte3 = p4p5 */
+          temp = (i ^ 1) << 1;
+#else
+          /* byte0 = p0p1, byte1 = p2p3, byte2 = p4p5, byte3 = p6p7 */
+          temp = i << 1;
+#endif
+          if (attr & 0x800)
+          {
+            temp = 6 - temp;
+            mask |= (((sg[i] & 0x0F) ? 2 : 0) | ((sg[i] & 0xF0) ? 1 : 0)) << (6 - temp);
+          }
+          else
+          {
+            mask |= (((sg[i] & 0xF0) ? 2 : 0) | ((sg[i] & 0x0F) ? 1 : 0)) << (6 - temp);
+          }
+        }
+
+        /* Collision is detected when opaque pixels overwrite sprite pixel markers */
+        for (i = 0; i < 8; i++, mask<<=1)
+        {
+          if (mask & 0x80)
+          {
+            status |= ((lb[i] & 0x80) >> 2);
+            lb[i] = 0x80;
+          }
+        }
+      }
+    }
+
+    /* Sprite limit */
+    if (pixelcount >= max_sprite_pixels)
+    {
+      /* Sprite masking is effective on next line if max pixel width is reached */
+      spr_ovr = (pixelcount >= bitmap.viewport.w);
+
+      /* Stop sprite processing */
+      return;
+    }
+
+    /* Next sprite entry */
+    object_info++;
+  }
+
+  /* Clear sprite masking for next line  */
+  spr_ovr = 0;
+}
+
+void render_obj_status(int line)
+{
+  if (parse_satb == parse_satb_m5)
+  {
+    status_obj_m5(line);
+  }
+  else
+  {
+    /* TMS & Mode 4 sprites are processed as when rendered (no layer merging involved) */
+    render_obj(line);
+  }
 }
 
 
@@ -3605,6 +4066,8 @@ void parse_satb_tms(int line)
   /* Sprite counter (4 max. per line) */
   int count = 0;
 
+  PROFILE_BEGIN(PROFILE_PARSE_SATB);
+
   /* no sprites in Text modes */
   if (!(reg[1] & 0x10))
   {
@@ -3685,6 +4148,8 @@ void parse_satb_tms(int line)
 
   /* Insert number of last sprite entry processed */
   status = (status & 0xE0) | (i & 0x1F);
+
+  PROFILE_END(PROFILE_PARSE_SATB);
 }
 
 void parse_satb_m4(int line)
@@ -3707,6 +4172,8 @@ void parse_satb_m4(int line)
   /* Sprite attribute table address mask */
   uint16 st_mask = ~0x3F80 ^ (reg[5] << 7);
 
+  PROFILE_BEGIN(PROFILE_PARSE_SATB);
+
   /* Unused bits used as a mask on 315-5124 VDP only */
   if (system_hw > SYSTEM_SMS)
   {
@@ -3773,6 +4240,8 @@ void parse_satb_m4(int line)
 
   /* Update sprite count for next line */
   object_count[(line + 1) & 1] = count;
+
+  PROFILE_END(PROFILE_PARSE_SATB);
 }
 
 void parse_satb_m5(int line)
@@ -3807,6 +4276,8 @@ void parse_satb_m5(int line)
   /* Sprite list for next line */
   object_info_t *object_info = obj_info[(line + 1) & 1];
 
+  PROFILE_BEGIN(PROFILE_PARSE_SATB);
+
   /* Adjust line offset */
   line += 0x81;
 
@@ -3833,7 +4304,7 @@ void parse_satb_m5(int line)
         /* Sprite overflow */
         if (count == max)
         {
-          status |= 0x40;
+          SPRITE_STATUS |= 0x40;
           break;
         }
 
@@ -3861,6 +4332,8 @@ void parse_satb_m5(int line)
 
   /* Update sprite count for next line (line value already incremented) */
   object_count[line & 1] = count;
+
+  PROFILE_END(PROFILE_PARSE_SATB);
 }
 
 
@@ -3876,6 +4349,8 @@ void update_bg_pattern_cache_m4(int index)
   uint16 name, bp01, bp23;
   uint32 bp;
 
+  PROFILE_BEGIN(PROFILE_UPDATE_BG_PATTERN_CACHE);
+
   for(i = 0; i < index; i++)
   {
     /* Get modified pattern name index */
@@ -3920,6 +4395,8 @@ void update_bg_pattern_cache_m4(int index)
     /* Clear modified pattern flag */
     bg_name_dirty[name] = 0;
   }
+
+  PROFILE_END(PROFILE_UPDATE_BG_PATTERN_CACHE);
 }
 
 void update_bg_pattern_cache_m5(int index)
@@ -3930,6 +4407,8 @@ void update_bg_pattern_cache_m5(int index)
   uint16 name;
   uint32 bp;
 
+  PROFILE_BEGIN(PROFILE_UPDATE_BG_PATTERN_CACHE);
+
   for(i = 0; i < index; i++)
   {
     /* Get modified pattern name index */
@@ -3979,6 +4458,8 @@ void update_bg_pattern_cache_m5(int index)
     /* Clear modified pattern flag */
     bg_name_dirty[name] = 0;
   }
+
+  PROFILE_END(PROFILE_UPDATE_BG_PATTERN_CACHE);
 }
 
 
@@ -4035,12 +4516,12 @@ void window_clip(unsigned int data, unsigned int sw)
 /* Init, reset routines                                                     */
 /*--------------------------------------------------------------------------*/
 
-void render_init(void)
+static void render_init_tables(void)
 {
   int bx, ax;
+  uint16 index;
 
   /* Initialize layers priority pixel look-up tables */
-  uint16 index;
   for (bx = 0; bx < 0x100; bx++)
   {
     for (ax = 0; ax < 0x100; ax++)
@@ -4064,6 +4545,30 @@ void render_init(void)
 
   /* Make bitplane to pixel look-up table (Mode 4) */
   make_bp_lut();
+
+#ifdef SIMD_RENDER
+  /* Select pixel functions supported by host CPU */
+  __builtin_cpu_init();
+  if (__builtin_cpu_supports("avx2"))
+  {
+    merge_line = merge_avx2;
+#ifndef USE_8BPP_RENDERING
+    remap_pixels = remap_avx2;
+#endif
+  }
+#ifndef USE_8BPP_RENDERING
+  if (__builtin_cpu_supports("sse2"))
+  {
+    remap_pixels_lcd = remap_lcd_sse2;
+  }
+#endif
+#endif
+}
+
+void render_init(void)
+{
+  /* Look-up tables are shared by all emulated systems and only need to be initialized once */
+  RUN_ONCE(render_init_tables);
 }
 
 void render_reset(void)
@@ -4071,26 +4576,78 @@ void render_reset(void)
   /* Clear display bitmap */
   memset(bitmap.data, 0, bitmap.pitch * bitmap.height);
 
+  /* Clear pattern cache */
+  memset ((char *) bg_pattern_cache, 0, sizeof (bg_pattern_cache));
+
+  render_restore();
+}
+
+void render_restore(void)
+{
   /* Clear line buffers */
   memset(linebuf, 0, sizeof(linebuf));
 
   /* Clear color palettes */
   memset(pixel, 0, sizeof(pixel));
 
-  /* Clear pattern cache */
-  memset ((char *) bg_pattern_cache, 0, sizeof (bg_pattern_cache));
-
   /* Reset Sprite infos */
   spr_ovr = spr_col = object_count[0] = object_count[1] = 0;
 }
 
+/* Sprite processing state carried over to next line is part of VDP savestate */
+int render_context_save(uint8 *state)
+{
+  int i, bufferptr = 0;
+  uint8 markers[0x200 >> 3];
+
+  /* Sprites parsed for next line */
+  save_param(obj_info, sizeof(obj_info));
+  save_param(object_count, sizeof(object_count));
+  save_param(&spr_ovr, sizeof(spr_ovr));
+  save_param(&spr_col, sizeof(spr_col));
+
+  /* Sprite pixel markers left in line buffer (sprites are still processed during Master System top border) */
+  memset(markers, 0, sizeof(markers));
+  for (i=0; i<0x200; i++)
+  {
+    if (linebuf[0][i] & 0x80)
+    {
+      markers[i >> 3] |= (1 << (i & 7));
+    }
+  }
+  save_param(markers, sizeof(markers));
+
+  return bufferptr;
+}
+
+int render_context_load(uint8 *state)
+{
+  int i, bufferptr = 0;
+  uint8 markers[0x200 >> 3];
+
+  load_param(obj_info, sizeof(obj_info));
+  load_param(object_count, sizeof(object_count));
+  load_param(&spr_ovr, sizeof(spr_ovr));
+  load_param(&spr_col, sizeof(spr_col));
+  load_param(markers, sizeof(markers));
+
+  for (i=0; i<0x200; i++)
+  {
+    linebuf[0][i] = (markers[i >> 3] & (1 << (i & 7))) ? 0x80 : 0x00;
+  }
+
+  return bufferptr;
+}
+
 
 /*--------------------------------------------------------------------------*/
 /* Line rendering functions                                                 */
 /*--------------------------------------------------------------------------*/
 
-void render_line(int line)
+static void render_line_exec(int line)
 {
+  PROFILE_BEGIN(PROFILE_RENDER_LINE);
+
   /* Check display status */
   if (reg[1] & 0x40)
   {
@@ -4148,12 +4705,103 @@ void render_line(int line)
 
   /* Pixel color remapping */
   remap_line(line);
+
+  PROFILE_END(PROFILE_RENDER_LINE);
+}
+
+static void render_line_status(int line)
+{
+  PROFILE_BEGIN(PROFILE_RENDER_LINE);
+
+  /* Check display status */
+  if (reg[1] & 0x40)
+  {
+    /* Update pattern cache (Mode 4 sprites, also processed during vertical borders) */
+    if (bg_list_index && (parse_satb == parse_satb_m4))
+    {
+      update_bg_pattern_cache(bg_list_index);
+      bg_list_index = 0;
+    }
+
+    /* Clear BG layer(s) sprite pixel markers */
+    status_bg(line);
+
+    /* Sprite layer status flags */
+    render_obj_status(line & 1);
+
+    /* Left-most column blanking */
+    if (reg[0] & 0x20)
+    {
+      if (system_hw > SYSTEM_SGII)
+      {
+        memset(&linebuf[0][0x20], 0x40, 8);
+      }
+    }
+
+    /* Parse sprites for next line */
+    if (line < (bitmap.viewport.h - 1))
+    {
+      parse_satb(line);
+    }
+
+    /* Horizontal borders */
+    if (bitmap.viewport.x > 0)
+    {
+      memset(&linebuf[0][0x20 - bitmap.viewport.x], 0x40, bitmap.viewport.x);
+      memset(&linebuf[0][0x20 + bitmap.viewport.w], 0x40, bitmap.viewport.x);
+    }
+  }
+  else
+  {
+    /* Master System & Game Gear VDP specific */
+    if (system_hw < SYSTEM_MD)
+    {
+      /* Update SOVR flag */
+      status |= spr_ovr;
+      spr_ovr = 0;
+
+      /* Sprites are still parsed when display is disabled */
+      parse_satb(line);
+    }
+
+    /* Blanked line */
+    memset(&linebuf[0][0x20 - bitmap.viewport.x], 0x40, bitmap.viewport.w + 2*bitmap.viewport.x);
+  }
+
+  PROFILE_END(PROFILE_RENDER_LINE);
+}
+
+void render_line(int line)
+{
+  /* lines are rendered in order */
+  render_sync();
+
+  if (render_skip)
+  {
+    /* layers & pixels are not updated */
+    render_line_status(line);
+  }
+  else
+  {
+    render_line_exec(line);
+  }
+
+#ifdef USE_RENDER_THREAD
+  /* latch sprite status flags */
+  render_sync();
+#endif
 }
 
 void blank_line(int line, int offset, int width)
 {
+  render_sync();
   memset(&linebuf[0][0x20 + offset], 0x40, width);
-  remap_line(line);
+
+  /* pixels are not updated when rendering is skipped */
+  if (!render_skip)
+  {
+    remap_line(line);
+  }
 }
 
 void remap_line(int line)
@@ -4170,6 +4818,8 @@ void remap_line(int line)
   /* Take care of Game Gear reduced screen when overscan is disabled */
   if (line < 0) return;
 
+  PROFILE_BEGIN(PROFILE_REMAP_LINE);
+
   /* Adjust for interlaced output */
   if (interlaced && config.render)
   {
@@ -4199,20 +4849,169 @@ void remap_line(int line)
     PIXEL_OUT_T *dst = ((PIXEL_OUT_T *)&bitmap.data[(line * bitmap.pitch)]);
     if (config.lcd)
     {
-      do
+      remap_pixels_lcd(src, dst, pixel, width, config.lcd);
+    }
+    else
+    {
+      remap_pixels(src, dst, pixel, width);
+    }
+ #endif
+  }
+
+  PROFILE_END(PROFILE_REMAP_LINE);
+}
+
+
+/*--------------------------------------------------------------------------*/
+/* Render thread                                                            */
+/*--------------------------------------------------------------------------*/
+
+#ifdef USE_RENDER_THREAD
+
+/* Mode 5 lines are queued by the emulation thread and rendered by a worker thread while
+   CPUs keep running. VDP state is only modified when the VDP is accessed (ports, DMA), which
+   always waits for queued lines to be rendered first, so mid-frame effects remain exact. */
+
+/* queued lines (power of 2) */
+#define RENDER_QUEUE_SIZE 512
+
+/* busy-wait loops before sleeping or yielding */
+#define RENDER_SPIN_COUNT 0x4000
+
+static pthread_t render_thread;
+static pthread_mutex_t render_mutex = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t render_cond = PTHREAD_COND_INITIALIZER;
+static int render_thread_running;
+static volatile int render_quit;
+static volatile int render_sleeping;
+static volatile unsigned int render_head; /* next queued line (emulation thread) */
+static volatile unsigned int render_tail; /* next rendered line (worker thread) */
+static int render_queue[RENDER_QUEUE_SIZE];
+
+static void *render_thread_func(void *arg)
+{
+  unsigned int spin = 0;
+
+  while (!render_quit)
+  {
+    if (render_tail != render_head)
+    {
+      /* render next queued line */
+      __sync_synchronize();
+      render_line_exec(render_queue[render_tail & (RENDER_QUEUE_SIZE - 1)]);
+      __sync_synchronize();
+      render_tail++;
+      spin = 0;
+    }
+    else if (++spin > RENDER_SPIN_COUNT)
+    {
+      /* wait for next queued line */
+      pthread_mutex_lock(&render_mutex);
+      render_sleeping = 1;
+      __sync_synchronize();
+      while ((render_tail == render_head) && !render_quit)
       {
-        RENDER_PIXEL_LCD(src,dst,pixel,config.lcd);
+        pthread_cond_wait(&render_cond, &render_mutex);
       }
-      while (--width);
+      render_sleeping = 0;
+      pthread_mutex_unlock(&render_mutex);
+      spin = 0;
     }
-    else
+  }
+
+  return NULL;
+}
+
+static void render_thread_wakeup(void)
+{
+  __sync_synchronize();
+  if (render_sleeping)
+  {
+    pthread_mutex_lock(&render_mutex);
+    pthread_cond_signal(&render_cond);
+    pthread_mutex_unlock(&render_mutex);
+  }
+}
+
+int render_thread_start(void)
+{
+  if (!render_thread_running)
+  {
+    /* worker thread needs its own CPU core */
+    if (sysconf(_SC_NPROCESSORS_ONLN) < 2)
     {
-      do
+      return 0;
+    }
+
+    render_quit = 0;
+    render_head = render_tail = 0;
+    if (pthread_create(&render_thread, NULL, render_thread_func, NULL))
+    {
+      return 0;
+    }
+    render_thread_running = 1;
+  }
+
+  return 1;
+}
+
+void render_thread_stop(void)
+{
+  if (render_thread_running)
+  {
+    render_sync();
+    render_quit = 1;
+    pthread_mutex_lock(&render_mutex);
+    pthread_cond_signal(&render_cond);
+    pthread_mutex_unlock(&render_mutex);
+    pthread_join(render_thread, NULL);
+    render_thread_running = 0;
+  }
+}
+
+void render_line_async(int line)
+{
+  /* only Mode 5 renderers do not modify VDP state */
+  if (!render_thread_running || render_skip || (parse_satb != parse_satb_m5))
+  {
+    render_line(line);
+    return;
+  }
+
+  /* wait for free slot */
+  if ((render_head - render_tail) == RENDER_QUEUE_SIZE)
+  {
+    render_sync();
+  }
+
+  render_queue[render_head & (RENDER_QUEUE_SIZE - 1)] = line;
+  __sync_synchronize();
+  render_head++;
+  render_thread_wakeup();
+}
+
+void render_sync(void)
+{
+  if (render_tail != render_head)
+  {
+    unsigned int spin = 0;
+
+    /* wait for queued lines to be rendered */
+    do
+    {
+      if (++spin > RENDER_SPIN_COUNT)
       {
-        *dst++ = pixel[*src++];
+        sched_yield();
       }
-      while (--width);
     }
- #endif
+    while (render_tail != render_head);
+
+    __sync_synchronize();
   }
+
+  /* latch sprite status flags */
+  status |= spr_status;
+  spr_status = 0;
 }
+
+#endif /* USE_RENDER_THREAD */
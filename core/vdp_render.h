@@ -92,11 +92,15 @@
 }
 
 /* Global variables */
-extern uint16 spr_col;
+extern THREAD_CONTEXT uint16 spr_col;
+extern THREAD_CONTEXT uint8 render_skip;
 
 /* Function prototypes */
 extern void render_init(void);
 extern void render_reset(void);
+extern void render_restore(void);
+extern int render_context_save(uint8 *state);
+extern int render_context_load(uint8 *state);
 extern void render_line(int line);
 extern void blank_line(int line, int offset, int width);
 extern void remap_line(int line);
@@ -119,6 +123,7 @@ extern void render_obj_m5(int line);
 extern void render_obj_m5_ste(int line);
 extern void render_obj_m5_im2(int line);
 extern void render_obj_m5_im2_ste(int line);
+extern void render_obj_status(int line);
 extern void parse_satb_tms(int line);
 extern void parse_satb_m4(int line);
 extern void parse_satb_m5(int line);
@@ -127,11 +132,25 @@ extern void update_bg_pattern_cache_m5(int index);
 extern void color_update_m4(int index, unsigned int data);
 extern void color_update_m5(int index, unsigned int data);
 
+/* Scanlines are rendered on a worker thread if you define USE_RENDER_THREAD in the makefile
+ * (requires POSIX threads) and render_thread_start() has been called. VDP accesses must call
+ * render_sync() before any VDP state is modified. Not compatible with USE_THREAD_CONTEXT.
+ */
+#ifdef USE_RENDER_THREAD
+extern int render_thread_start(void);
+extern void render_thread_stop(void);
+extern void render_line_async(int line);
+extern void render_sync(void);
+#else
+#define render_line_async(line) render_line(line)
+#define render_sync()
+#endif
+
 /* Function pointers */
-extern void (*render_bg)(int line);
-extern void (*render_obj)(int line);
-extern void (*parse_satb)(int line);
-extern void (*update_bg_pattern_cache)(int index);
+extern THREAD_CONTEXT void (*render_bg)(int line);
+extern THREAD_CONTEXT void (*render_obj)(int line);
+extern THREAD_CONTEXT void (*parse_satb)(int line);
+extern THREAD_CONTEXT void (*update_bg_pattern_cache)(int index);
 
 #endif /* _RENDER_H_ */
 
@@ -129,6 +129,13 @@
 /* execute main opcodes inside a big switch statement */
 #define BIG_SWITCH 1
 
+/* execute all opcodes as threaded code (computed gotos, GCC or Clang only) */
+#if defined(USE_Z80_THREADED_CODE) && defined(__GNUC__)
+#define THREADED_CODE 1
+#else
+#define THREADED_CODE 0
+#endif
+
 #define VERBOSE 0
 
 #if VERBOSE
@@ -201,17 +208,25 @@
 #define IFF2 Z80.iff2
 #define HALT Z80.halt
 
-Z80_Regs Z80;
+THREAD_CONTEXT Z80_Regs Z80;
+
+THREAD_CONTEXT unsigned char *z80_readmap[64];
+THREAD_CONTEXT unsigned char *z80_writemap[64];
 
-unsigned char *z80_readmap[64];
-unsigned char *z80_writemap[64];
+THREAD_CONTEXT void (*z80_writemem)(unsigned int address, unsigned char data);
+THREAD_CONTEXT unsigned char (*z80_readmem)(unsigned int address);
+THREAD_CONTEXT void (*z80_writeport)(unsigned int port, unsigned char data);
+THREAD_CONTEXT unsigned char (*z80_readport)(unsigned int port);
 
-void (*z80_writemem)(unsigned int address, unsigned char data);
-unsigned char (*z80_readmem)(unsigned int address);
-void (*z80_writeport)(unsigned int port, unsigned char data);
-unsigned char (*z80_readport)(unsigned int port);
+static THREAD_CONTEXT UINT32 EA;
 
-static UINT32 EA;
+#if THREADED_CODE
+/* set when IRQ could be taken before next instruction (IRQ line, IFF1 or EI state changes) */
+static THREAD_CONTEXT int irq_check;
+#define IRQ_CHECK irq_check = 1
+#else
+#define IRQ_CHECK
+#endif
 
 static UINT8 SZ[256];       /* zero and sign flags */
 static UINT8 SZ_BIT[256];   /* zero, sign and parity/overflow (=zero) flags for BIT opcode */
@@ -351,7 +366,7 @@ static const UINT16 cc_ex[0x100] = {
  6*15, 0*15, 0*15, 0*15, 7*15, 0*15, 0*15, 2*15, 6*15, 0*15, 0*15, 0*15, 7*15, 0*15, 0*15, 2*15,
  6*15, 0*15, 0*15, 0*15, 7*15, 0*15, 0*15, 2*15, 6*15, 0*15, 0*15, 0*15, 7*15, 0*15, 0*15, 2*15};
 
-static const UINT16 *cc[6];
+static THREAD_CONTEXT const UINT16 *cc[6];
 #define Z80_TABLE_dd  Z80_TABLE_xy
 #define Z80_TABLE_fd  Z80_TABLE_xy
 
@@ -773,6 +788,7 @@ INLINE UINT32 ARG16(void)
   POP( pc ); \
   WZ = PC; \
   IFF1 = IFF2; \
+  IRQ_CHECK; \
 } while (0)
 
 /***************************************************************
@@ -783,6 +799,7 @@ INLINE UINT32 ARG16(void)
   WZ = PC; \
 /* according to http://www.msxnet.org/tech/z80-documented.pdf */ \
   IFF1 = IFF2; \
+  IRQ_CHECK; \
 }
 
 /***************************************************************
@@ -1444,6 +1461,7 @@ INLINE UINT8 SET(UINT8 bit, UINT8 value)
 #define EI {            \
   IFF1 = IFF2 = 1;      \
   Z80.after_ei = TRUE;  \
+  IRQ_CHECK;            \
 }
 
 /**********************************************************
@@ -3279,7 +3297,7 @@ static void take_interrupt(void)
 /****************************************************************************
  * Processor initialization
  ****************************************************************************/
-void z80_init(const void *config, int (*irqcallback)(int))
+static void z80_init_tables(void)
 {
   int i, p;
 
@@ -3353,6 +3371,12 @@ void z80_init(const void *config, int (*irqcallback)(int))
     if( i == 0x7f ) SZHV_dec[i] |= VF;
     if( (i & 0x0f) == 0x0f ) SZHV_dec[i] |= HF;
   }
+}
+
+void z80_init(const void *config, int (*irqcallback)(int))
+{
+  /* flag tables are shared by all emulated CPUs and only need to be initialized once */
+  RUN_ONCE(z80_init_tables);
 
   /* Initialize Z80 */
   memset(&Z80, 0, sizeof(Z80));
@@ -3390,25 +3414,186 @@ void z80_reset(void)
   WZ=PCD;
 }
 
+#if THREADED_CODE
+/***************************************************************
+ * Threaded code: each opcode handler directly jumps to the next
+ * opcode handler (including prefixed opcodes handlers), instead
+ * of returning to a single dispatch loop. IRQs are only checked
+ * when IRQ line, IFF1 or EI state changed since last check.
+ ***************************************************************/
+#define TC_LABEL(prefix,opcode) &&prefix##_l##opcode
+
+#define TC_LABELS(prefix,h) \
+  TC_LABEL(prefix,h##0),TC_LABEL(prefix,h##1),TC_LABEL(prefix,h##2),TC_LABEL(prefix,h##3), \
+  TC_LABEL(prefix,h##4),TC_LABEL(prefix,h##5),TC_LABEL(prefix,h##6),TC_LABEL(prefix,h##7), \
+  TC_LABEL(prefix,h##8),TC_LABEL(prefix,h##9),TC_LABEL(prefix,h##a),TC_LABEL(prefix,h##b), \
+  TC_LABEL(prefix,h##c),TC_LABEL(prefix,h##d),TC_LABEL(prefix,h##e),TC_LABEL(prefix,h##f)
+
+#define TC_TABLE(prefix) \
+static const void *const tc_##prefix[0x100] = { \
+  TC_LABELS(prefix,0),TC_LABELS(prefix,1),TC_LABELS(prefix,2),TC_LABELS(prefix,3), \
+  TC_LABELS(prefix,4),TC_LABELS(prefix,5),TC_LABELS(prefix,6),TC_LABELS(prefix,7), \
+  TC_LABELS(prefix,8),TC_LABELS(prefix,9),TC_LABELS(prefix,a),TC_LABELS(prefix,b), \
+  TC_LABELS(prefix,c),TC_LABELS(prefix,d),TC_LABELS(prefix,e),TC_LABELS(prefix,f) \
+}
+
+/* execute an opcode */
+#define TC_EXEC(prefix,opcode) \
+{                              \
+  op = opcode;                 \
+  CC(prefix,op);               \
+  goto *tc_##prefix[op];       \
+}
+
+/* execute next instruction */
+#define TC_NEXT                           \
+{                                         \
+  if (Z80.cycles >= cycles) goto tc_end;  \
+  if (irq_check) goto tc_irq;             \
+  R++;                                    \
+  TC_EXEC(op,ROP());                      \
+}
+
+/* opcode handler */
+#define TC_OP(prefix,opcode) prefix##_l##opcode: prefix##_##opcode(); TC_NEXT
+
+#define TC_OPS(prefix,h) \
+  TC_OP(prefix,h##0) TC_OP(prefix,h##1) TC_OP(prefix,h##2) TC_OP(prefix,h##3) \
+  TC_OP(prefix,h##4) TC_OP(prefix,h##5) TC_OP(prefix,h##6) TC_OP(prefix,h##7) \
+  TC_OP(prefix,h##8) TC_OP(prefix,h##9) TC_OP(prefix,h##a) TC_OP(prefix,h##b) \
+  TC_OP(prefix,h##c) TC_OP(prefix,h##d) TC_OP(prefix,h##e) TC_OP(prefix,h##f)
+
+/* opcode handlers (all opcodes) */
+#define TC_HANDLERS(prefix) \
+  TC_OPS(prefix,0) TC_OPS(prefix,1) TC_OPS(prefix,2) TC_OPS(prefix,3) \
+  TC_OPS(prefix,4) TC_OPS(prefix,5) TC_OPS(prefix,6) TC_OPS(prefix,7) \
+  TC_OPS(prefix,8) TC_OPS(prefix,9) TC_OPS(prefix,a) TC_OPS(prefix,b) \
+  TC_OPS(prefix,c) TC_OPS(prefix,d) TC_OPS(prefix,e) TC_OPS(prefix,f)
+
+/* DD/FD opcode handlers (DD/FD xx, with DD/FD CB xx, DD/FD DD xx & DD/FD FD xx prefixes) */
+#define TC_HANDLERS_XY(prefix,EAXY) \
+  TC_OPS(prefix,0) TC_OPS(prefix,1) TC_OPS(prefix,2) TC_OPS(prefix,3) \
+  TC_OPS(prefix,4) TC_OPS(prefix,5) TC_OPS(prefix,6) TC_OPS(prefix,7) \
+  TC_OPS(prefix,8) TC_OPS(prefix,9) TC_OPS(prefix,a) TC_OPS(prefix,b) \
+  TC_OP(prefix,c0) TC_OP(prefix,c1) TC_OP(prefix,c2) TC_OP(prefix,c3) \
+  TC_OP(prefix,c4) TC_OP(prefix,c5) TC_OP(prefix,c6) TC_OP(prefix,c7) \
+  TC_OP(prefix,c8) TC_OP(prefix,c9) TC_OP(prefix,ca) \
+  prefix##_lcb: EAXY; TC_EXEC(xycb,ARG()) \
+  TC_OP(prefix,cc) TC_OP(prefix,cd) TC_OP(prefix,ce) TC_OP(prefix,cf) \
+  TC_OP(prefix,d0) TC_OP(prefix,d1) TC_OP(prefix,d2) TC_OP(prefix,d3) \
+  TC_OP(prefix,d4) TC_OP(prefix,d5) TC_OP(prefix,d6) TC_OP(prefix,d7) \
+  TC_OP(prefix,d8) TC_OP(prefix,d9) TC_OP(prefix,da) TC_OP(prefix,db) \
+  TC_OP(prefix,dc) \
+  prefix##_ldd: TC_EXEC(dd,ROP()) \
+  TC_OP(prefix,de) TC_OP(prefix,df) \
+  TC_OPS(prefix,e) \
+  TC_OP(prefix,f0) TC_OP(prefix,f1) TC_OP(prefix,f2) TC_OP(prefix,f3) \
+  TC_OP(prefix,f4) TC_OP(prefix,f5) TC_OP(prefix,f6) TC_OP(prefix,f7) \
+  TC_OP(prefix,f8) TC_OP(prefix,f9) TC_OP(prefix,fa) TC_OP(prefix,fb) \
+  TC_OP(prefix,fc) \
+  prefix##_lfd: TC_EXEC(fd,ROP()) \
+  TC_OP(prefix,fe) TC_OP(prefix,ff)
+
 /****************************************************************************
  * Run until given cycle count 
  ****************************************************************************/
 void z80_run(unsigned int cycles)
 {
+  TC_TABLE(op);
+  TC_TABLE(cb);
+  TC_TABLE(dd);
+  TC_TABLE(ed);
+  TC_TABLE(fd);
+  TC_TABLE(xycb);
+  unsigned int op;
+
+  PROFILE_BEGIN(PROFILE_Z80_RUN);
+
+  if (Z80.cycles >= cycles) goto tc_end;
+
+  /* IRQ line may have been modified since last run */
+  irq_check = 1;
+
+tc_irq:
+  /* check for IRQs before next instruction */
+  if (Z80.irq_state && IFF1 && !Z80.after_ei)
+  {
+    take_interrupt();
+    if (Z80.cycles >= cycles) goto tc_end;
+  }
+
+  /* IRQ can not be taken until IRQ line, IFF1 or EI state is modified */
+  irq_check = Z80.irq_state && IFF1;
+
+  Z80.after_ei = FALSE;
+  R++;
+  TC_EXEC(op,ROP());
+
+  /* main opcodes (with CB xx, DD xx, ED xx & FD xx prefixes) */
+  TC_OPS(op,0) TC_OPS(op,1) TC_OPS(op,2) TC_OPS(op,3)
+  TC_OPS(op,4) TC_OPS(op,5) TC_OPS(op,6) TC_OPS(op,7)
+  TC_OPS(op,8) TC_OPS(op,9) TC_OPS(op,a) TC_OPS(op,b)
+  TC_OP(op,c0) TC_OP(op,c1) TC_OP(op,c2) TC_OP(op,c3)
+  TC_OP(op,c4) TC_OP(op,c5) TC_OP(op,c6) TC_OP(op,c7)
+  TC_OP(op,c8) TC_OP(op,c9) TC_OP(op,ca)
+  op_lcb: R++; TC_EXEC(cb,ROP())
+  TC_OP(op,cc) TC_OP(op,cd) TC_OP(op,ce) TC_OP(op,cf)
+  TC_OP(op,d0) TC_OP(op,d1) TC_OP(op,d2) TC_OP(op,d3)
+  TC_OP(op,d4) TC_OP(op,d5) TC_OP(op,d6) TC_OP(op,d7)
+  TC_OP(op,d8) TC_OP(op,d9) TC_OP(op,da) TC_OP(op,db)
+  TC_OP(op,dc)
+  op_ldd: R++; TC_EXEC(dd,ROP())
+  TC_OP(op,de) TC_OP(op,df)
+  TC_OP(op,e0) TC_OP(op,e1) TC_OP(op,e2) TC_OP(op,e3)
+  TC_OP(op,e4) TC_OP(op,e5) TC_OP(op,e6) TC_OP(op,e7)
+  TC_OP(op,e8) TC_OP(op,e9) TC_OP(op,ea) TC_OP(op,eb)
+  TC_OP(op,ec)
+  op_led: R++; TC_EXEC(ed,ROP())
+  TC_OP(op,ee) TC_OP(op,ef)
+  TC_OP(op,f0) TC_OP(op,f1) TC_OP(op,f2) TC_OP(op,f3)
+  TC_OP(op,f4) TC_OP(op,f5) TC_OP(op,f6) TC_OP(op,f7)
+  TC_OP(op,f8) TC_OP(op,f9) TC_OP(op,fa) TC_OP(op,fb)
+  TC_OP(op,fc)
+  op_lfd: R++; TC_EXEC(fd,ROP())
+  TC_OP(op,fe) TC_OP(op,ff)
+
+  /* CB xx, ED xx & DD/FD CB xx opcodes */
+  TC_HANDLERS(cb)
+  TC_HANDLERS(ed)
+  TC_HANDLERS(xycb)
+
+  /* DD xx & FD xx opcodes */
+  TC_HANDLERS_XY(dd,EAX)
+  TC_HANDLERS_XY(fd,EAY)
+
+tc_end:
+  PROFILE_END(PROFILE_Z80_RUN);
+}
+#else
+/****************************************************************************
+ * Run until given cycle count 
+ ****************************************************************************/
+void z80_run(unsigned int cycles)
+{
+  PROFILE_BEGIN(PROFILE_Z80_RUN);
+
   while( Z80.cycles < cycles )
   {
     /* check for IRQs before each instruction */
     if (Z80.irq_state && IFF1 && !Z80.after_ei)
     {
       take_interrupt();
-      if (Z80.cycles >= cycles) return;
+      if (Z80.cycles >= cycles) break;
     }
 
     Z80.after_ei = FALSE;
     R++;
     EXEC_INLINE(op,ROP());
   }
+
+  PROFILE_END(PROFILE_Z80_RUN);
 } 
+#endif
 
 /****************************************************************************
  * Get all registers in given buffer
@@ -3434,6 +3619,7 @@ void z80_set_context (void *src)
 void z80_set_irq_line(unsigned int state)
 {
   Z80.irq_state = state;
+  IRQ_CHECK;
 }
 
 void z80_set_nmi_line(unsigned int state)
@@ -49,15 +49,15 @@ typedef struct
 }  Z80_Regs;
 
 
-extern Z80_Regs Z80;
+extern THREAD_CONTEXT Z80_Regs Z80;
 
-extern unsigned char *z80_readmap[64];
-extern unsigned char *z80_writemap[64];
+extern THREAD_CONTEXT unsigned char *z80_readmap[64];
+extern THREAD_CONTEXT unsigned char *z80_writemap[64];
 
-extern void (*z80_writemem)(unsigned int address, unsigned char data);
-extern unsigned char (*z80_readmem)(unsigned int address);
-extern void (*z80_writeport)(unsigned int port, unsigned char data);
-extern unsigned char (*z80_readport)(unsigned int port);
+extern THREAD_CONTEXT void (*z80_writemem)(unsigned int address, unsigned char data);
+extern THREAD_CONTEXT unsigned char (*z80_readmem)(unsigned int address);
+extern THREAD_CONTEXT void (*z80_writeport)(unsigned int port, unsigned char data);
+extern THREAD_CONTEXT unsigned char (*z80_readport)(unsigned int port);
 
 extern void z80_init(const void *config, int (*irqcallback)(int));
 extern void z80_reset (void);
@@ -61,6 +61,7 @@ void set_config_defaults(void)
     config.master_clock   = 0; /* = AUTO (1 = NTSC, 2 = PAL) */
     config.force_dtack    = 0;
     config.addr_error     = 1;
+    config.idle_skip      = 0; /* 1 = skip 68k idle loops (cartridge games only) */
     config.bios           = 0;
     config.lock_on        = 0; /* = OFF (can be TYPE_SK, TYPE_GG & TYPE_AR) */
     config.ntsc           = 0;
@@ -651,8 +651,7 @@ static int sdl_control_update(SDLKey keystate)
         if (f)
         {
             uint8 buf[STATE_SIZE];
-            fread(&buf, STATE_SIZE, 1, f);
-            state_load(buf);
+            state_load(buf, fread(&buf, 1, STATE_SIZE, f));
             fclose(f);
         }
         break;
@@ -1663,8 +1662,7 @@ static int gcw0menu(void)
                     if (f)
                     {
                         uint8 buf[STATE_SIZE];
-                        fread(&buf, STATE_SIZE, 1, f);
-                        state_load(buf);
+                        state_load(buf, fread(&buf, 1, STATE_SIZE, f));
                         fclose(f);
                     }
                     if (config.sl_autoresume)
@@ -2183,8 +2181,7 @@ int sdl_input_update(void)
             if (f)
             {
                 uint8 buf[STATE_SIZE];
-                fread(&buf, STATE_SIZE, 1, f);
-                state_load(buf);
+                state_load(buf, fread(&buf, 1, STATE_SIZE, f));
                 fclose(f);
             }
             SDL_Delay(250);
@@ -120,6 +120,7 @@ void config_default(void)
   config.master_clock   = 0; /* AUTO */
   config.force_dtack    = 0;
   config.addr_error     = 1;
+  config.idle_skip      = 0;
   config.bios           = 0;
   config.lock_on        = 0;
   config.hot_swap       = 0;
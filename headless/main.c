@@ -0,0 +1,1065 @@
+/*
+    main.c --
+    Headless benchmark runner (no video, sound or input device required)
+*/
+
+#ifdef __WIN32__
+#include <windows.h>
+#else
+#define _POSIX_C_SOURCE 199309L
+#include <time.h>
+#include <sys/types.h>
+#include <sys/wait.h>
+#include <unistd.h>
+#endif
+
+#include "osd.h"
+#include "sms_ntsc.h"
+#include "md_ntsc.h"
+#include <zlib.h>
+
+#define SOUND_FREQUENCY 48000
+#define SOUND_SAMPLES_SIZE  2048
+
+#define DEFAULT_FRAMES 3600
+
+/* savestate benchmark */
+#define STATE_NONE  0
+#define STATE_FULL  1
+#define STATE_DELTA 2
+
+int log_error = 0;
+
+/* NTSC filters are not used */
+md_ntsc_t *md_ntsc;
+sms_ntsc_t *sms_ntsc;
+
+/* 720x576 framebuffer, 16-bit pixels */
+static uint16 framebuffer[720 * 576];
+
+static short soundframe[SOUND_SAMPLES_SIZE];
+
+/* current emulated frame */
+static int frame_count;
+
+/* current session (session farm) */
+static int session = -1;
+
+/* scripted input */
+typedef struct
+{
+  int frame;
+  int port;
+  uint16 pad;
+} t_input_event;
+
+static struct
+{
+  t_input_event *events;
+  int count;
+  int next;
+} script;
+
+static double get_time(void)
+{
+#ifdef __WIN32__
+  LARGE_INTEGER freq, count;
+  QueryPerformanceFrequency(&freq);
+  QueryPerformanceCounter(&count);
+  return (double)count.QuadPart / (double)freq.QuadPart;
+#else
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return (double)ts.tv_sec + (double)ts.tv_nsec / 1000000000.0;
+#endif
+}
+
+static int compare_time(const void *a, const void *b)
+{
+  double ta = *(const double *)a;
+  double tb = *(const double *)b;
+  return (ta > tb) - (ta < tb);
+}
+
+/* Input script is a text file with one event per line:
+ *
+ *   <frame> <port> <buttons>
+ *
+ * where <buttons> is a combination of INPUT_* flags (hex allowed, e.g 0x80 = START)
+ * which is applied to the given input port from that frame until the next event on
+ * the same port. Empty lines and lines starting with '#' are ignored.
+ */
+static int script_load(const char *filename)
+{
+  char line[256];
+  int max = 0;
+  FILE *fp = fopen(filename, "r");
+  if (!fp) return 0;
+
+  while (fgets(line, sizeof(line), fp))
+  {
+    long frame, port, pad;
+    char *ptr = line, *end;
+
+    while ((*ptr == ' ') || (*ptr == '\t')) ptr++;
+    if ((*ptr == '#') || (*ptr == '\n') || (*ptr == '\r') || (*ptr == 0)) continue;
+
+    frame = strtol(ptr, &end, 0);
+    if (end == ptr) break;
+    ptr = end;
+    port = strtol(ptr, &end, 0);
+    if (end == ptr) break;
+    ptr = end;
+    pad = strtol(ptr, &end, 0);
+    if (end == ptr) break;
+
+    if ((frame < 0) || (port < 0) || (port >= MAX_DEVICES)) break;
+
+    /* events must be sorted by frame number */
+    if (script.count && (frame < script.events[script.count - 1].frame)) break;
+
+    if (script.count == max)
+    {
+      t_input_event *events;
+      max = max ? (max * 2) : 64;
+      events = (t_input_event *)realloc(script.events, max * sizeof(t_input_event));
+      if (!events) break;
+      script.events = events;
+    }
+
+    script.events[script.count].frame = frame;
+    script.events[script.count].port = port;
+    script.events[script.count].pad = pad & 0xffff;
+    script.count++;
+  }
+
+  /* check if all lines were parsed */
+  if (!feof(fp))
+  {
+    fclose(fp);
+    return 0;
+  }
+
+  fclose(fp);
+  script.next = 0;
+  return 1;
+}
+
+int headless_input_update(void)
+{
+  /* recorded inputs */
+  if (movie.mode == MOVIE_PLAY)
+  {
+    movie_input();
+    return 1;
+  }
+
+  /* apply all events scheduled up to current frame */
+  while ((script.next < script.count) && (script.events[script.next].frame <= frame_count))
+  {
+    input.pad[script.events[script.next].port] = script.events[script.next].pad;
+    script.next++;
+  }
+
+  return 1;
+}
+
+static uint32 framebuffer_crc(void)
+{
+  int y;
+  uLong crc = crc32(0L, Z_NULL, 0);
+
+  /* displayed area, including borders */
+  int width  = bitmap.viewport.w + 2 * bitmap.viewport.x;
+  int height = bitmap.viewport.h + 2 * bitmap.viewport.y;
+
+  for (y = 0; y < height; y++)
+  {
+    crc = crc32(crc, bitmap.data + y * bitmap.pitch, width * 2);
+  }
+
+  return crc;
+}
+
+/* Savestates include host pointers (sound chip & CPU contexts) so their raw content
+ * changes from one run to another: only emulated memories & CPU registers are checked.
+ */
+static uint32 state_crc(void)
+{
+  int i;
+  uint32 regs[18];
+  uLong crc = crc32(0L, Z_NULL, 0);
+
+  crc = crc32(crc, work_ram, sizeof(work_ram));
+  crc = crc32(crc, zram, sizeof(zram));
+  crc = crc32(crc, vram, sizeof(vram));
+  crc = crc32(crc, cram, sizeof(cram));
+  crc = crc32(crc, vsram, sizeof(vsram));
+  crc = crc32(crc, reg, sizeof(reg));
+
+  if ((system_hw & SYSTEM_PBC) == SYSTEM_MD)
+  {
+    for (i=0; i<17; i++)
+    {
+      regs[i] = m68k_get_reg(M68K_REG_D0 + i);
+    }
+    regs[17] = m68k_get_reg(M68K_REG_SR);
+    crc = crc32(crc, (const Bytef *)regs, sizeof(regs));
+  }
+
+  crc = crc32(crc, (const Bytef *)&Z80, (uLong)((uint8 *)&Z80.daisy - (uint8 *)&Z80));
+
+  if (system_hw == SYSTEM_MCD)
+  {
+    for (i=0; i<17; i++)
+    {
+      regs[i] = s68k_get_reg(M68K_REG_D0 + i);
+    }
+    regs[17] = s68k_get_reg(M68K_REG_SR);
+    crc = crc32(crc, (const Bytef *)regs, sizeof(regs));
+    crc = crc32(crc, (const Bytef *)scd.regs, sizeof(scd.regs));
+    crc = crc32(crc, scd.pcm_hw.ram, sizeof(scd.pcm_hw.ram));
+    crc = crc32(crc, scd.prg_ram, sizeof(scd.prg_ram));
+    crc = crc32(crc, (const Bytef *)scd.word_ram, sizeof(scd.word_ram));
+    crc = crc32(crc, scd.word_ram_2M, sizeof(scd.word_ram_2M));
+  }
+
+  return crc;
+}
+
+#ifdef USE_PROFILER
+static void profile_print(const t_profile *total, int frames, double time)
+{
+  int i;
+
+  printf("Profile   : average per frame (%% of total time)\n");
+  for (i=0; i<PROFILE_MAX; i++)
+  {
+    if (total->func[i].calls)
+    {
+      printf("  %-24s %8.3f ms (%5.1f %%) %8u calls\n", profile_name(i),
+             (total->func[i].time * 1000.0) / frames, (total->func[i].time * 100.0) / time,
+             total->func[i].calls / frames);
+    }
+  }
+  printf("  VDP port writes %u, DMA words %u\n", total->vdp_writes / frames, total->dma_words / frames);
+}
+#endif
+
+static void frame_run(int do_skip)
+{
+  if (system_hw == SYSTEM_MCD)
+  {
+    system_frame_scd(do_skip);
+  }
+  else if ((system_hw & SYSTEM_PBC) == SYSTEM_MD)
+  {
+    system_frame_gen(do_skip);
+  }
+  else
+  {
+    system_frame_sms(do_skip);
+  }
+}
+
+#ifndef __WIN32__
+/* Session farm: game is loaded & booted once then each session runs in a forked worker
+ * process, starting from the booted state. ROM data, lookup tables & emulated memories
+ * are shared copy-on-write with the parent so only pages modified by a session are
+ * duplicated. Returns the session number in workers and -1 in parent once all sessions
+ * have ended (number of failed sessions is returned in 'failed').
+ */
+static int farm_run(int sessions, int jobs, double boot_time, int *failed)
+{
+  int i, running = 0;
+  double start = get_time();
+
+  /* pending output would otherwise be written again by each worker */
+  fflush(stdout);
+  fflush(stderr);
+
+  for (i=0; (i<sessions) || running; i++)
+  {
+    int status;
+
+    /* wait for a worker to end when all jobs are running or all sessions were started */
+    if ((running == jobs) || (i >= sessions))
+    {
+      if (waitpid(-1, &status, 0) < 0) break;
+      if (!WIFEXITED(status) || WEXITSTATUS(status)) (*failed)++;
+      running--;
+      if (i >= sessions) continue;
+    }
+
+    switch (fork())
+    {
+      case -1:
+        fprintf(stderr, "Can't start session %d.\n", i);
+        (*failed)++;
+        break;
+
+      case 0:
+        /* worker report is written at once when it exits */
+        setvbuf(stdout, NULL, _IOFBF, 4096);
+        return i;
+
+      default:
+        running++;
+        break;
+    }
+  }
+
+  start = get_time() - start;
+  printf("Farm      : %d sessions (%d failed), %d jobs\n", sessions, *failed, jobs);
+  printf("Boot time : %.3f ms\n", boot_time * 1000.0);
+  printf("Farm time : %.3f s, %.1f sessions/s\n", start, sessions / start);
+  return -1;
+}
+#endif
+
+#ifdef USE_THREAD_CONTEXT
+/* Thread context check: other consoles run the same frames at the same time as the main
+ * console, each one on its own thread and starting from the main console booted state.
+ * They should all end in the same state as the main console.
+ */
+typedef struct
+{
+  pthread_t thread;
+  char *rom;
+  unsigned char *state;
+  int state_size;
+  int frames;
+  int video_enabled;
+  int sound_enabled;
+  int idle_enabled;
+  int started;
+  int done;
+  uint32 video;
+  uint32 audio;
+  uint32 state_crc;
+} t_instance;
+
+static void *instance_run(void *arg)
+{
+  t_instance *instance = (t_instance *)arg;
+  short *samples = (short *)malloc(SOUND_SAMPLES_SIZE * sizeof(short));
+  uint8 *data = (uint8 *)malloc(720 * 576 * 2);
+  uLong crc = crc32(0L, Z_NULL, 0);
+  int i;
+
+  /* each console has its own framebuffer */
+  memset(&bitmap, 0, sizeof(t_bitmap));
+  bitmap.width        = 720;
+  bitmap.height       = 576;
+  bitmap.pitch        = (bitmap.width * 2);
+  bitmap.data         = data;
+  bitmap.viewport.changed = 3;
+
+  if (samples && data && load_rom(instance->rom))
+  {
+    audio_init(SOUND_FREQUENCY, 0);
+    snd.enabled = instance->sound_enabled;
+    system_init();
+    system_reset();
+    m68k.skip.enabled = instance->idle_enabled;
+
+    if (state_load(instance->state, instance->state_size))
+    {
+      for (i=0; i<instance->frames; i++)
+      {
+        frame_run(!instance->video_enabled);
+        crc = crc32(crc, (const Bytef *)samples, audio_update(samples) * 2 * sizeof(short));
+      }
+
+      instance->video = framebuffer_crc();
+      instance->audio = crc;
+      instance->state_crc = state_crc();
+      instance->done = 1;
+    }
+
+    audio_shutdown();
+    system_shutdown();
+  }
+
+  free(samples);
+  free(data);
+  return NULL;
+}
+#endif
+
+/* File names used by sessions may include the session number */
+static char *session_name(char *buf, char *name)
+{
+  if ((session >= 0) && strchr(name, '%') && (strlen(name) < 240))
+  {
+    sprintf(buf, name, session);
+    return buf;
+  }
+
+  return name;
+}
+
+static void usage(char *name)
+{
+  printf("Genesis Plus GX\\Headless\n");
+  printf("usage: %s [-frames N] [-input script.txt] [-state full|delta] [-cdz file] gamename\n", name);
+  printf("  -frames N   number of frames to emulate (default %d)\n", DEFAULT_FRAMES);
+  printf("  -input file scripted input (one '<frame> <port> <buttons>' event per line)\n");
+  printf("  -record file record input movie (from power-on, or from savestate after boot frames)\n");
+  printf("  -movie file replay input movie and check recorded state hashes\n");
+  printf("  -state mode save full or incremental state after each frame\n");
+  printf("              (state rebuilt from incremental states is checked against a full state)\n");
+  printf("  -cdz file   compress CD image to CDZ file then exit\n");
+  printf("  -boot N     emulate N frames without input before the measured frames\n");
+#ifndef __WIN32__
+  printf("  -farm N     run N sessions in worker processes forked from the booted state\n");
+  printf("              (input script & recorded movie names may include %%d for session number)\n");
+  printf("  -jobs N     number of concurrent sessions (default 1)\n");
+#endif
+#ifdef USE_THREAD_CONTEXT
+  printf("  -instances N run N other consoles on separate threads at the same time and compare with main console\n");
+#endif
+#ifdef USE_RENDER_THREAD
+  printf("  -thread     render Mode 5 scanlines on a worker thread\n");
+#endif
+  printf("  -noidle     disable 68k idle loop skipping\n");
+  printf("  -nosound    disable sound output (sound chips are still emulated)\n");
+  printf("  -novideo    disable video output (VDP sprite status flags are still emulated)\n");
+#ifdef USE_M68K_JIT
+  printf("  -nojit      disable 68k block translation\n");
+#endif
+  printf("  -verify     run each frame twice, with and without 68k idle loop skipping (and block translation), and compare\n");
+  printf("              (second run always renders the frame, so -novideo status emulation is checked as well)\n");
+  printf("  -runahead   run each frame ahead then again from restored savestate (as with libretro run-ahead), and compare\n");
+}
+
+int main (int argc, char **argv)
+{
+  FILE *fp;
+  int i, frames = DEFAULT_FRAMES, state_mode = STATE_NONE, render_thread = 0;
+  int boot_frames = 0, sessions = 0, jobs = 1, failed = 0;
+  int verify = 0, verify_errors = 0;
+  int runahead = 0, runahead_errors = 0;
+  int instances = 0, instance_errors = 0;
+  int idle_enabled = 1;
+  int sound_enabled = 1;
+  int video_enabled = 1;
+  double idle_cycles = 0.0;
+#ifdef USE_M68K_JIT
+  int jit_enabled = 1;
+#endif
+  char *rom = NULL, *input_file = NULL, *cdz_file = NULL;
+  char *movie_file = NULL, *record_file = NULL;
+  char input_name[256], record_name[256];
+  double *frame_time, total, start, boot_time, state_time = 0.0;
+  double state_bytes = 0.0;
+  unsigned char *state_buf = NULL;
+  unsigned char *verify_buf = NULL;
+  unsigned char *chain_buf = NULL;
+  unsigned char *full_buf = NULL;
+  unsigned char *runahead_buf = NULL;
+  int chain_errors = 0;
+  t_movie verify_movie;
+  t_movie runahead_movie;
+  uLong audio_crc;
+#ifdef USE_THREAD_CONTEXT
+  t_instance *instance = NULL;
+  unsigned char *instance_buf = NULL;
+#endif
+#ifdef USE_PROFILER
+  t_profile profile_total, profile_frame;
+#endif
+
+  /* parse command line */
+  for (i=1; i<argc; i++)
+  {
+    if (!strcmp(argv[i], "-frames") && (i < (argc - 1)))
+    {
+      frames = atoi(argv[++i]);
+    }
+    else if (!strcmp(argv[i], "-input") && (i < (argc - 1)))
+    {
+      input_file = argv[++i];
+    }
+    else if (!strcmp(argv[i], "-record") && (i < (argc - 1)))
+    {
+      record_file = argv[++i];
+    }
+    else if (!strcmp(argv[i], "-movie") && (i < (argc - 1)))
+    {
+      movie_file = argv[++i];
+    }
+    else if (!strcmp(argv[i], "-state") && (i < (argc - 1)))
+    {
+      i++;
+      if (!strcmp(argv[i], "full"))
+      {
+        state_mode = STATE_FULL;
+      }
+      else if (!strcmp(argv[i], "delta"))
+      {
+        state_mode = STATE_DELTA;
+      }
+      else
+      {
+        usage(argv[0]);
+        return 1;
+      }
+    }
+    else if (!strcmp(argv[i], "-cdz") && (i < (argc - 1)))
+    {
+      cdz_file = argv[++i];
+    }
+    else if (!strcmp(argv[i], "-boot") && (i < (argc - 1)))
+    {
+      boot_frames = atoi(argv[++i]);
+    }
+#ifndef __WIN32__
+    else if (!strcmp(argv[i], "-farm") && (i < (argc - 1)))
+    {
+      sessions = atoi(argv[++i]);
+    }
+    else if (!strcmp(argv[i], "-jobs") && (i < (argc - 1)))
+    {
+      jobs = atoi(argv[++i]);
+    }
+#endif
+#ifdef USE_THREAD_CONTEXT
+    else if (!strcmp(argv[i], "-instances") && (i < (argc - 1)))
+    {
+      instances = atoi(argv[++i]);
+    }
+#endif
+#ifdef USE_RENDER_THREAD
+    else if (!strcmp(argv[i], "-thread"))
+    {
+      render_thread = 1;
+    }
+#endif
+    else if (!strcmp(argv[i], "-noidle"))
+    {
+      idle_enabled = 0;
+    }
+    else if (!strcmp(argv[i], "-nosound"))
+    {
+      sound_enabled = 0;
+    }
+    else if (!strcmp(argv[i], "-novideo"))
+    {
+      video_enabled = 0;
+    }
+#ifdef USE_M68K_JIT
+    else if (!strcmp(argv[i], "-nojit"))
+    {
+      jit_enabled = 0;
+    }
+#endif
+    else if (!strcmp(argv[i], "-verify"))
+    {
+      verify = 1;
+    }
+    else if (!strcmp(argv[i], "-runahead"))
+    {
+      runahead = 1;
+    }
+    else if (argv[i][0] != '-')
+    {
+      rom = argv[i];
+    }
+    else
+    {
+      usage(argv[0]);
+      return 1;
+    }
+  }
+
+  if (!rom || (frames <= 0) || (boot_frames < 0) || (sessions < 0) || (jobs <= 0) || (movie_file && (input_file || record_file)) ||
+      (instances < 0) || (instances && (input_file || movie_file || record_file)))
+  {
+    usage(argv[0]);
+    return 1;
+  }
+
+  /* set default config */
+  error_init();
+  set_config_defaults();
+
+  /* movie is played with recorded settings */
+  if (movie_file && !movie_load(movie_file))
+  {
+    fprintf(stderr, "Error loading input movie `%s'.\n", movie_file);
+    return 1;
+  }
+
+  /* mark all BIOS as unloaded */
+  system_bios = 0;
+
+  /* Genesis BOOT ROM support (2KB max) */
+  memset(boot_rom, 0xFF, 0x800);
+  fp = fopen(MD_BIOS, "rb");
+  if (fp != NULL)
+  {
+    /* read BOOT ROM */
+    fread(boot_rom, 1, 0x800, fp);
+    fclose(fp);
+
+    /* check BOOT ROM */
+    if (!memcmp((char *)(boot_rom + 0x120),"GENESIS OS", 10))
+    {
+      /* mark Genesis BIOS as loaded */
+      system_bios = SYSTEM_MD;
+    }
+
+    /* Byteswap ROM */
+    for (i=0; i<0x800; i+=2)
+    {
+      uint8 temp = boot_rom[i];
+      boot_rom[i] = boot_rom[i+1];
+      boot_rom[i+1] = temp;
+    }
+  }
+
+  /* initialize Genesis virtual system */
+  memset(&bitmap, 0, sizeof(t_bitmap));
+  bitmap.width        = 720;
+  bitmap.height       = 576;
+  bitmap.pitch        = (bitmap.width * 2);
+  bitmap.data         = (uint8 *)framebuffer;
+  bitmap.viewport.changed = 3;
+
+  /* compress CD image */
+  if (cdz_file)
+  {
+    /* only CD image is needed (CD BIOS is not loaded) */
+#ifdef USE_DYNAMIC_ALLOC
+    if (!ext) ext = (external_t *)malloc(sizeof(external_t));
+#endif
+    if ((cdd_load(rom, (char *)cdc.ram) <= 0) || !cdz_create(cdz_file))
+    {
+      fprintf(stderr, "Error compressing CD image `%s'.\n", rom);
+      return 1;
+    }
+    printf("CDZ image : %s\n", cdz_file);
+    return 0;
+  }
+
+  /* Load game file */
+  boot_time = get_time();
+  if(!load_rom(rom))
+  {
+    fprintf(stderr, "Error loading file `%s'.\n", rom);
+    return 1;
+  }
+
+  /* initialize system hardware */
+  audio_init(SOUND_FREQUENCY, 0);
+  snd.enabled = sound_enabled;
+  system_init();
+
+  /* reset system hardware */
+  system_reset();
+
+  /* idle loop skipping is only enabled with cartridge hardware */
+  idle_enabled &= m68k.skip.enabled;
+  m68k.skip.enabled = idle_enabled;
+
+#ifdef USE_M68K_JIT
+  m68k_jit_enable(jit_enabled);
+#endif
+
+  /* boot frames are not displayed */
+  for (frame_count=0; frame_count<boot_frames; frame_count++)
+  {
+    frame_run(1);
+    audio_update(soundframe);
+  }
+  boot_time = get_time() - boot_time;
+
+#ifndef __WIN32__
+  if (sessions)
+  {
+#ifdef USE_CD_THREAD
+    /* CD reader & decoder threads are not duplicated in forked processes */
+    if (system_hw == SYSTEM_MCD)
+    {
+      fprintf(stderr, "Session farm not available with CD background threads.\n");
+      return 1;
+    }
+#endif
+    session = farm_run(sessions, jobs, boot_time, &failed);
+    if (session < 0)
+    {
+      movie_stop();
+      system_shutdown();
+      error_shutdown();
+      return failed ? 1 : 0;
+    }
+  }
+#endif
+
+  /* each session can use its own input script */
+  if (input_file && !script_load(input_file = session_name(input_name, input_file)))
+  {
+    fprintf(stderr, "Error loading input script `%s'.\n", input_file);
+    return 1;
+  }
+
+  if (movie_file)
+  {
+    if (!movie_start())
+    {
+      fprintf(stderr, "Input movie `%s' was recorded with another game.\n", movie_file);
+      return 1;
+    }
+
+    /* whole movie is played */
+    frames = movie.frames;
+    if (!frames)
+    {
+      fprintf(stderr, "Input movie `%s' is empty.\n", movie_file);
+      return 1;
+    }
+  }
+
+  /* movie starts from power-on or from current state */
+  if (record_file && !movie_record(record_file = session_name(record_name, record_file), boot_frames ? MOVIE_STATE : MOVIE_POWER_ON, MOVIE_HASH_INTERVAL))
+  {
+    fprintf(stderr, "Error creating input movie `%s'.\n", record_file);
+    return 1;
+  }
+
+  frame_time = (double *)malloc(frames * sizeof(double));
+  if (state_mode != STATE_NONE)
+  {
+    state_buf = (unsigned char *)malloc(STATE_SIZE);
+  }
+  if (state_mode == STATE_DELTA)
+  {
+    chain_buf = (unsigned char *)malloc(STATE_SIZE);
+    full_buf = (unsigned char *)malloc(STATE_SIZE);
+  }
+  if (verify)
+  {
+    verify_buf = (unsigned char *)malloc(STATE_SIZE);
+  }
+  if (runahead)
+  {
+    runahead_buf = (unsigned char *)malloc(STATE_SIZE);
+  }
+  if (!frame_time || ((state_mode != STATE_NONE) && !state_buf) || (verify && !verify_buf) ||
+      ((state_mode == STATE_DELTA) && (!chain_buf || !full_buf)) || (runahead && !runahead_buf))
+  {
+    fprintf(stderr, "Can't allocate memory.\n");
+    return 1;
+  }
+
+#ifdef USE_RENDER_THREAD
+  if (render_thread && !render_thread_start())
+  {
+    fprintf(stderr, "Render thread not available, rendering inline.\n");
+    render_thread = 0;
+  }
+#endif
+
+#ifdef USE_THREAD_CONTEXT
+  /* other consoles start from current state */
+  if (instances)
+  {
+    int size;
+    instance = (t_instance *)calloc(instances, sizeof(t_instance));
+    instance_buf = (unsigned char *)malloc(STATE_SIZE);
+    if (!instance || !instance_buf)
+    {
+      fprintf(stderr, "Can't allocate memory.\n");
+      return 1;
+    }
+
+    size = state_save(instance_buf);
+    for (i=0; i<instances; i++)
+    {
+      instance[i].rom = rom;
+      instance[i].state = instance_buf;
+      instance[i].state_size = size;
+      instance[i].frames = frames;
+      instance[i].video_enabled = video_enabled;
+      instance[i].sound_enabled = sound_enabled;
+      instance[i].idle_enabled = idle_enabled;
+      instance[i].started = !pthread_create(&instance[i].thread, NULL, instance_run, &instance[i]);
+    }
+  }
+#endif
+
+  /* incremental savestates are based on an initial full savestate */
+  if (state_mode == STATE_DELTA)
+  {
+    state_save(chain_buf);
+  }
+
+  /* emulation loop */
+#ifdef USE_PROFILER
+  profile_get(&profile_frame);
+  memset(&profile_total, 0, sizeof(profile_total));
+#endif
+  audio_crc = crc32(0L, Z_NULL, 0);
+  total = get_time();
+  for (frame_count=0; frame_count<frames; frame_count++)
+  {
+    int size;
+    uint32 ahead_video = 0, ahead_state = 0, ahead_cycles = 0;
+
+    /* frame is first run ahead with muted audio, then run again from restored savestate */
+    if (runahead)
+    {
+      state_save(runahead_buf);
+      runahead_movie = movie;
+      audio_mute(1);
+      frame_run(!video_enabled);
+      audio_update(soundframe);
+      ahead_video = video_enabled ? framebuffer_crc() : 0;
+      ahead_state = state_crc();
+      ahead_cycles = m68k.cycles;
+      state_restore(runahead_buf, STATE_SIZE);
+      movie = runahead_movie;
+      audio_mute(0);
+    }
+
+    /* both runs start from the same loaded savestate */
+    if (verify)
+    {
+      state_save(verify_buf);
+      state_load(verify_buf, STATE_SIZE);
+      verify_movie = movie;
+    }
+
+    start = get_time();
+
+    frame_run(!video_enabled);
+
+    /* sound chips are only run to the end of the frame when audio is updated */
+    size = audio_update(soundframe) * 2;
+
+    frame_time[frame_count] = get_time() - start;
+
+    if (state_mode != STATE_NONE)
+    {
+      int state_len;
+
+      start = get_time();
+      state_len = (state_mode == STATE_FULL) ? state_save(state_buf) : state_save_delta(state_buf);
+      state_time += get_time() - start;
+      state_bytes += state_len;
+
+      /* full savestate rebuilt from the chain of incremental savestates should match current full savestate */
+      if (state_mode == STATE_DELTA)
+      {
+        int full_size = state_save(full_buf);
+        uint8 viewport[sizeof(bitmap.viewport)];
+
+        memcpy(viewport, &bitmap.viewport, sizeof(bitmap.viewport));
+        audio_mute(1);
+        state_restore(chain_buf, STATE_SIZE);
+        state_load_delta(state_buf, state_len);
+        if ((state_save(chain_buf) != full_size) || memcmp(chain_buf, full_buf, full_size))
+        {
+          if (!chain_errors)
+          {
+            fprintf(stderr, "Incremental savestate mismatch at frame %d\n", frame_count);
+          }
+          chain_errors++;
+        }
+        state_restore(full_buf, full_size);
+        audio_mute(0);
+
+        /* display area is only updated from VDP registers on next frame */
+        memcpy(&bitmap.viewport, viewport, sizeof(bitmap.viewport));
+      }
+    }
+
+#ifdef USE_PROFILER
+    profile_get(&profile_frame);
+    profile_add(&profile_total, &profile_frame);
+#endif
+
+    audio_crc = crc32(audio_crc, (const Bytef *)soundframe, size * sizeof(short));
+
+    idle_cycles += m68k.skip.skipped;
+    m68k.skip.skipped = 0;
+
+    /* both runs should end in the same state */
+    if (runahead)
+    {
+      if ((video_enabled && (framebuffer_crc() != ahead_video)) || (state_crc() != ahead_state) ||
+          (((system_hw & SYSTEM_PBC) == SYSTEM_MD) && (m68k.cycles != ahead_cycles)))
+      {
+        if (!runahead_errors)
+        {
+          fprintf(stderr, "Run-ahead mismatch at frame %d\n", frame_count);
+        }
+        runahead_errors++;
+      }
+    }
+
+    /* run same frame again with 68k interpreter only and full rendering, both runs should end in the same state */
+    if (verify)
+    {
+      uint32 video = framebuffer_crc();
+      uint32 state = state_crc();
+      uint32 cycles = m68k.cycles;
+
+      state_load(verify_buf, STATE_SIZE);
+      movie = verify_movie;
+      m68k.skip.enabled = 0;
+#ifdef USE_M68K_JIT
+      m68k_jit_enable(0);
+#endif
+      frame_run(0);
+      audio_update(soundframe);
+#ifdef USE_M68K_JIT
+      m68k_jit_enable(jit_enabled);
+#endif
+      m68k.skip.enabled = idle_enabled;
+
+      /* framebuffer is not updated by first run when video is disabled, 68k cycles are only used by Mega Drive hardware */
+      if ((video_enabled && (framebuffer_crc() != video)) || (state_crc() != state) ||
+          (((system_hw & SYSTEM_PBC) == SYSTEM_MD) && (m68k.cycles != cycles)))
+      {
+        if (!verify_errors)
+        {
+          fprintf(stderr, "68k mismatch at frame %d\n", frame_count);
+        }
+        verify_errors++;
+      }
+    }
+
+    /* record inputs or check recorded state hash */
+    movie_frame();
+  }
+  total = get_time() - total;
+
+#ifdef USE_THREAD_CONTEXT
+  /* compare other consoles with main console */
+  for (i=0; i<instances; i++)
+  {
+    if (instance[i].started)
+    {
+      pthread_join(instance[i].thread, NULL);
+    }
+
+    if (!instance[i].done || (video_enabled && (instance[i].video != framebuffer_crc())) ||
+        (sound_enabled && (instance[i].audio != audio_crc)) || (instance[i].state_crc != state_crc()))
+    {
+      instance_errors++;
+    }
+  }
+#endif
+
+  /* report */
+  qsort(frame_time, frames, sizeof(double), compare_time);
+  if (session >= 0)
+  {
+    printf("Session   : %d\n", session);
+  }
+  printf("Game      : %s\n", (rominfo.international[0] != 0x20) ? rominfo.international : rominfo.domestic);
+  printf("Frames    : %d (%s)\n", frames, vdp_pal ? "PAL" : "NTSC");
+  if (render_thread)
+  {
+    printf("Rendering : worker thread\n");
+  }
+  printf("Time      : %.3f s\n", total);
+  printf("Speed     : %.1f fps (%.1f %%)\n", frames / total, (frames / total) * 100.0 / (vdp_pal ? 50.0 : 60.0));
+  printf("Frame time: min %.3f ms, median %.3f ms, p99 %.3f ms, max %.3f ms\n",
+         frame_time[0] * 1000.0,
+         frame_time[frames / 2] * 1000.0,
+         frame_time[((frames * 99) + 99) / 100 - 1] * 1000.0,
+         frame_time[frames - 1] * 1000.0);
+  if (video_enabled)
+  {
+    printf("Video CRC : %08lx\n", (unsigned long)framebuffer_crc());
+  }
+  else
+  {
+    printf("Video CRC : disabled\n");
+  }
+  if (sound_enabled)
+  {
+    printf("Audio CRC : %08lx\n", (unsigned long)audio_crc);
+  }
+  else
+  {
+    printf("Audio CRC : disabled\n");
+  }
+  printf("State CRC : %08lx\n", (unsigned long)state_crc());
+  if (state_mode != STATE_NONE)
+  {
+    printf("Savestate : %s, average %.0f bytes, %.3f ms\n", (state_mode == STATE_FULL) ? "full" : "delta",
+           state_bytes / frames, (state_time * 1000.0) / frames);
+  }
+  if (idle_enabled)
+  {
+    printf("Idle skip : %.1f %% of 68k cycles\n", (idle_cycles * 100.0) / ((double)frames * lines_per_frame * MCYCLES_PER_LINE));
+  }
+  if (verify)
+  {
+    printf("Verify    : %d mismatching frames\n", verify_errors);
+  }
+  if (runahead)
+  {
+    printf("Run-ahead : %d mismatching frames\n", runahead_errors);
+    verify_errors += runahead_errors;
+  }
+  if (state_mode == STATE_DELTA)
+  {
+    printf("Delta     : %d frames not matching full savestate\n", chain_errors);
+    verify_errors += chain_errors;
+  }
+  if (instances)
+  {
+    printf("Instances : %d other consoles on separate threads, %d mismatching\n", instances, instance_errors);
+    verify_errors += instance_errors;
+  }
+  if (movie.mode == MOVIE_RECORD)
+  {
+    printf("Movie     : %s, %d frames recorded\n", record_file, movie.frame);
+  }
+  else if (movie.mode == MOVIE_PLAY)
+  {
+    printf("Movie     : %s, %u state hashes checked, %u mismatching", movie_file, movie.hash_checks, movie.hash_errors);
+    if (movie.hash_errors)
+    {
+      printf(" (first at frame %u)", movie.hash_error_frame);
+    }
+    printf("\n");
+    verify_errors += movie.hash_errors;
+  }
+  if (system_hw == SYSTEM_MCD)
+  {
+    uint32 hits, misses;
+    cdd_cache_stats(&hits, &misses);
+    printf("CD cache  : %u hits, %u misses\n", hits, misses);
+  }
+#ifdef USE_PROFILER
+  profile_print(&profile_total, frames, total);
+#endif
+
+#ifdef USE_RENDER_THREAD
+  render_thread_stop();
+#endif
+  movie_stop();
+  audio_shutdown();
+  system_shutdown();
+  error_shutdown();
+
+  free(script.events);
+  free(frame_time);
+  free(state_buf);
+  free(verify_buf);
+  free(chain_buf);
+  free(full_buf);
+  free(runahead_buf);
+#ifdef USE_THREAD_CONTEXT
+  free(instance);
+  free(instance_buf);
+#endif
+
+  return verify_errors ? 1 : 0;
+}
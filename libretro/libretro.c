@@ -33,6 +33,7 @@
 #include "libretro.h"
 #include "md_ntsc.h"
 #include "sms_ntsc.h"
+#include "rewind.h"
 
 sms_ntsc_t *sms_ntsc;
 md_ntsc_t  *md_ntsc;
@@ -67,13 +68,20 @@ static uint8_t brm_format[0x40] =
 };
 
 static bool is_running = 0;
+static unsigned rewind_size = 0;
+static unsigned runahead_frames = 0;
+static uint8_t *runahead_state = NULL;
+static size_t serialize_size = STATE_SIZE;
 static uint8_t temp[0x10000];
 static int16 soundbuffer[3068];
+static int16 runahead_soundbuffer[3068];
 static uint16_t bitmap_data_[720 * 576];
 static const double pal_fps = 53203424.0 / (3420.0 * 313.0);
 static const double ntsc_fps = 53693175.0 / (3420.0 * 262.0);
 
 static char g_rom_dir[1024];
+static char g_movie_base[1024];
+static bool movie_requested = false;
 
 static retro_log_printf_t log_cb;
 static retro_video_refresh_t video_cb;
@@ -473,6 +481,7 @@ static void config_default(void)
    config.master_clock   = 0; /* AUTO */
    config.force_dtack    = 0;
    config.addr_error     = 1;
+   config.idle_skip      = 0;
    config.bios           = 0;
    config.lock_on        = 0;
    config.lcd            = 0; /* 0.8 fixed point */
@@ -678,6 +687,48 @@ static void extract_directory(char *buf, const char *path, size_t size)
       buf[0] = '\0';
 }
 
+static void movie_record_start(int start)
+{
+   char path[1040];
+   FILE *fd;
+   int i;
+
+   /* previous movies are kept */
+   for (i = 0; i < 1000; i++)
+   {
+      if (i)
+         snprintf(path, sizeof(path), "%s-%d.gpm", g_movie_base, i);
+      else
+         snprintf(path, sizeof(path), "%s.gpm", g_movie_base);
+      fd = fopen(path, "rb");
+      if (!fd)
+         break;
+      fclose(fd);
+   }
+
+   if (movie_record(path, start, MOVIE_HASH_INTERVAL))
+   {
+      if (log_cb)
+         log_cb(RETRO_LOG_INFO, "Recording input movie to %s\n", path);
+   }
+   else
+   {
+      if (log_cb)
+         log_cb(RETRO_LOG_ERROR, "Could not create input movie %s\n", path);
+      movie_requested = false;
+   }
+}
+
+static void movie_record_stop(void)
+{
+   if (movie.mode == MOVIE_RECORD)
+   {
+      movie_stop();
+      if (log_cb)
+         log_cb(RETRO_LOG_INFO, "Input movie recording stopped after %u frames\n", movie.frame);
+   }
+}
+
 static bool update_viewport(void)
 {
   int ow = vwidth;
@@ -817,6 +868,20 @@ static void check_variables(void)
       m68k.aerr_enabled = config.addr_error = 0;
   }
 
+  var.key = "genesis_plus_gx_idle_skip";
+  environ_cb(RETRO_ENVIRONMENT_GET_VARIABLE, &var);
+  {
+    orig_value = config.idle_skip;
+    if (!strcmp(var.value, "enabled"))
+      config.idle_skip = 1;
+    else
+      config.idle_skip = 0;
+
+    /* only used with cartridge hardware (per-game setting is kept until option is changed) */
+    if ((orig_value != config.idle_skip) && (system_hw == SYSTEM_MD))
+      m68k.skip.enabled = config.idle_skip;
+  }
+
   var.key = "genesis_plus_gx_lock_on";
   environ_cb(RETRO_ENVIRONMENT_GET_VARIABLE, &var);
   {
@@ -973,13 +1038,66 @@ static void check_variables(void)
       config.invert_mouse = 1;
   }
 
+  var.key = "genesis_plus_gx_rewind";
+  environ_cb(RETRO_ENVIRONMENT_GET_VARIABLE, &var);
+  {
+    orig_value = rewind_size;
+    if (strcmp(var.value, "disabled") == 0)
+      rewind_size = 0;
+    else
+      rewind_size = atoi(var.value) << 20;
+    if (orig_value != rewind_size)
+    {
+      if (!rewind_size)
+        rewind_shutdown();
+      else if (!rewind_init(rewind_size))
+      {
+        if (log_cb)
+          log_cb(RETRO_LOG_ERROR, "Could not allocate %s rewind buffer.\n", var.value);
+        rewind_size = 0;
+      }
+    }
+  }
+
+  var.key = "genesis_plus_gx_runahead";
+  environ_cb(RETRO_ENVIRONMENT_GET_VARIABLE, &var);
+  {
+    if (strcmp(var.value, "disabled") == 0)
+      runahead_frames = 0;
+    else
+      runahead_frames = atoi(var.value);
+    if (runahead_frames && !runahead_state)
+    {
+      runahead_state = malloc(STATE_SIZE);
+      if (!runahead_state)
+      {
+        if (log_cb)
+          log_cb(RETRO_LOG_ERROR, "Could not allocate run-ahead state buffer.\n");
+        runahead_frames = 0;
+      }
+    }
+  }
+
+  var.key = "genesis_plus_gx_movie_record";
+  environ_cb(RETRO_ENVIRONMENT_GET_VARIABLE, &var);
+  {
+    movie_requested = (strcmp(var.value, "enabled") == 0);
+    if (!movie_requested)
+      movie_record_stop();
+    else if (is_running && (movie.mode != MOVIE_RECORD))
+      movie_record_start(MOVIE_STATE);
+  }
+
   if (reinit)
   {
+    /* recorded inputs would not match reinitialized system */
+    movie_record_stop();
     audio_init(44100, snd.frame_rate);
     memcpy(temp, sram.sram, sizeof(temp));
     system_init();
     system_reset();
     memcpy(sram.sram, temp, sizeof(temp));
+    serialize_size = state_size();
   }
 
   if (update_viewports)
@@ -1270,11 +1388,13 @@ static void RAMCheatUpdate(void)
       {
          /* 16-bit patch */
          *(uint16_t *)(work_ram + (cheatlist[index].address & 0xFFFE)) = cheatlist[index].data;
+         MARK_DIRTY(DIRTY_WORK_RAM, cheatlist[index].address & 0xFFFE);
       }
       else
       {
          /* 8-bit patch */
          work_ram[cheatlist[index].address & 0xFFFF] = cheatlist[index].data;
+         MARK_DIRTY(DIRTY_WORK_RAM, cheatlist[index].address & 0xFFFF);
       }
    }
 }
@@ -1336,6 +1456,7 @@ void retro_set_environment(retro_environment_t cb)
       { "genesis_plus_gx_force_dtack", "System lockups; enabled|disabled" },
       { "genesis_plus_gx_bios", "System bootrom; disabled|enabled" },
       { "genesis_plus_gx_addr_error", "68k address error; enabled|disabled" },
+      { "genesis_plus_gx_idle_skip", "68k idle loop skipping (faster); disabled|enabled" },
       { "genesis_plus_gx_lock_on", "Cartridge lock-on; disabled|game genie|action replay (pro)|sonic & knuckles" },
       { "genesis_plus_gx_ym2413", "Master System FM; auto|disabled|enabled" },
       { "genesis_plus_gx_dac_bits", "YM2612 DAC quantization; disabled|enabled" },
@@ -1346,6 +1467,9 @@ void retro_set_environment(retro_environment_t cb)
       { "genesis_plus_gx_render", "Interlaced mode 2 output; single field|double field" },
       { "genesis_plus_gx_gun_cursor", "Show Lightgun crosshair; no|yes" },
       { "genesis_plus_gx_invert_mouse", "Invert Mouse Y-axis; no|yes" },
+      { "genesis_plus_gx_rewind", "Rewind buffer (hold L2); disabled|16MB|32MB|64MB|128MB|256MB" },
+      { "genesis_plus_gx_runahead", "Run-ahead frames (reduces input latency); disabled|1|2|3|4" },
+      { "genesis_plus_gx_movie_record", "Input movie recording (saved as <game>.gpm); disabled|enabled" },
       { NULL, NULL },
    };
 
@@ -1533,11 +1657,11 @@ void retro_set_controller_port_device(unsigned port, unsigned device)
    input_reset();
 }
 
-size_t retro_serialize_size(void) { return STATE_SIZE; }
+size_t retro_serialize_size(void) { return serialize_size; }
 
 bool retro_serialize(void *data, size_t size)
 { 
-   if (size != STATE_SIZE)
+   if (size != serialize_size)
       return FALSE;
 
    state_save(data);
@@ -1547,10 +1671,13 @@ bool retro_serialize(void *data, size_t size)
 
 bool retro_unserialize(const void *data, size_t size)
 {
-   if (size != STATE_SIZE)
+   if (size != serialize_size)
       return FALSE;
 
-   if (!state_load((uint8_t*)data))
+   /* recorded inputs would not match loaded state */
+   movie_record_stop();
+
+   if (!state_restore((uint8_t*)data, size))
       return FALSE;
 
    return TRUE;
@@ -1620,6 +1747,7 @@ bool retro_load_game(const struct retro_game_info *info)
       { 0, RETRO_DEVICE_JOYPAD, 0, RETRO_DEVICE_ID_JOYPAD_R,     "Z" },
       { 0, RETRO_DEVICE_JOYPAD, 0, RETRO_DEVICE_ID_JOYPAD_SELECT,    "Mode" },
       { 0, RETRO_DEVICE_JOYPAD, 0, RETRO_DEVICE_ID_JOYPAD_START,    "Start" },
+      { 0, RETRO_DEVICE_JOYPAD, 0, RETRO_DEVICE_ID_JOYPAD_L2,    "Rewind" },
 
       { 1, RETRO_DEVICE_JOYPAD, 0, RETRO_DEVICE_ID_JOYPAD_LEFT,  "D-Pad Left" },
       { 1, RETRO_DEVICE_JOYPAD, 0, RETRO_DEVICE_ID_JOYPAD_UP,    "D-Pad Up" },
@@ -1719,6 +1847,21 @@ bool retro_load_game(const struct retro_game_info *info)
 
    extract_directory(g_rom_dir, info->path, sizeof(g_rom_dir));
 
+   /* input movies are saved as <save directory>/<game name>.gpm */
+   if (!environ_cb(RETRO_ENVIRONMENT_GET_SAVE_DIRECTORY, &dir) || !dir)
+      dir = g_rom_dir;
+   {
+      const char *name = strrchr(info->path, '/');
+      char *ext;
+      if (!name)
+         name = strrchr(info->path, '\\');
+      name = name ? (name + 1) : info->path;
+      snprintf(g_movie_base, sizeof(g_movie_base), "%s%c%s", dir, slash, name);
+      ext = strrchr(g_movie_base, '.');
+      if (ext && (ext > g_movie_base + strlen(dir) + 1))
+         *ext = 0;
+   }
+
    if (!environ_cb(RETRO_ENVIRONMENT_GET_SYSTEM_DIRECTORY, &dir) || !dir)
    {
       if (log_cb)
@@ -1791,6 +1934,7 @@ bool retro_load_game(const struct retro_game_info *info)
    system_init();
    system_reset();
    is_running = false;
+   serialize_size = state_size();
 
    if (system_hw == SYSTEM_MCD)
       bram_load();
@@ -1810,8 +1954,12 @@ bool retro_load_game_special(unsigned game_type, const struct retro_game_info *i
 
 void retro_unload_game(void) 
 {
+   movie_record_stop();
+
    if (system_hw == SYSTEM_MCD)
       bram_save();
+
+   rewind_reset();
 }
 
 unsigned retro_get_region(void) { return vdp_pal ? RETRO_REGION_PAL : RETRO_REGION_NTSC; }
@@ -1902,7 +2050,11 @@ void retro_init(void)
 
 void retro_deinit(void)
 {
+   rewind_shutdown();
+   free(runahead_state);
+   runahead_state = NULL;
    audio_shutdown();
+   system_shutdown();
    if (md_ntsc)
       free(md_ntsc);
    if (sms_ntsc)
@@ -1910,19 +2062,105 @@ void retro_deinit(void)
 
 }
 
-void retro_reset(void) { system_reset(); }
+void retro_reset(void)
+{
+   system_reset();
+   movie_reset();
+}
+
+#ifdef USE_PROFILER
+#define PROFILE_FRAMES 60
+
+static void profile_update(void)
+{
+   static t_profile total;
+   static unsigned frames;
+   t_profile frame;
+   int i;
+
+   profile_get(&frame);
+   profile_add(&total, &frame);
+
+   if (++frames < PROFILE_FRAMES)
+      return;
+
+   /* log average time & calls per frame */
+   if (log_cb)
+   {
+      log_cb(RETRO_LOG_INFO, "Profile (average per frame over %d frames):\n", PROFILE_FRAMES);
+      for (i = 0; i < PROFILE_MAX; i++)
+      {
+         if (total.func[i].calls)
+            log_cb(RETRO_LOG_INFO, "  %-24s %8.3f ms %8u calls\n", profile_name(i),
+                   (total.func[i].time * 1000.0) / PROFILE_FRAMES, total.func[i].calls / PROFILE_FRAMES);
+      }
+      log_cb(RETRO_LOG_INFO, "  VDP port writes %u, DMA words %u\n",
+             total.vdp_writes / PROFILE_FRAMES, total.dma_words / PROFILE_FRAMES);
+   }
+
+   memset(&total, 0, sizeof(total));
+   frames = 0;
+}
+#endif
+
+static void run_frame(int do_skip)
+{
+   if (system_hw == SYSTEM_MCD)
+      system_frame_scd(do_skip);
+   else if ((system_hw & SYSTEM_PBC) == SYSTEM_MD)
+      system_frame_gen(do_skip);
+   else
+      system_frame_sms(do_skip);
+}
 
 void retro_run(void) 
 {
    bool updated = false;
+   int samples;
+
+   /* movie recording enabled at startup begins at power-on */
+   if (!is_running && movie_requested && (movie.mode != MOVIE_RECORD))
+      movie_record_start(MOVIE_POWER_ON);
    is_running = true;
 
-   if (system_hw == SYSTEM_MCD)
-      system_frame_scd(0);
-   else if ((system_hw & SYSTEM_PBC) == SYSTEM_MD)
-      system_frame_gen(0);
+   if (rewind_size)
+   {
+      /* go back one frame while L2 is held (unless used by XE-1AP), otherwise record current frame */
+      if ((input.dev[0] != DEVICE_XE_1AP) && input_state_cb(0, RETRO_DEVICE_JOYPAD, 0, RETRO_DEVICE_ID_JOYPAD_L2))
+      {
+         movie_record_stop();
+         rewind_pop();
+      }
+      else
+         rewind_push();
+   }
+
+   if (runahead_frames)
+   {
+      unsigned i;
+
+      /* current frame is emulated without rendering */
+      run_frame(1);
+      samples = audio_update(soundbuffer);
+      movie_frame();
+
+      /* next frames are emulated with current input then discarded, only last one is rendered */
+      state_save(runahead_state);
+      audio_mute(1);
+      snd.enabled = 0;
+      for (i = 1; i <= runahead_frames; i++)
+      {
+         run_frame(i < runahead_frames);
+         audio_update(runahead_soundbuffer);
+      }
+      snd.enabled = 1;
+   }
    else
-      system_frame_sms(0);
+   {
+      run_frame(0);
+      samples = audio_update(soundbuffer);
+      movie_frame();
+   }
 
    if (bitmap.viewport.changed & 1)
    {
@@ -1957,7 +2195,19 @@ void retro_run(void)
    }
 
    video_cb(bitmap.data, vwidth, vheight, 720 * 2);
-   audio_cb(soundbuffer, audio_update(soundbuffer));
+
+   if (runahead_frames)
+   {
+      /* go back to current frame */
+      state_restore(runahead_state, STATE_SIZE);
+      audio_mute(0);
+   }
+
+   audio_cb(soundbuffer, samples);
+
+#ifdef USE_PROFILER
+   profile_update();
+#endif
 
    environ_cb(RETRO_ENVIRONMENT_GET_VARIABLE_UPDATE, &updated);
    if (updated)
@@ -59,6 +59,7 @@ struct
   uint8 vdp_mode;
   uint8 force_dtack;
   uint8 addr_error;
+  uint8 idle_skip;
   uint8 bios;
   uint8 lock_on;
   uint8 overscan;
@@ -0,0 +1,320 @@
+/*
+ * Rewind history
+ *
+ * Each entry holds the difference between two consecutive savestates, so that only the
+ * most recent savestate is kept uncompressed. Differences are XOR'ed 32-bit words, coded
+ * as (unchanged word count, changed word count, changed words) runs: going back one frame
+ * only requires to apply one entry over the current savestate, in place.
+ *
+ * Entries are stored in a ring buffer allocated once, oldest entries being dropped when
+ * there is not enough space left for a new one:
+ *
+ *   [length (4 bytes)][previous savestate size (4 bytes)][coded data][length (4 bytes)]
+ */
+
+#include "shared.h"
+#include "rewind.h"
+
+#define ENTRY_HEADER  8
+#define ENTRY_TRAILER 4
+
+/* uncompressed savestates (current & temporary) */
+static uint8 *state_buf[2];
+static int state_len[2];
+static int state_cur;
+
+/* coded entry workspace (worst case: every other word changed) */
+static uint8 *entry_buf;
+
+/* ring buffer */
+static uint8 *ring;
+static uint32 ring_size;
+static uint32 ring_head;  /* end of newest entry */
+static uint32 ring_tail;  /* start of oldest entry */
+static uint32 ring_wrap;  /* end of valid data when head has wrapped, 0 otherwise */
+static unsigned int ring_count;
+
+static uint32 read_u32(const uint8 *ptr)
+{
+   uint32 data;
+   memcpy(&data, ptr, 4);
+   return data;
+}
+
+static void write_u32(uint8 *ptr, uint32 data)
+{
+   memcpy(ptr, &data, 4);
+}
+
+static uint8 *write_count(uint8 *ptr, uint32 count)
+{
+   while (count >= 0x80)
+   {
+      *ptr++ = (count & 0x7f) | 0x80;
+      count >>= 7;
+   }
+   *ptr++ = count;
+   return ptr;
+}
+
+static const uint8 *read_count(const uint8 *ptr, uint32 *count)
+{
+   uint32 data = 0;
+   int shift = 0;
+   uint8 byte;
+   do
+   {
+      byte = *ptr++;
+      data |= (uint32)(byte & 0x7f) << shift;
+      shift += 7;
+   }
+   while (byte & 0x80);
+   *count = data;
+   return ptr;
+}
+
+/* code XOR difference of two word buffers, returns coded size */
+static uint32 delta_encode(uint8 *dst, const uint32 *cur, const uint32 *prev, uint32 words)
+{
+   uint8 *ptr = dst;
+   uint32 i = 0, start;
+
+   while (i < words)
+   {
+      /* unchanged words */
+      start = i;
+      while ((i < words) && (cur[i] == prev[i])) i++;
+      ptr = write_count(ptr, i - start);
+
+      /* changed words */
+      start = i;
+      while ((i < words) && (cur[i] != prev[i])) i++;
+      ptr = write_count(ptr, i - start);
+      for (; start < i; start++)
+      {
+         write_u32(ptr, cur[start] ^ prev[start]);
+         ptr += 4;
+      }
+   }
+
+   return ptr - dst;
+}
+
+/* apply coded XOR difference to a word buffer */
+static void delta_apply(uint32 *buf, const uint8 *src, uint32 words)
+{
+   uint32 i = 0, count;
+
+   while (i < words)
+   {
+      src = read_count(src, &count);
+      i += count;
+      src = read_count(src, &count);
+      while (count--)
+      {
+         buf[i++] ^= read_u32(src);
+         src += 4;
+      }
+   }
+}
+
+/* drop oldest entry */
+static void ring_drop(void)
+{
+   ring_tail += ENTRY_HEADER + read_u32(ring + ring_tail) + ENTRY_TRAILER;
+   if (ring_tail == ring_wrap)
+   {
+      ring_tail = 0;
+      ring_wrap = 0;
+   }
+
+   if (--ring_count == 0)
+   {
+      ring_head = ring_tail = ring_wrap = 0;
+   }
+}
+
+/* find contiguous space for a new entry, dropping oldest entries if needed */
+static uint8 *ring_alloc(uint32 size)
+{
+   if (size > ring_size)
+   {
+      return NULL;
+   }
+
+   while (1)
+   {
+      if (ring_wrap)
+      {
+         /* free space between newest and oldest entries */
+         if ((ring_head + size) <= ring_tail)
+         {
+            break;
+         }
+      }
+      else if ((ring_head + size) <= ring_size)
+      {
+         /* free space at the end of ring buffer */
+         break;
+      }
+      else if (ring_count && (ring_tail >= size))
+      {
+         /* free space at the start of ring buffer */
+         ring_wrap = ring_head;
+         ring_head = 0;
+         break;
+      }
+
+      ring_drop();
+   }
+
+   return ring + ring_head;
+}
+
+int rewind_init(unsigned int size)
+{
+   rewind_shutdown();
+
+   state_buf[0] = malloc(STATE_SIZE);
+   state_buf[1] = malloc(STATE_SIZE);
+   entry_buf = malloc(ENTRY_HEADER + ((STATE_SIZE / 4) * 6) + 16 + ENTRY_TRAILER);
+   ring = malloc(size);
+
+   if (!state_buf[0] || !state_buf[1] || !entry_buf || !ring)
+   {
+      rewind_shutdown();
+      return 0;
+   }
+
+   ring_size = size;
+   rewind_reset();
+   return 1;
+}
+
+void rewind_shutdown(void)
+{
+   free(state_buf[0]);
+   free(state_buf[1]);
+   free(entry_buf);
+   free(ring);
+   state_buf[0] = state_buf[1] = entry_buf = ring = NULL;
+   ring_size = 0;
+}
+
+void rewind_reset(void)
+{
+   if (ring)
+   {
+      /* data beyond savestate size is compared as zero */
+      memset(state_buf[0], 0, STATE_SIZE);
+      memset(state_buf[1], 0, STATE_SIZE);
+      state_len[0] = state_len[1] = 0;
+      state_cur = 0;
+      ring_head = ring_tail = ring_wrap = 0;
+      ring_count = 0;
+   }
+}
+
+/* save current state as most recent one */
+void rewind_push(void)
+{
+   int prev = state_cur;
+   int cur = state_cur ^ 1;
+   int size;
+   uint32 words, length;
+   uint8 *entry;
+
+   if (!ring)
+   {
+      return;
+   }
+
+   /* clear remaining data from older savestate */
+   if (state_len[cur])
+   {
+      memset(state_buf[cur], 0, state_len[cur]);
+   }
+
+   size = state_save(state_buf[cur]);
+   state_len[cur] = size;
+   state_cur = cur;
+
+   /* first savestate */
+   if (!state_len[prev])
+   {
+      return;
+   }
+
+   if (size < state_len[prev])
+   {
+      size = state_len[prev];
+   }
+   words = (size + 3) >> 2;
+
+   length = delta_encode(entry_buf + ENTRY_HEADER, (const uint32 *)state_buf[cur], (const uint32 *)state_buf[prev], words);
+
+   entry = ring_alloc(ENTRY_HEADER + length + ENTRY_TRAILER);
+   if (!entry)
+   {
+      /* history is lost */
+      rewind_reset();
+      state_len[cur] = state_save(state_buf[cur]);
+      state_cur = cur;
+      return;
+   }
+
+   write_u32(entry_buf, length);
+   write_u32(entry_buf + 4, state_len[prev]);
+   write_u32(entry_buf + ENTRY_HEADER + length, length);
+   memcpy(entry, entry_buf, ENTRY_HEADER + length + ENTRY_TRAILER);
+
+   ring_head += ENTRY_HEADER + length + ENTRY_TRAILER;
+   ring_count++;
+}
+
+/* restore previous state (oldest state is restored if history is empty) */
+int rewind_pop(void)
+{
+   uint8 *buf = state_buf[state_cur];
+   uint32 length, words;
+   int size;
+
+   if (!ring || !state_len[state_cur])
+   {
+      return 0;
+   }
+
+   if (!ring_count)
+   {
+      state_restore(buf, state_len[state_cur]);
+      return 0;
+   }
+
+   /* newest entry ends at the start of ring buffer */
+   if (!ring_head)
+   {
+      ring_head = ring_wrap;
+      ring_wrap = 0;
+   }
+
+   length = read_u32(ring + ring_head - ENTRY_TRAILER);
+   ring_head -= ENTRY_HEADER + length + ENTRY_TRAILER;
+
+   size = read_u32(ring + ring_head + 4);
+   words = ((size > state_len[state_cur] ? size : state_len[state_cur]) + 3) >> 2;
+   delta_apply((uint32 *)buf, ring + ring_head + ENTRY_HEADER, words);
+
+   state_len[state_cur] = size;
+   if (--ring_count == 0)
+   {
+      ring_head = ring_tail = ring_wrap = 0;
+   }
+
+   state_restore(buf, size);
+   return 1;
+}
+
+unsigned int rewind_frames(void)
+{
+   return ring_count;
+}
@@ -0,0 +1,12 @@
+#ifndef _REWIND_H_
+#define _REWIND_H_
+
+/* Rewind history, stored in a fixed size ring buffer as compressed XOR deltas of consecutive savestates */
+extern int rewind_init(unsigned int size);
+extern void rewind_shutdown(void);
+extern void rewind_reset(void);
+extern void rewind_push(void);
+extern int rewind_pop(void);
+extern unsigned int rewind_frames(void);
+
+#endif
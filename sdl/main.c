@@ -45,6 +45,34 @@ static uint8 brm_format[0x40] =
 
 static short soundframe[SOUND_SAMPLES_SIZE];
 
+#ifdef USE_PROFILER
+/* profiling counters accumulated since last report */
+static t_profile profile_total;
+static int profile_frames;
+
+static void sdl_profile_print(void)
+{
+  int i;
+
+  if (!profile_frames) return;
+
+  printf("Profile (average per frame over %d frames):\n", profile_frames);
+  for (i=0; i<PROFILE_MAX; i++)
+  {
+    if (profile_total.func[i].calls)
+    {
+      printf("  %-24s %8.3f ms %8u calls\n", profile_name(i),
+             (profile_total.func[i].time * 1000.0) / profile_frames, profile_total.func[i].calls / profile_frames);
+    }
+  }
+  printf("  VDP port writes %u, DMA words %u\n",
+         profile_total.vdp_writes / profile_frames, profile_total.dma_words / profile_frames);
+
+  memset(&profile_total, 0, sizeof(profile_total));
+  profile_frames = 0;
+}
+#endif
+
 static void sdl_sound_callback(void *userdata, Uint8 *stream, int len)
 {
   if(sdl_sound.current_emulated_samples < len) {
@@ -320,6 +348,7 @@ static int sdl_control_update(SDLKey keystate)
       case SDLK_TAB:
       {
         system_reset();
+        movie_reset();
         break;
       }
 
@@ -373,8 +402,11 @@ static int sdl_control_update(SDLKey keystate)
         if (f)
         {
           uint8 buf[STATE_SIZE];
-          fread(&buf, STATE_SIZE, 1, f);
-          state_load(buf);
+
+          /* recorded inputs would not match loaded state */
+          movie_stop();
+
+          state_load(buf, fread(&buf, 1, STATE_SIZE, f));
           fclose(f);
         }
         break;
@@ -395,6 +427,7 @@ static int sdl_control_update(SDLKey keystate)
 
       case SDLK_F9:
       {
+        movie_stop();
         config.region_detect = (config.region_detect + 1) % 5;
         get_region(0);
 
@@ -451,6 +484,7 @@ static int sdl_control_update(SDLKey keystate)
       case SDLK_F10:
       {
         gen_reset(0);
+        movie_reset();
         break;
       }
 
@@ -479,6 +513,28 @@ static int sdl_control_update(SDLKey keystate)
         break;
       }
 
+      case SDLK_INSERT:
+      {
+        /* start or stop input movie recording */
+        if (movie.mode == MOVIE_RECORD)
+        {
+          movie_stop();
+        }
+        else
+        {
+          movie_record("game.gpm", MOVIE_STATE, MOVIE_HASH_INTERVAL);
+        }
+        break;
+      }
+
+      case SDLK_HOME:
+      {
+        /* start input movie recording from power-on */
+        system_reset();
+        movie_record("game.gpm", MOVIE_POWER_ON, MOVIE_HASH_INTERVAL);
+        break;
+      }
+
       case SDLK_ESCAPE:
       {
         return 0;
@@ -875,6 +931,9 @@ int main (int argc, char **argv)
           char caption[100];  
           sprintf(caption,"Genesis Plus GX - %d fps - %s)", event.user.code, (rominfo.international[0] != 0x20) ? rominfo.international : rominfo.domestic);
           SDL_WM_SetCaption(caption, NULL);
+#ifdef USE_PROFILER
+          sdl_profile_print();
+#endif
           break;
         }
 
@@ -895,6 +954,18 @@ int main (int argc, char **argv)
     sdl_video_update();
     sdl_sound_update(use_sound);
 
+    /* record inputs */
+    movie_frame();
+
+#ifdef USE_PROFILER
+    {
+      t_profile frame;
+      profile_get(&frame);
+      profile_add(&profile_total, &frame);
+      profile_frames++;
+    }
+#endif
+
     if(!turbo_mode && sdl_sync.sem_sync && sdl_video.frames_rendered % 3 == 0)
     {
       SDL_SemWait(sdl_sync.sem_sync);
@@ -940,6 +1011,7 @@ int main (int argc, char **argv)
     }
   }
 
+  movie_stop();
   audio_shutdown();
   error_shutdown();
 